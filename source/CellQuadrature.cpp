@@ -0,0 +1,59 @@
+/* This is the source file which contains the subroutines necessary for the tensor-product Gaussian
+ * quadrature on the cells I_i x K_(j1,j2,j3), which is used by the diagnostics integrating a function
+ * of the approximate solution (see integrateCells in CellQuadrature.h).
+ *
+ * The values of the six basis functions at the 625 quadrature points of a cell are the same for every
+ * cell (they only depend on (x-x_i)/dx & (v-v_j)/dv), so they are computed once by initCellQuadrature,
+ * and the values of f at the points of a row of cells are then the product of the row's DG coefficients
+ * with this 6 x 625 matrix, computed by dgemm.
+ *
+ * Functions included: initCellQuadrature, freeCellQuadrature, evalCellQuadrature
+ *
+ */
+
+#include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the CellQuadrature functions (included first, so that the headers it includes which use CellQuadrature.h see all of it)
+#include "CellQuadrature.h"																				// CellQuadrature.h is where the prototypes for the functions contained in this file are declared
+
+CellQuadrature cell_quad;																				// declare cell_quad (the basis values & weights at the quadrature points of a cell, computed once by initCellQuadrature)
+
+void initCellQuadrature(CellQuadrature *cq)																// function to compute the values of the basis functions & the weights at the quadrature points of a cell in cq
+{
+	int nx, nv1, nv2, nv3, q;																			// declare nx, nv1, nv2, nv3 (the indices of the nodes in each direction) & q (the index of the quadrature point)
+	double y1, y2, y3;																					// declare y1, y2, y3 (the values of (v_m-v_m0)/dv at the point)
+
+	cq->basis = (double*)malloc(6*QuadPts*sizeof(double));
+	cq->weight = (double*)malloc(QuadPts*sizeof(double));
+	for(nx=0;nx<QuadNodes;nx++)
+	{
+		for(nv1=0;nv1<QuadNodes;nv1++)
+		{
+			y1 = 0.5*vt[nv1];
+			for(nv2=0;nv2<QuadNodes;nv2++)
+			{
+				y2 = 0.5*vt[nv2];
+				for(nv3=0;nv3<QuadNodes;nv3++)
+				{
+					y3 = 0.5*vt[nv3];
+					q = nv3 + QuadNodes*(nv2 + QuadNodes*(nv1 + QuadNodes*nx));
+					cq->basis[q] = 1.;																	// the basis functions are 1, (x-x_i)/dx, (v1-v_j1)/dv, (v2-v_j2)/dv, (v3-v_j3)/dv & the sum of the squares of the last three
+					cq->basis[q + QuadPts] = 0.5*vt[nx];
+					cq->basis[q + 2*QuadPts] = y1;
+					cq->basis[q + 3*QuadPts] = y2;
+					cq->basis[q + 4*QuadPts] = y3;
+					cq->basis[q + 5*QuadPts] = y1*y1 + y2*y2 + y3*y3;
+					cq->weight[q] = wt[nx]*wt[nv1]*wt[nv2]*wt[nv3]*0.5*0.5*0.5*0.5;						// the weights wt are for the interval [-1,1] rather than [-1/2,1/2]
+				}
+			}
+		}
+	}
+}
+
+void freeCellQuadrature(CellQuadrature *cq)															// function to delete the tables in cq
+{
+	free(cq->basis); free(cq->weight);
+}
+
+void evalCellQuadrature(double *U, int row, double *f_vals)												// function to store the values of f (with DG coefficients in U) at the quadrature points of the cells of the given row (j2 + Nv*(j1 + Nv*i)) in f_vals, those of the cell j3 being f_vals[j3*QuadPts + q]
+{
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, Nv, QuadPts, 6, 1., &U[row*Nv*6], 6, cell_quad.basis, QuadPts, 0., f_vals, QuadPts);
+}
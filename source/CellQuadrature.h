@@ -0,0 +1,113 @@
+/* This is the header file associated to CellQuadrature.cpp in which the record of the tensor-product
+ * Gaussian quadrature on each cell, the prototypes for the functions contained in that file and the
+ * external variables they set are declared, along with integrateRow & integrateCells, which have to be
+ * defined here since they are templates for any integrand.  Any other header files which must be linked to for the
+ * functions here are also included.
+ *
+ */
+
+//************************//
+//     INCLUDE GUARDS     //
+//************************//
+
+#ifndef CELLQUADRATURE_H_
+#define CELLQUADRATURE_H_
+
+//************************//
+//        INCLUDES        //
+//************************//
+
+#include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the CellQuadrature functions
+
+//************************//
+//         MACROS         //
+//************************//
+
+#define QuadNodes 5																						// the number of Gaussian quadrature nodes in each direction of a cell (the nodes vt & weights wt of advection_1.cpp)
+#define QuadPts (QuadNodes*QuadNodes*QuadNodes*QuadNodes)												// the number of quadrature points in each cell I_i x K_(j1,j2,j3), 5^4 = 625
+
+//************************//
+//    DATA STRUCTURES     //
+//************************//
+
+typedef struct
+{
+	double *basis;																						// basis[q + QuadPts*l] is the value of the lth basis function at the qth quadrature point, where q = nv3 + 5*(nv2 + 5*(nv1 + 5*nx)) (a 6 x QuadPts matrix, so that dgemm gives f at every point of a row of cells)
+	double *weight;																						// weight[q] = wt[nx]*wt[nv1]*wt[nv2]*wt[nv3]/16, so that the integral of g over a cell is dx*dv^3 times the sum of weight[q]*g at the points q
+} CellQuadrature;
+
+//************************//
+//   EXTERNAL VARIABLES   //
+//************************//
+
+extern CellQuadrature cell_quad;																		// declare cell_quad (the basis values & weights at the quadrature points of a cell, computed once by initCellQuadrature)
+
+//************************//
+//   FUNCTION PROTOTYPES  //
+//************************//
+
+void initCellQuadrature(CellQuadrature *cq);
+
+void freeCellQuadrature(CellQuadrature *cq);
+
+void evalCellQuadrature(double *U, int row, double *f_vals);
+
+/*
+function integrateRow
+---------------------
+Returns the quadrature of g(f) on the row of Nv cells I_i x K_(j1,j2,j3) with j3 = 0,...,Nv-1, where
+row = j2 + Nv*(j1 + Nv*i), without the factor dx*dv^3 (the volume of each cell), for a functor integrand
+as in integrateCells.  f_vals holds the values of f at the points of the row, computed by
+evalCellQuadrature, so that several integrands can share them.  This is the work done on each row by
+integrateCells, for sweeps which calculate other quantities of the same rows (see computeDiagnostics).
+*/
+template <class Integrand>
+double integrateRow(double *f_vals, int row, Integrand &integrand)
+{
+	int j3, q;																							// declare j3 (the index of the cell in the row) & q (the index of the quadrature point)
+	double *f_cell, sum;																				// declare f_cell (the values of f at the quadrature points of the current cell) & sum (the quadrature result)
+	sum = 0;
+	for(j3=0;j3<Nv;j3++)
+	{
+		integrand.cell(row*Nv + j3);
+		f_cell = &f_vals[j3*QuadPts];
+		for(q=0;q<QuadPts;q++)
+		{
+			sum += cell_quad.weight[q]*integrand(q, f_cell[q]);
+		}
+	}
+	return sum;
+}
+
+/*
+function integrateCells
+-----------------------
+Returns the integral over Omega_x x Omega_v of g(f), where f is the approximate solution with DG coefficients
+in U, by the Gaussian quadrature on each cell.  The integrand is given by a functor with two members:
+	void cell(int k)				called before the points of the kth cell (to look up anything which depends on the cell)
+	double operator()(int q, double f_val)	returning g at the qth point of that cell, where f takes the value f_val
+The values of f at the points of a row of cells are computed together by evalCellQuadrature and the rows
+are shared out between the OpenMP threads, each integrating its rows with integrateRow and its own copy
+of the functor.
+*/
+template <class Integrand>
+double integrateCells(double *U, Integrand integrand)
+{
+	int row;																							// declare row (the index of the row of Nv cells I_i x K_(j1,j2,j3) with j3 = 0,...,Nv-1, row = j2 + Nv*(j1 + Nv*i))
+	double *f_vals, sum;																				// declare f_vals (the values of f at the quadrature points of the current row) & sum (the quadrature result)
+	sum = 0;
+	#pragma omp parallel private(row,f_vals) firstprivate(integrand) reduction(+:sum)
+	{
+		f_vals = (double*)malloc(Nv*QuadPts*sizeof(double));
+		#pragma omp for
+		for(row=0;row<Nx*Nv*Nv;row++)
+		{
+			evalCellQuadrature(U, row, f_vals);
+			sum += integrateRow(f_vals, row, integrand);
+		}
+		free(f_vals);
+	}
+	return sum*dx*dv*dv*dv;																				// each cell has volume dx*dv^3
+}
+
+#endif /* CELLQUADRATURE_H_ */
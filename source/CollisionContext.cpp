@@ -0,0 +1,175 @@
+/* This is the source file which contains the subroutines necessary for setting up the work arrays of the
+ * collision step.
+ *
+ * Everything the collision step of one space-step writes to (the FFT work array, the stages of RK4 in
+ * Fourier & velocity space, the padded arrays of ComputeQ_FFT and the partial sums of the projection
+ * onto the DG basis) is kept in a CollisionContext, which is passed to ComputeQ, RK4 and the routines
+ * they call, and the FFTs are executed on its arrays with the new-array execute functions of fftw3.  Several space-steps can then have their collision steps
+ * computed at the same time, each by a different OpenMP thread with its own context (QParallelCells),
+ * instead of computing the space-steps one after another with the threads sharing out the loops inside
+ * each of them (QParallelModes).
+ *
+ * Functions included: chooseQParallel, allocCollisionContext, freeCollisionContext
+ *
+ */
+
+#include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the CollisionContext functions
+#include "CollisionContext.h"																			// CollisionContext.h is where the prototypes for the functions contained in this file are declared
+
+CollisionContext *coll_ctx;																				// declare coll_ctx (the work arrays of each of the workers computing collision steps at the same time)
+int n_coll_ctx;																							// declare n_coll_ctx (the number of workers, nthread if the space-steps are shared out between the OpenMP threads and 1 otherwise)
+
+int chooseQParallel(int requested)																		// function to return how the collision steps should be shared out between the OpenMP threads (QParallelCells or QParallelModes), for the choice requested with the option -qparallel (once N, chunk_Nx, nthread & QBatch are set)
+{
+	// THE BATCHES OF -qbatch ARE COMPUTED ONE AFTER ANOTHER WITH THE FIRST CONTEXT, SO THE THREADS CAN ONLY SHARE OUT THE LOOPS AND FFTs INSIDE THEM:
+	if(requested == QParallelCells && QBatch > 1)
+	{
+		if(myrank_mpi == 0)
+		{
+			printf("Notice: the collision steps are computed in batches of %d space-steps, so they are shared out between the threads by modes instead of cells. \n", QBatch);
+		}
+		return QParallelModes;
+	}
+	if(requested != QParallelAuto)
+	{
+		return requested;
+	}
+	// EACH THREAD TAKES ITS OWN SPACE-STEPS WHEN THERE ARE ENOUGH OF THEM TO KEEP ALL OF THE THREADS BUSY AND THE LOOPS INSIDE A COLLISION STEP
+	// ARE TOO SHORT TO SHARE OUT WELL (THE BATCHES OF -qbatch ALREADY SHARE EACH WEIGHT BETWEEN SEVERAL SPACE-STEPS, SO THEY KEEP THE LOOPS INSIDE):
+	if(QBatch == 1 && N <= 16 && chunk_Nx >= (int)nthread)
+	{
+		return QParallelCells;
+	}
+	return QParallelModes;
+}
+
+void allocCollisionContext(CollisionContext *ctx)														// function to allocate the work arrays of the collision step in ctx (once QMethod & QBatch are set)
+{
+	int proj_size, b, s;																				// declare proj_size (the number of doubles in each of the arrays proj_a & proj_b), b (the index of a cell of a batch) & s (the index of a stage of RK4)
+
+	ctx->temp = (fftw_complex *)fftw_malloc(N*N*(N/2+1)*sizeof(fftw_complex));							// the half spectrum of a real NxNxN array, which is also enough for the array itself with each row padded to 2*(N/2+1) doubles
+	ctx->temp_batch = NULL;
+	if(QBatch > 1)
+	{
+		ctx->temp_batch = (fftw_complex *)fftw_malloc(QBatch*N*N*(N/2+1)*sizeof(fftw_complex));		// a copy of temp for each cell of a batch
+	}
+	ctx->fHat = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	ctx->qHat = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	ctx->Q1_fft = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	ctx->Q2_fft = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	ctx->Q3_fft = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+
+	ctx->qHat_linear = NULL; ctx->Q1_fft_linear = NULL; ctx->Q2_fft_linear = NULL; ctx->Q3_fft_linear = NULL;
+	#ifdef FullandLinear																				// only do this if FullandLinear was defined
+	ctx->qHat_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	ctx->Q1_fft_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	ctx->Q2_fft_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	ctx->Q3_fft_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	#endif
+
+	ctx->Q = (double *)malloc(size_ft*sizeof(double));
+	ctx->f1 = (double *)malloc(size_ft*sizeof(double));
+	ctx->Q1 = (double *)malloc(size_ft*sizeof(double));
+
+	proj_size = 6*N*N*Nv;																				// the largest of the partial sums of ProjectOntoCells: 6N^2Nv doubles after the contraction in v3, 10NNv^2 after v2 & 14Nv^3 after v1
+	if(10*N*Nv*Nv > proj_size)
+	{
+		proj_size = 10*N*Nv*Nv;
+	}
+	if(14*Nv*Nv*Nv > proj_size)
+	{
+		proj_size = 14*Nv*Nv*Nv;
+	}
+	ctx->proj_in = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	ctx->proj_a = (double *)malloc(proj_size*sizeof(double));
+	ctx->proj_b = (double *)malloc(proj_size*sizeof(double));
+	ctx->proj_cells = (double *)malloc(5*size_v*sizeof(double));
+
+	ctx->fHat_batch = NULL; ctx->Q_batch = NULL; ctx->f1_batch = NULL; ctx->Q1_batch = NULL;
+	for(s=0;s<4;s++)
+	{
+		ctx->K_batch[s] = NULL; ctx->K_linear_batch[s] = NULL;
+	}
+	if(QBatch > 1)
+	{
+		ctx->fHat_batch = (fftw_complex **)malloc(QBatch*sizeof(fftw_complex *));
+		ctx->Q_batch = (double **)malloc(QBatch*sizeof(double *));
+		ctx->f1_batch = (double **)malloc(QBatch*sizeof(double *));
+		ctx->Q1_batch = (double **)malloc(QBatch*sizeof(double *));
+		for(s=0;s<4;s++)
+		{
+			ctx->K_batch[s] = (fftw_complex **)malloc(QBatch*sizeof(fftw_complex *));
+			#ifdef FullandLinear																		// only do this if FullandLinear was defined
+			ctx->K_linear_batch[s] = (fftw_complex **)malloc(QBatch*sizeof(fftw_complex *));
+			#endif
+		}
+		for(b=0;b<QBatch;b++)
+		{
+			ctx->fHat_batch[b] = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+			ctx->Q_batch[b] = (double *)malloc(size_ft*sizeof(double));
+			ctx->f1_batch[b] = (double *)malloc(size_ft*sizeof(double));
+			ctx->Q1_batch[b] = (double *)malloc(size_ft*sizeof(double));
+			for(s=0;s<4;s++)
+			{
+				ctx->K_batch[s][b] = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+				if(ctx->K_linear_batch[s] != NULL)
+				{
+					ctx->K_linear_batch[s][b] = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+				}
+			}
+		}
+	}
+
+	ctx->fHat_pad = NULL; ctx->conv_pad = NULL;
+	if(QMethod == QFFT)
+	{
+		ctx->fHat_pad = (fftw_complex *)fftw_malloc(8*size_ft*sizeof(fftw_complex));					// (2N)^3 many complex numbers
+		ctx->conv_pad = (fftw_complex *)fftw_malloc(8*size_ft*sizeof(fftw_complex));
+	}
+}
+
+void freeCollisionContext(CollisionContext *ctx)														// function to delete the work arrays of the collision step in ctx
+{
+	int b, s;																							// declare b (the index of a cell of a batch) & s (the index of a stage of RK4)
+
+	fftw_free(ctx->temp); fftw_free(ctx->fHat);
+	if(ctx->temp_batch != NULL)
+	{
+		fftw_free(ctx->temp_batch);
+	}
+	fftw_free(ctx->qHat); fftw_free(ctx->Q1_fft); fftw_free(ctx->Q2_fft); fftw_free(ctx->Q3_fft);
+	if(ctx->qHat_linear != NULL)
+	{
+		fftw_free(ctx->qHat_linear); fftw_free(ctx->Q1_fft_linear); fftw_free(ctx->Q2_fft_linear); fftw_free(ctx->Q3_fft_linear);
+	}
+	free(ctx->Q); free(ctx->f1); free(ctx->Q1);
+	fftw_free(ctx->proj_in); free(ctx->proj_a); free(ctx->proj_b); free(ctx->proj_cells);
+	if(ctx->fHat_batch != NULL)
+	{
+		for(b=0;b<QBatch;b++)
+		{
+			fftw_free(ctx->fHat_batch[b]); free(ctx->Q_batch[b]); free(ctx->f1_batch[b]); free(ctx->Q1_batch[b]);
+			for(s=0;s<4;s++)
+			{
+				fftw_free(ctx->K_batch[s][b]);
+				if(ctx->K_linear_batch[s] != NULL)
+				{
+					fftw_free(ctx->K_linear_batch[s][b]);
+				}
+			}
+		}
+		for(s=0;s<4;s++)
+		{
+			free(ctx->K_batch[s]);
+			if(ctx->K_linear_batch[s] != NULL)
+			{
+				free(ctx->K_linear_batch[s]);
+			}
+		}
+		free(ctx->fHat_batch); free(ctx->Q_batch); free(ctx->f1_batch); free(ctx->Q1_batch);
+	}
+	if(ctx->fHat_pad != NULL)
+	{
+		fftw_free(ctx->fHat_pad); fftw_free(ctx->conv_pad);
+	}
+}
@@ -0,0 +1,59 @@
+/* This is the header file associated to CollisionContext.cpp in which the record of the work arrays
+ * used by the collision step of one space-step, the prototypes for the functions contained in that file
+ * and the external variables they set are declared.  Only fftw3 is needed for the record, so that
+ * collisionRoutines_1.h can include this file while LP_ompi.h is still including its own headers.
+ *
+ */
+
+//************************//
+//     INCLUDE GUARDS     //
+//************************//
+
+#ifndef COLLISIONCONTEXT_H_
+#define COLLISIONCONTEXT_H_
+
+//************************//
+//        INCLUDES        //
+//************************//
+
+#include <fftw3.h>																					// allows fftw_complex to be used
+
+//************************//
+//    DATA STRUCTURES     //
+//************************//
+
+typedef struct
+{
+	fftw_complex *temp;																					// the work array of fft3D, ifft3D & FS (N*N*(N/2+1) complex numbers, see SpectralTransform.cpp)
+	fftw_complex *temp_batch;																			// the work array of fft3D_Batch & FS_Batch (QBatch copies of temp one after another, NULL unless QBatch > 1)
+	fftw_complex *fHat;																					// the FFT of the solution whose collision operator is being calculated
+	fftw_complex *qHat, *Q1_fft, *Q2_fft, *Q3_fft;														// the FFTs of the collision operator at the four stages of RK4
+	fftw_complex *qHat_linear, *Q1_fft_linear, *Q2_fft_linear, *Q3_fft_linear;							// the same for the linear two species collision operator (NULL unless FullandLinear was defined)
+	double *Q, *f1, *Q1;																				// the collision operator on the velocity grid (for the first stage & the later stages) and the solution advanced by a stage of RK4
+	fftw_complex *fHat_pad, *conv_pad;																	// the (2N)^3 padded arrays used by ComputeQ_FFT (NULL unless QMethod is QFFT)
+	fftw_complex **fHat_batch;																			// the FFTs of the solutions of a batch (QBatch arrays of size_ft complex numbers, NULL unless QBatch > 1)
+	fftw_complex **K_batch[4], **K_linear_batch[4];													// the four stages of RK4_Batch for each cell of a batch (K_linear_batch is NULL unless FullandLinear was defined, and all of them are NULL unless QBatch > 1)
+	double **Q_batch, **f1_batch, **Q1_batch;															// Q, f1 & Q1 for each cell of a batch (NULL unless QBatch > 1)
+	fftw_complex *proj_in;																				// the combination of the stages of RK4 in Fourier space which is projected onto the DG basis
+	double *proj_a, *proj_b;																			// the partial sums of ProjectOntoCells after each 1-D contraction (each proj_size doubles)
+	double *proj_cells;																					// the five integrals of ProjectOntoCells for each velocity cell
+} CollisionContext;
+
+//************************//
+//   EXTERNAL VARIABLES   //
+//************************//
+
+extern CollisionContext *coll_ctx;																		// declare coll_ctx (the work arrays of each of the workers computing collision steps at the same time)
+extern int n_coll_ctx;																					// declare n_coll_ctx (the number of workers, nthread if the space-steps are shared out between the OpenMP threads and 1 otherwise)
+
+//************************//
+//   FUNCTION PROTOTYPES  //
+//************************//
+
+int chooseQParallel(int requested);
+
+void allocCollisionContext(CollisionContext *ctx);
+
+void freeCollisionContext(CollisionContext *ctx);
+
+#endif /* COLLISIONCONTEXT_H_ */
@@ -17,15 +17,73 @@
 
 #include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the EntropyCalculations functions
 #include "advection_1.h"																				// allows the external variables and function prototypes declared in advection_1.h to be used in the EntropyCalculations functions
+#include "CellQuadrature.h"																				// allows integrateRow & integrateCells to be used
 
 //************************//
-//   FUNCTION PROTOTYPES  //
+//    DATA STRUCTURES     //
 //************************//
 
-double computeEntropy(double *U);
+struct EntropyIntegrand																					// the integrand f*log(f) of the entropy in computeDiagnostics, for integrateRow
+{
+	void cell(int)
+	{
+	}
+	double operator()(int, double f_val)
+	{
+		if(f_val > 0)																					// only do this if f > 0 so that the log can be evaluated
+		{
+			return f_val*log(f_val);
+		}
+		return 0.;
+	}
+};
+
+struct RelEntropyIntegrand																										// the integrand f*log(f/f_eq) of computeRelEntropy & of the relative entropy in computeDiagnostics, for integrateCells & integrateRow
+{
+	double *rho_vals, *maxwell_vals;																								// the tables of rho & M at the quadrature nodes of ComputeEquiTables
+	double f_eq[QuadPts];																											// f_eq[q] is the equilibrium at the qth quadrature point of the current cell
+	void cell(int k)																												// set f_eq to the equilibrium rho(x)*M(v1)*M(v2)*M(v3) at the points of the kth cell
+	{
+		int i, j1, j2, j3, nx, nv1, nv2, nv3, q;
+		double f_eq1, f_eq2;																										// declare f_eq1, f_eq2 (to store the equilibrium at the current x, then also v1 & v2 values)
+		i = k/size_v; j1 = (k/(Nv*Nv))%Nv; j2 = (k/Nv)%Nv; j3 = k%Nv;															// k = i*Nv^3 + j1*Nv^2 + j2*Nv + j3
+		q = 0;
+		for(nx=0;nx<QuadNodes;nx++)
+		{
+			for(nv1=0;nv1<QuadNodes;nv1++)
+			{
+				f_eq1 = rho_vals[QuadNodes*i+nx]*maxwell_vals[QuadNodes*j1+nv1];
+				for(nv2=0;nv2<QuadNodes;nv2++)
+				{
+					f_eq2 = f_eq1*maxwell_vals[QuadNodes*j2+nv2];
+					for(nv3=0;nv3<QuadNodes;nv3++)
+					{
+						f_eq[q] = f_eq2*maxwell_vals[QuadNodes*j3+nv3];													// the points are in the order q = nv3 + 5*(nv2 + 5*(nv1 + 5*nx)) of cell_quad
+						q++;
+					}
+				}
+			}
+		}
+	}
+	double operator()(int q, double f_val)
+	{
+		double r;
+		if(f_val > 0)																												// only do this if f > 0 so that the log can be evaluated
+		{
+			r = log(f_val/f_eq[q]);
+			if(isnan(r) == 0)
+			{
+				return f_val*r;
+			}
+		}
+		return 0.;
+	}
+};
 
-double computeEntropy_wAvg(double *AvgVals);
+//************************//
+//   FUNCTION PROTOTYPES  //
+//************************//
 
-double computeRelEntropy(double *U, double *f_equi);
+double computeRelEntropy(double *U, double *rho_vals, double *maxwell_vals);
 
 #endif /* ENTROPYCALCULATIONS_H_ */
@@ -1,7 +1,10 @@
 /* This is the source file which contains the subroutines necessary for constructing an
- * equilibrium solution (necessary for the relative entropy calculations).
+ * equilibrium solution (necessary for the relative entropy calculations).  The equilibrium is never
+ * stored at the points of the quadrature: it is rho(x) times a Maxwellian which is the product of the
+ * same 1-D Gaussian in each velocity component, so computeRelEntropy evaluates it from a table of rho at
+ * the quadrature points in x of each space cell and a table of the 1-D Gaussian at those in v.
  *
- * Functions included: ExportRhoQuadVals, ComputeEquiVals, PrintEquiVals
+ * Functions included: ExportRhoQuadVals, ComputeEquiTables, PrintEquiVals
  *
  *  Created on: Nov 15, 2017
  */
@@ -36,64 +39,36 @@ void ExportRhoQuadVals(double *U)																// function to export the value
 	fclose(rhoeqvals);																			// close the file rhoeqvals
 }
 
-void ComputeEquiVals(double *f)																	// function to compute the equilibrium solution, suitable for Gaussian quadrature and save it in the function f
+int ComputeEquiTables(const char *rho_file, double *rho_vals, double *maxwell_vals)				// function to compute the tables the equilibrium solution is evaluated from at the points of the Gaussian quadrature, storing the density read from the file rho_file in rho_vals (5*Nx doubles) & the 1-D Maxwellian in maxwell_vals (5*Nv doubles), and return 0 (or 1 if the density could not be read)
 {
-
-	int i, j1, j2, j3, iNNN, j1NN, j2N, k, k_equi, nx, nv1, nv2, nv3;							// declare i (the index of the space cell), j1, j2, j3 (the indices of the velocity cell), iNNN (to store i*Nv^3), j1NN (to store j1*Nv^2), j2N (to store j2*Nv), k (the location of the given cell in U), k_equi (the location of the current quadrature point in f_equi), nx (a counter for the space cell) & nv1, nv2, nv3 (counters for the velocity cell)
-	double x_0, v1_0, v2_0, v3_0, x_val, v1_val, v2_val, v3_val;								// declare x_0, v1_0, v2_0, v3_0 (to store the coordinates in the middle of the current cell), x_val, v1_val, v2_val & v3_val (to store the x & v values to be evaluated at)
-	double *rho_vals;																			// declare a pointer to rho_vals (where the values of the density rho at equilibrium will be stored)
-	rho_vals = (double*)malloc(5*Nx*sizeof(double));											// allocate enough space at the pointer rho_vals for 5*Nx many double numbers
+	int j, nv;																					// declare j (the index of the velocity cell in one direction) & nv (a counter for the quadrature points in the velocity cell)
+	size_t n_read;																				// declare n_read (the number of values of the density read from the file)
+	double v_0, v_val;																			// declare v_0 (to store the coordinate in the middle of the current cell) & v_val (to store the v value to be evaluated at)
 	FILE *rhoeqvals;																			// declare a pointer to a file called rhoeqvals
-	rhoeqvals = fopen("Data/RhoEquiVals_nu0.05A0.2k0.5Nx24Lx12.5664Nv24Lv5.25SpectralN16dt0.01nT0_4Hump.dc","r");														// set rhoeqvals to be a file with the name stored in buffer_rhoeq and setthe file access more of rhoeqvals to r (which allows the file to be read from)
-	fread(rho_vals, sizeof(double), 5*Nx, rhoeqvals);											// read from the file rhoeqvals, which contains 5*Nx many entries of the size of a double number and store it rho_vals
-	fclose(rhoeqvals);																			// close the file rhoeqvals
-	/*DEGUG TEST
-	for(i=0;i<5*Nx;i++)
+	rhoeqvals = fopen(rho_file,"r");															// set rhoeqvals to be the file rho_file (written by ExportRhoQuadVals for a run with the same Nx, e.g. Data/RhoEquiVals_..._4Hump.dc) and set the file access mode of rhoeqvals to r (which allows the file to be read from)
+	if(rhoeqvals == NULL)
 	{
-		printf("%g ", rho_vals[i]);
-	}i
-	*/
-	#pragma omp parallel for private(k,k_equi,i,j1,j2,j3,iNNN,j1NN,j2N,nx,nv1,nv2,nv3,x_0,v1_0,v2_0,v3_0,x_val,v1_val,v2_val,v3_val) shared(size_v,Nv,dv,dx,vt,wt,rho_vals,f)
-	for(i=0;i<Nx;i++)																												// loop through the space cells
+		return 1;
+	}
+	n_read = fread(rho_vals, sizeof(double), 5*Nx, rhoeqvals);									// read from the file rhoeqvals, which contains 5*Nx many entries of the size of a double number and store it rho_vals (the density at the five quadrature points in x of each space cell, see ExportRhoQuadVals)
+	fclose(rhoeqvals);																			// close the file rhoeqvals
+	if(n_read != (size_t)(5*Nx))																// the file is too short for this Nx
 	{
-		iNNN = i*size_v;																		// set iNNN to i*Nv^3
-		x_0 = Gridx((double)i);																	// set x_0 to the value of x at the center of the ith space cell
+		return 1;
+	}
 
-		for(j1=0;j1<Nv;j1++)																	// loop through the velocity cells in the v1 direction
+	// THE EQUILIBRIUM rho(x)*exp(-(v1^2+v2^2+v3^2)/(2*T))/(2*T*PI)^(3/2) IS rho(x) TIMES THE PRODUCT OF THE SAME 1-D MAXWELLIAN IN EACH VELOCITY COMPONENT,
+	// SO ONLY ITS VALUES AT THE FIVE QUADRATURE POINTS OF EACH OF THE Nv CELLS IN ONE DIRECTION ARE NEEDED:
+	for(j=0;j<Nv;j++)																			// loop through the velocity cells in one direction
+	{
+		v_0 = Gridv((double)j);																	// set v_0 to the value of v at the center of the jth velocity cell in that direction
+		for(nv=0;nv<5;nv++)																		// loop through the five quadrature points in the velocity cell
 		{
-			j1NN = j1*Nv*Nv;																	// set j1NN to j1*Nv^2
-			v1_0 = Gridv((double)j1);															// set v1_0 to the value of v1 at the center of the j1th velocity cell in that direction
-			for(j2=0;j2<Nv;j2++)																// loop through the velocity cells in the v2 direction
-			{
-				j2N = j2*Nv;																	// set j2N to j2*Nv
-				v2_0 = Gridv((double)j2);														// set v2_0 to the value of v2 at the center of the j2th velocity cell in that direction
-				for(j3=0;j3<Nv;j3++)															// loop through the velocity cells in the v3 direction
-				{
-					k = iNNN + j1NN + j2N + j3;													// set k to i*Nv^3 + j1*Nv^2 + j2*Nv + j3
-					v3_0 = Gridv((double)j3);													// set v3_0 to the value of v3 at the center of the j3th velocity cell in that direction
-					for(nx=0;nx<5;nx++)															// loop through the five quadrature points in the x direction of the cell
-					{
-						x_val = x_0 + 0.5*vt[nx]*dx;											// set x_val to the nx-th quadrature point in the cell
-						for(nv1=0;nv1<5;nv1++)													// loop through the five quadrature points in the v1 direction of the cell
-						{
-							v1_val = v1_0 + 0.5*vt[nv1]*dv;										// set v1_val to the nv1-th quadrature point in the cell
-							for(nv2=0;nv2<5;nv2++)												// loop through the five quadrature points in the v2 direction of the cell
-							{
-								v2_val = v2_0 + 0.5*vt[nv2]*dv;									// set v2_val to the nv2-th quadrature point in the cell
-								for(nv3=0;nv3<5;nv3++)											// loop through the five quadrature points in the v3 direction of the cell
-								{
-									v3_val = v3_0 + 0.5*vt[nv3]*dv;								// set v3_val to the nv3-th quadrature point in the cell
-
-									k_equi = 5*(5*(5*(5*k + nx) + nv1) + nv2) + nv3;			// set k_equi to the location that this value of f should be stored in f
-									f[k_equi] = rho_vals[5*i+nx]*exp(-(v1_val*v1_val+v2_val*v2_val+v3_val*v3_val)/(2.1*2))/(sqrt(2.1*2*PI)*(2.1*2*PI));					// calculate the value of the equilbrium marginal, evaluated at x_val & v1_val by using the function in the space cell i and velocity cell (j1,j2,j3), namely rho_val(x)*exp(-(v1^2+v2^2+v3^2)/(2*T))/(2*T*PI)^(3/2)
-								}
-							}
-						}
-					}
-				}
-			}
+			v_val = v_0 + 0.5*vt[nv]*dv;														// set v_val to the nv-th quadrature point in the cell
+			maxwell_vals[5*j+nv] = exp(-v_val*v_val/(2.1*2))/sqrt(2.1*2*PI);					// calculate the value of the 1-D Maxwellian with temperature T = 2.1, namely exp(-v^2/(2*T))/sqrt(2*T*PI)
 		}
 	}
+	return 0;
 }
 
 void PrintEquiVals(double *U, FILE *margfile)
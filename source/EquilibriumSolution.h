@@ -26,7 +26,7 @@
 
 void ExportRhoQuadVals(double *U);
 
-void ComputeEquiVals(double *f);
+int ComputeEquiTables(const char *rho_file, double *rho_vals, double *maxwell_vals);
 
 void PrintEquiVals(double *U, FILE *margfile);
 
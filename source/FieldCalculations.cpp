@@ -3,7 +3,7 @@
  * problem.
  *
  * Functions included: Gridv, Gridx, rho_x, rho, computePhi_x_0, computePhi, PrintPhiVals, computeC_rho, Int_Int_rho
- * Int_Int_rho1st, Int_E, Int_E1st, Int_E2nd, Int_fE, I1, I2, I3, I5, computeH, RK3
+ * Int_Int_rho1st, Int_E, Int_E1st, Int_E2nd, Int_fE, computeFieldCoeffs, I1, I2, I3, I5, computeH, RK3
  *
  */
 
@@ -296,3 +296,62 @@ double Int_E2nd(double *U, int i) // \int_i E* [(x-x_i)/delta_x]^2 dx
 
     return result;
 }
+
+/*
+function computeFieldCoeffs
+---------------------------
+Calculates ce, cp[i], intE[i], intE1[i] & intE2[i] for every space cell i, giving the same values as
+computePhi_x_0, computeC_rho, Int_E, Int_E1st & Int_E2nd.  Those each sum U over all the earlier space cells
+(and all size_v velocity cells), which makes setting up the field O(Nx^2 Nv^3).  Here U is only summed over
+the velocity cells once, into the two charge moments of each space cell,
+  rhoMoments[2*i] = sum_j U[k*6+0] + U[k*6+5]/4.,  rhoMoments[2*i+1] = sum_j U[k*6+1]  (k = i*size_v + j),
+and the sums over the earlier space cells are then running sums of these (O(Nx) work).  Each MPI process
+sums the space cells i of its own collision chunk (chunk_Nx*myrank_mpi <= i < chunk_Nx*(myrank_mpi+1)) and
+the 2*Nx moments are then added together with one MPI_Allreduce.
+*/
+void computeFieldCoeffs(double *U)
+{
+  int i, j, k, i_start, i_end;
+  double c0, c1, sum_c0, tmp;
+
+#ifdef UseMPI
+  i_start = chunk_Nx*myrank_mpi;
+  i_end = (i_start + chunk_Nx < Nx) ? i_start + chunk_Nx : Nx;
+#else
+  i_start = 0; i_end = Nx;
+#endif
+
+  #pragma omp parallel for private(i, j, k, c0, c1) shared(U, rhoMoments, i_start, i_end)
+  for(i=0;i<Nx;i++){
+    c0 = 0.; c1 = 0.;
+    if(i >= i_start && i < i_end){
+      for(j=0;j<size_v;j++){
+        k = i*size_v + j;
+        c0 += U[k*6+0] + U[k*6+5]/4.;
+        c1 += U[k*6+1];
+      }
+    }
+    rhoMoments[2*i] = c0; rhoMoments[2*i+1] = c1;
+  }
+#ifdef UseMPI
+  MPI_Allreduce(MPI_IN_PLACE, rhoMoments, 2*Nx, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+
+  // RUNNING SUMS OVER THE EARLIER SPACE CELLS (sum_c0 = sum_m<i c0[m], tmp = the sum in Int_E, summed over i for computePhi_x_0):
+  sum_c0 = 0.; tmp = 0.;
+  for(i=0;i<Nx;i++){
+    c0 = rhoMoments[2*i]; c1 = rhoMoments[2*i+1];
+    cp[i] = sum_c0*dx*scalev;
+    intE[i] = sum_c0 + 0.5*c0 - c1/12.;						// the sum in Int_E, turned into intE once ce is known
+    tmp += intE[i];
+    sum_c0 += c0;
+  }
+  ce = 0.5*Lx - tmp*scalev*dx*dx/Lx;
+
+  for(i=0;i<Nx;i++){
+    c0 = rhoMoments[2*i]; c1 = rhoMoments[2*i+1]*dx/2.;
+    intE[i] = -ce*dx - intE[i]*dx*dx*scalev + Gridx((double)i)*dx;
+    intE1[i] = (1-c0*scalev)*dx*dx/12.;
+    intE2[i] = (-cp[i] - ce+scalev*(c0*Gridx(i-0.5) + 0.25*c1))*dx/12. + (1-scalev*c0)*dx*Gridx((double)i)/12. - scalev*c1*dx/80.;
+  }
+}
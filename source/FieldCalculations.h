@@ -47,5 +47,7 @@ double Int_fE(double *U, int i, int j);
 
 double Int_E2nd(double *U, int i);
 
+void computeFieldCoeffs(double *U);
+
 #endif /* FIELDCALCULATIONS_H_ */
 
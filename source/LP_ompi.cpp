@@ -58,59 +58,71 @@ double h_eta, h_v;																					// declare h_eta (the Fourier stepsize) &
 double nu=0.05, dt=0.01, nthread=16; 																// declare nu (1/knudson#) and set it to 0.02, dt (the timestep) and set it to 0.004 & nthread (the number of OpenMP threads) and set it to 16
 #endif
 
+int QMethod=QDirect, QCheck=0, QBatch=1, QParallel=QParallelAuto;									// declare QMethod (the method used for the convolution in ComputeQ) and set it to QDirect (this can be changed with the option -qmethod), QCheck (whether or not to check the method against the matrix-free quadrature at the start of the run) and set it to 0 (this can be changed with the option -qcheck), QBatch (the number of space-steps whose collision steps are computed together) and set it to 1 (this can be changed with the option -qbatch) & QParallel (how the collision steps are shared out between the threads) and set it to QParallelAuto (this can be changed with the option -qparallel)
+int MPIProgress=0;																				// declare MPIProgress (whether or not the master thread polls the ghost exchange of the advection while the interior planes are calculated) and set it to 0 (this can be changed with the option -mpiprogress)
+int MomentStep=1, EntropyStep=1, MarginalStep=20;													// declare MomentStep, EntropyStep & MarginalStep (the number of time-steps between each time the moments, the entropy & the marginals are printed) and set them to 1, 1 & 20 (these can be changed with the options -momentstep, -entropystep & -marginalstep)
+char *RelEntropyFile=NULL;																			// declare RelEntropyFile (the file of the equilibrium density for the relative entropy, written by ExportRhoQuadVals) and set it to NULL, so that the relative entropy is not calculated (this can be changed with the option -relentropy)
+double *proj_modes;																					// declare a pointer to proj_modes (the 1-D integrals in int_modes as a real matrix, so the projection onto the DG basis can be done with dgemm, see generate_proj_modes)
+double *int_modes;																					// declare a pointer to int_modes (the 1-D integrals over each velocity cell which IntModes multiplies together, see generate_int_modes)
+double *conv_coeffs;																				// declare a pointer to conv_coeffs (the 10 coefficients for each omega which determine the convolution weights, used when QMethod is QMatrixFree or QFFT)
+
 double *v, *eta;																					// declare v (the velocity variable) & eta (the Fourier space variable)
 double *wtN;																						// declare wtN (the trapezoidal rule weights to be used)
 double scale, scale3, scaleL=8*Lv*Lv*Lv, scalev=dv*dv*dv;											// declare scale (the 1/sqrt(2pi) factor appearing in Gaussians), scale (the 1/(sqrt(2pi))^3 factor appearing in the Maxwellian), scaleL (the volume of the velocity domain) and set it to 8Lv^3 & scalev (the volume of a discretised velocity element) and set it to dv^3
 double **C1, **C2;																					// declare pointers to matrices C1 (the real part of the conservation matrix C) & C2 (the imaginary part of the conservation matrix C), CCt (of dimension 5x5) & CCt_linear (of dimension 2x2)
 double CCt[5*5], CCt_linear[2*2];																	// declare matrices CCt (C*C^T, for the conservation matrix C) & CCt_linear (C*C^T, for the conservation matrix C, in the two species collision operator)
-double lamb[5], lamb_linear[2];																		// declare the arrays lamb (to hold 5 values) & lamb_linear (to hold 2 values)
-
-double *U1, *Utmp, *output_buffer_vp;//, **H;														// declare pointers to U1, Utmp (both used to help store the values in U, declared later) & output_buffer_vp (a buffer used when sending the data between MPI processes during the VP method)
-double *Q, *f1, *Q1, *Utmp_coll;//*f2, *f3;															// declare pointers to Q (the discretised collision operator), f1 (used to help store the solution during the collisional problem), Q1 (used in calculation of the collision operator) & Utmp_coll (used to store calculations from the RK4 method used in the collisional problem)
-fftw_complex *Q1_fft, *Q2_fft, *Q3_fft;																// declare pointers to the complex numbers Q1_fft, Q2_fft & Q3_fft (involved in storing the FFT of Q)
 
-#ifdef FullandLinear																				// only do this if FullandLinear was defined
-fftw_complex *Q1_fft_linear, *Q2_fft_linear, *Q3_fft_linear;										// declare pointers to the complex numbers Q1_fft_linear, Q2_fft_linear & Q3_fft_linear (involved in storing the FFT of the two species collison operator Q)
-#endif
-
-fftw_complex *fftIn, *fftOut;																		// declare pointers to the FFT variables fftIn (a vector to be to have the FFT applied to it) & fftOut (the output of an FFT)
+double *U1, *Utmp;//, **H;																			// declare pointers to U1 & Utmp (both used to help store the values in U, declared later)
 
 double ce, *cp, *intE, *intE1, *intE2;																// declare ce and pointers to cp, intE, intE1 & intE2 (precomputed quantities for advections)
+double *rhoMoments;																					// declare a pointer to rhoMoments (the sums over the velocity cells of the charge in each space cell, from which computeFieldCoeffs calculates ce, cp, intE, intE1 & intE2)
 
 // SET UP FFT PLANS (WHICH ARE USED MULTIPLE TIMES):
 fftw_plan p_forward; 																				// declare the fftw_plan p_forward (an object which contains all the data which allows fftw3 to compute the FFT)
 fftw_plan p_backward; 																				// declare the fftw_plan p_backward (an object which contains all the data which allows fftw3 to compute the inverse FFT)
-fftw_complex *temp;																					// declare a pointer to complex number temp (a temporary array used when calculating the FFT)
+fftw_plan p_forward_batch, p_backward_batch;														// declare the fftw_plans p_forward_batch & p_backward_batch (the same FFTs as p_forward & p_backward for QBatch cells at once, used by fft3D_Batch & FS_Batch)
+fftw_plan p_forward_pad, p_backward_pad;															// declare the fftw_plans p_forward_pad & p_backward_pad (for the FFT & inverse FFT of size (2N)^3 used by ComputeQ_FFT)
 
 int myrank_mpi, nprocs_mpi, nprocs_Nx;																// declare myrank_mpi (the rank of the current MPI process running), nprocs_mpi (the total number of MPI processes) & nprocs_Nx (the amount of MPI processes used for the collisionless VP problem)
-int chunksize_dg, chunksize_ft, chunk_Nx;															// declare chunksize_dg (the amount of data each processes works on during the DG method in the VP problem), chunksize_ft (the amount of data each process works on during the collisional problem) & chunk_Nx (the number of space-steps sent to each process in the collisional problem)
-
-int *fNegVals;																						// declare fNegVals (to store where DG solution goes negative - a 1 if negative and a 0 if positive)
-double *fAvgVals;																					// declare fAvgVals (to store the average values of f on each cell)
-double *fEquiVals;																					// declare f_equivals (to store the equilibrium solution)
+int chunksize_ft, chunk_Nx;																		// declare chunksize_ft (the amount of data each process works on during the collisional problem) & chunk_Nx (the number of space-steps owned by each process, which it both advects & collides)
 
-int main()
+#ifndef WeightGenerator																				// only do this if WeightGenerator was not defined (otherwise this file is being compiled for the weight generator, whose main is in WeightGenerator.cpp)
+int main(int argc, char *argv[])
 {
-	int i, j, k, j1, j2, j3, l; 																	// declare i, j, k (counters), j1, j2, j3 (velocity space counters) & l (the index of the current DG basis function being integrated against)
+	int i, j, j1, j2, j3, l; 																		// declare i, j (counters), j1, j2, j3 (velocity space counters) & l (the index of the current DG basis function being integrated against)
 	int  tp, t=0; 																					// declare tp (the amount size of the data which stores the DG coefficients of the solution read from a previous run) & t (the current time-step) and set it to 0
-	int k_v, k_eta, k_local, nprocs_vlasov;															// declare k_v (the index of a DG coefficient), k_eta (the index of a DG coefficient in Fourier space), k_local (the index of a DG coefficient, local to the space chunk on the current process) & nprocs_vlasov (the number of processes used for solving the Vlasov equation)
-	double tmp, mass, a[3], KiE, EleE, KiEratio, ent1, l_ent1, ll_ent1;								// declare tmp (the square root of electric energy), mass (the mass/density rho), a (the momentum vector J), KiE (the kinetic energy), EleE (the electric energy), KiEratio (the ratio of kinetic energy between where f is positive and negative),  ent1 (the entropy with negatives discarded), l_ent1 (log of the ent1) & ll_ent1 (log of log of ent1)
-	double *U, **f, *output_buffer;//, **conv_weights_local;										// declare pointers to U (the vector containing the coefficients of the DG basis functions for the solution f(x,v,t) at the given time t), f (the solution which has been transformed from the DG discretisation to the appropriate spectral discretisation) & output_buffer (from where to send MPI messages)
+	int n_batch;																					// declare n_batch (the number of space-steps in the current batch of collision steps)
+	int k_eta, nprocs_vlasov;																		// declare k_eta (the index of a DG coefficient in Fourier space) & nprocs_vlasov (the number of processes used for solving the Vlasov equation)
+	int moment_step, entropy_step, marginal_step;													// declare moment_step, entropy_step & marginal_step (whether or not the moments, the entropy & the marginals are printed at the current time-step)
+	double tmp, l_ent1, ll_ent1;																	// declare tmp (the square root of electric energy), l_ent1 (log of the entropy) & ll_ent1 (log of log of the entropy)
+	RelEntropyIntegrand rel_entropy, *rel_entropy_used=NULL;										// declare rel_entropy (the integrand f*log(f/f_eq) with the tables of the equilibrium f_eq read from RelEntropyFile) & rel_entropy_used (a pointer to it if the relative entropy was asked for and NULL otherwise)
+	Diagnostics diag;																				// declare diag (the mass, momentum, kinetic energy, electric energy, entropy with negatives discarded & the ratio of kinetic energy between where f is negative and positive, computed by computeDiagnostics)
+	double *U, **f;//, **conv_weights_local;														// declare pointers to U (the vector containing the coefficients of the DG basis functions for the solution f(x,v,t) at the given time t) & f (the solution which has been transformed from the DG discretisation to the appropriate spectral discretisation)
+	double *U_block, *U1_block;																		// declare pointers to U_block & U1_block (the blocks allocated for U & U1 by allocSlab, which are what must be freed)
 	double **conv_weights, **conv_weights_linear;													// declare a pointer to conv_weights (a matrix of the weights for the convolution in Fourier space of single species collisions) conv_weights_linear (a matrix of convolution weights in Fourier space of two species collisions)
-  
-	fftw_complex *qHat, *qHat_linear;																// declare pointers to the complex numbers qHat (the DFT of Q) & qHat_linear (the DFT of the two species colission operator Q);
+	WeightStorage weights_storage;																	// declare weights_storage (where the weights in conv_weights are stored: either a weight cache file mapped into memory or a shared window on each node)
+	#ifdef FullandLinear																			// only do this if FullandLinear was defined
+	WeightStorage weights_storage_linear;															// declare weights_storage_linear (where the weights in conv_weights_linear are stored, as for weights_storage)
+	#endif
+	int l_end;																						// declare l_end (the end of the chunk of space for this process)
+	CollisionContext *ctx;																			// declare a pointer to ctx (the work arrays of the collision step being computed by the current thread)
   
 	//************************
 	//MPI-related variables!
 	//************************
-	int required=MPI_THREAD_MULTIPLE;																// declare required and set it to MPI_THREAD_MULTIPLE (so that in the hybrid OpenMP/MPI routines, multiple threads may call MPI, with no restrictions)           . MPI_THREAD_SERIALIZED; // Required level of MPI threading support
+	#ifdef UseMPI
+	int required=MPI_THREAD_FUNNELED;																// declare required and set it to MPI_THREAD_FUNNELED (in the hybrid OpenMP/MPI routines only the master thread calls MPI: the ghost exchanges, MPI_Testall with -mpiprogress & the reductions are all made outside, or by the master thread of, the parallel regions)
 	int provided;                       															// declare provided (the actual provided level of MPI thread support)
-	MPI_Status status;																				// declare status (to store any status required for MPI operations)
 
-	MPI_Init_thread(NULL, NULL, required, &provided);												// initialise the hybrid MPI & OpenMP environment, requesting the level of thread support to be required and store the actual thread support provided in provided
+	MPI_Init_thread(&argc, &argv, required, &provided);												// initialise the hybrid MPI & OpenMP environment, requesting the level of thread support to be required and store the actual thread support provided in provided
 	MPI_Comm_rank(MPI_COMM_WORLD, &myrank_mpi);														// store the rank of the current process in the MPI_COMM_WORLD communicator in myrank_mpi
 	MPI_Comm_size(MPI_COMM_WORLD, &nprocs_mpi);														// store the total number of processes running in the MPI_COMM_WORLD communicator in nprocs_mpi
+	#else
+	myrank_mpi = 0; nprocs_mpi = 1;																	// without MPI there is a single process, which owns every space cell
+	#endif
+	readRunOptions(argc, argv);																		// set any of the choices which were given on the command line (e.g. -qmethod)
   
+	#ifdef UseMPI
 	// CHECK THE LEVEL OF THREAD SUPPORT:
 	if (provided < required)																		// only do this if the required thread support was not possible
 	{
@@ -126,21 +138,13 @@ int main()
 	{
 		omp_set_num_threads(nthread);																// if the thread support required is possible, set the number of OpenMP threads to nthread
 	}
+	#else
+	omp_set_num_threads(nthread);																	// set the number of OpenMP threads to nthread
+	#endif
    
 	double MPIt1, MPIt2, MPIelapsed;																// declare MPIt1 (the start time of an MPI operation), MPIt2 (the end time of an MPI operation) and MPIelapsed (the total time for the MPI operation)
 
-	if(size_v%nprocs_mpi != 0)																		// check that size_v/nprocs_mpi has no remainder
-	{
-		if (myrank_mpi==0)
-		{
-			printf("Error: There must be integer number of chunks\n");								// if nprocs_mpi isn't a factor of size_v then display this in the output file
-		}
-		MPI_Finalize();																				// ensure that MPI exits cleanly
-		exit(0);
-	}
-
-	chunksize_dg = size/nprocs_mpi;																	// set chunksize_dg to size/nprocs_mpi (which will be an integer since nprocs_mpi is a facot of size_v and size = Nx*size_v)
-	chunksize_ft = size_ft/nprocs_mpi; 																// set chunksize_ft to size_ft/nprocs_mpi
+	chunksize_ft = size_ft/nprocs_mpi; 																// set chunksize_ft to size_ft/nprocs_mpi (only used by the ComputeQ of MPI_parallelcollision; the rows of the weights are shared out by loadConvWeights, which allows any number of processes)
 
 	if(Nx%nprocs_mpi == 0)
 	{
@@ -151,23 +155,43 @@ int main()
 		chunk_Nx = Nx/nprocs_mpi + 1;																// if nprocs_mpi does not divide into Nx, set chunk_Nx to Nx/nprocs_mpi + 1
 	}
 
+	if(QBatch > chunk_Nx)
+	{
+		QBatch = chunk_Nx;																			// a batch can't hold more than the chunk of space of a process (this is how -qbatch all batches the whole chunk)
+	}
+
 	nprocs_Nx = (int)((double)Nx/(double)chunk_Nx + 0.5);											// set nprocs_Nx to Nx/chunk_Nx + 0.5 and store the result as an integer
 
-	U = (double*)malloc(size*6*sizeof(double));														// allocate enough space at the pointer U for 6*size many double numbers
-	U1 = (double*)malloc(size*6*sizeof(double));													// allocate enough space at the pointer U1 for 6*size many floating point numbers
+	U = allocSlab(&U_block);																		// allocate the planes of U stored by this process (every plane on the process with rank 0, otherwise its slab of chunk_Nx space cells & the two ghost planes next to it), storing the allocated block in U_block
+	U1 = allocSlab(&U1_block);																		// allocate the planes of U1 stored by this process in the same way, storing the allocated block in U1_block
  
-	Utmp = (double*)malloc(chunksize_dg*6*sizeof(double));											// allocate enough space at the pointer Utmp for 6*chunksize_dg many floating point numbers
+	Utmp = (double*)malloc(chunk_Nx*size_v*6*sizeof(double));										// allocate enough space at the pointer Utmp for the 6 coefficients of each cell in the slab of chunk_Nx space cells advected by this process
 	// H[i] = (double*)malloc(6*sizeof(double));}
-	output_buffer_vp = (double *) malloc(chunksize_dg*6*sizeof(double));							// allocate enough space at the pointer output_buffer_vp for 6*chunksize_dg many floating point numbers
   
 	cp = (double*)malloc(Nx*sizeof(double));														// allocate enough space at the pointer cp for Nx many double numbers
 	intE = (double*)malloc(Nx*sizeof(double));														// allocate enough space at the pointer intE for Nx many double numbers
 	intE1 = (double*)malloc(Nx*sizeof(double));														// allocate enough space at the pointer intE1 for Nx many double numbers
 	intE2 = (double*)malloc(Nx*sizeof(double));														// allocate enough space at the pointer intE2 for Nx many double numbers
+	rhoMoments = (double*)malloc(2*Nx*sizeof(double));												// allocate enough space at the pointer rhoMoments for 2*Nx many double numbers
 
-	fNegVals = (int*)malloc(size*sizeof(int));														// allocate enough space at the pointer fNegVals for size many integers
-	fAvgVals = (double*)malloc(size*sizeof(double));												// allocate enough space at the pointer fAvgVals for size many doubles
-	fEquiVals = (double*)malloc(5*5*5*5*size*sizeof(double));										// allocate enough space at the pointer fEquiVals for 5*Nx*(5*Nv)^3 many doubles
+	initCellQuadrature(&cell_quad);																	// compute the values of the basis functions & the weights at the quadrature points of a cell once, for the diagnostics
+	if(RelEntropyFile != NULL)																		// only do this if the relative entropy was asked for with the option -relentropy
+	{
+		rel_entropy.rho_vals = (double*)malloc(QuadNodes*Nx*sizeof(double));						// allocate enough space at the pointer rho_vals for the equilibrium density at the QuadNodes quadrature points in x of each space cell
+		rel_entropy.maxwell_vals = (double*)malloc(QuadNodes*Nv*sizeof(double));					// allocate enough space at the pointer maxwell_vals for the 1-D Maxwellian at the QuadNodes quadrature points of each velocity cell in one direction
+		if(ComputeEquiTables(RelEntropyFile, rel_entropy.rho_vals, rel_entropy.maxwell_vals) != 0)	// every process reads the tables, since each one integrates its own space cells
+		{
+			if(myrank_mpi == 0)
+			{
+				printf("Error: could not read the equilibrium density for the option -relentropy from %s. \n", RelEntropyFile);
+			}
+			#ifdef UseMPI
+			MPI_Finalize();																			// ensure that MPI exits cleanly
+			#endif
+			exit(1);
+		}
+		rel_entropy_used = &rel_entropy;
+	}
 
 	if(nu > 0.)
 	{
@@ -183,139 +207,113 @@ int main()
 		{
 			f[i] = (double *)malloc(size_ft*sizeof(double));										// allocate enough space at the ith entry of f for size_ft many double numbers
 		}
-		conv_weights = (double **)malloc(size_ft*sizeof(double *));									// allocate enough space at the pointer conv_weights for size_ft many pointers to float numbers
-		for (i=0;i<size_ft;i++)
-		{
-			conv_weights[i] = (double *)malloc(size_ft*sizeof(double));								// allocate enough space at the ith entry of conv_weights for size_ft many float numbers
-		}
+		conv_weights = (double **)malloc(size_ft*sizeof(double *));									// allocate enough space at the pointer conv_weights for size_ft many pointers to float numbers (the rows themselves are set up by loadConvWeights)
 
 		#ifdef FullandLinear																		// only do this if FullandLinear was defined
-		conv_weights_linear = (double **)malloc(size_ft*sizeof(double *));							// allocate enough space at the pointer conv_weight_linear for size_ft many pointers to float numbers
-		for (i=0;i<size_ft;i++)
-		{
-			conv_weights_linear[i] = (double *)malloc(size_ft*sizeof(double));						// allocate enough space at the ith entry of conv_weights_linear for size_ft many float numbers
-		}
-  
-		Q1_fft_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));					// allocate enough space at the pointer Q1_fft_linear for size_ft many complex numbers
-		Q2_fft_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));					// allocate enough space at the pointer Q2_fft_linear for size_ft many complex numbers
-		Q3_fft_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));					// allocate enough space at the pointer Q3_fft_linear for size_ft many complex numbers
-  
-		qHat_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));					// allocate enough space at the pointer QHat_linear for size_ft many complex numbers
+		conv_weights_linear = (double **)malloc(size_ft*sizeof(double *));							// allocate enough space at the pointer conv_weight_linear for size_ft many pointers to float numbers (the rows themselves are set up by loadConvWeights)
 		#endif
-
-		Q = (double*)malloc(size_ft*sizeof(double));												// allocate enough space at the pointer Q for size_ft many double numbers
-		f1 = (double*)malloc(size_ft*sizeof(double)); 												// allocate enough space at the pointer f1 for size_ft many double numbers
-		Q1 = (double*)malloc(size_ft*sizeof(double));												// allocate enough space at the pointer Q1 for size_ft many double numbers
-		Utmp_coll = (double*)malloc(chunk_Nx*size_v*5*sizeof(double));								// allocate enough space at the pointer Utmp_coll for 5*chunk_Nx*size_v many double numbers
-		output_buffer = (double*)malloc(chunk_Nx*size_v*5*sizeof(double));							// allocate enough space at the pointer output_buffer for 5*chunk_Nx*size_v many double numbers
   
 		//f2 = (double *)malloc(size_ft*sizeof(double));
 		//Q2 = (double *)malloc(N*N*N*sizeof(double));
 		//f3 = (double *)malloc(size_ft*sizeof(double));
 		//Q3 = (double *)malloc(N*N*N*sizeof(double));
 
-		temp = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));							// allocate enough space at the pointer temp for size_ft many complex numbers
-		//qHat_local = (fftw_complex *)fftw_malloc(chunksize_ft*sizeof(fftw_complex));
-		qHat = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));							// allocate enough space at the pointer qHat for size_ft many complex numbers
+		// SET UP THE WORK ARRAYS OF THE COLLISION STEP, ONE SET FOR EACH THREAD IF THE THREADS EACH TAKE THEIR OWN SPACE-STEPS:
+		QParallel = chooseQParallel(QParallel);														// resolve QParallelAuto into QParallelCells or QParallelModes
+		n_coll_ctx = (QParallel == QParallelCells) ? (int)nthread : 1;								// set n_coll_ctx to the number of collision steps which can be computed at the same time
+		coll_ctx = (CollisionContext *)malloc(n_coll_ctx*sizeof(CollisionContext));					// allocate enough space at the pointer coll_ctx for n_coll_ctx many CollisionContexts
+		for(i=0;i<n_coll_ctx;i++)
+		{
+			allocCollisionContext(&coll_ctx[i]);													// allocate the work arrays of the i-th context (temp, fHat, the stages of RK4, the arrays of each cell of a batch and, for QFFT, the padded arrays)
+		}
+		if(myrank_mpi == 0)
+		{
+			printf("Sharing out the collision steps between the threads by %s. \n", QParallelName(QParallel));
+		}
+		if(QParallel == QParallelCells)
+		{
+			omp_set_max_active_levels(1);															// the OpenMP loops inside a collision step are then nested inside the loop over the space-steps, so make sure they run on the thread computing that step alone
+		}
   
 		// INITIALISE FFTW FOR USE WITH THREADING (MUST BE DONE BEFORE ANY PLAN IS CREATED):
 		fftw_init_threads();																		// initialise the environment for using the fftw3 routines with multiple threads
-		fftw_plan_with_nthreads(nthread);															// set the number of threads used by fftw3 routines to nthread
-
-		// SET UP PLANS FOR FFTs (EXECUTED BY USING nThreads):
-		p_forward = fftw_plan_dft_3d (N, N, N, temp, temp, FFTW_FORWARD, FFTW_MEASURE);				// set p_forward to a 3D fftw plan of dimension NxNxN, which will take the FFT of the vector in temp, store the result back in temp, set the sign to FFTW_FORWARD (so that this is an FFT) and set the flag to FFT_MEASURE so that at this stage fftw3 finds the most efficient way to compute the FFT of this size
-		p_backward = fftw_plan_dft_3d (N, N, N, temp, temp, FFTW_BACKWARD, FFTW_MEASURE);			// set p_backward to a 3D fftw plan of dimension NxNxN, which will take the FFT of the vector in temp, store the result back in temp, set the sign to FFTW_BACKWARD (so that this is an inverse FFT) and set the flag to FFT_MEASURE so that at this stage fftw3 finds the most efficient way to compute the FFT of this size
+		fftw_plan_with_nthreads((QParallel == QParallelCells) ? 1 : nthread);						// set the number of threads used by fftw3 routines to nthread (or to 1 if each thread computes its own collision steps, with its own FFTs)
+
+		// SET UP PLANS FOR FFTs (EXECUTED BY USING nThreads), ON THE ARRAYS OF THE FIRST CONTEXT (THEY ARE EXECUTED ON THE ARRAYS OF EACH CONTEXT WITH THE NEW-ARRAY EXECUTE FUNCTIONS):
+		int n_fft[3] = {N, N, N};																	// declare n_fft (the dimensions of the real-to-complex & complex-to-real FFTs)
+		int n_real[3] = {N, N, 2*(N/2+1)};															// declare n_real (the dimensions of the real data stored in place in temp, with each row padded to 2*(N/2+1) doubles)
+		int n_half[3] = {N, N, N/2+1};																// declare n_half (the dimensions of the half spectrum stored in temp)
+		p_forward = fftw_plan_many_dft_r2c(3, n_fft, 1, (double *)coll_ctx[0].temp, n_real, 1, 0, coll_ctx[0].temp, n_half, 1, 0, FFTW_MEASURE);	// set p_forward to a 3D real-to-complex fftw plan of dimension NxNxN, which will take the FFT of the real vector stored in place in temp, store the half spectrum back in temp and set the flag to FFT_MEASURE so that at this stage fftw3 finds the most efficient way to compute the FFT of this size
+		p_backward = fftw_plan_many_dft_c2r(3, n_fft, 1, coll_ctx[0].temp, n_half, 1, 0, (double *)coll_ctx[0].temp, n_real, 1, 0, FFTW_MEASURE);	// set p_backward to a 3D complex-to-real fftw plan of dimension NxNxN, which will take the inverse FFT of the half spectrum in temp and store the real result back in place in temp (so the half spectrum must be hermitian, see hermitianHalf)
+		if(QBatch > 1)
+		{
+			p_forward_batch = fftw_plan_many_dft_r2c(3, n_fft, QBatch, (double *)coll_ctx[0].temp_batch, n_real, 1, 2*N*N*(N/2+1), coll_ctx[0].temp_batch, n_half, 1, N*N*(N/2+1), FFTW_MEASURE);	// set p_forward_batch to QBatch of the FFTs of p_forward, for the cells stored one after another in temp_batch (each taking up as much space as temp)
+			p_backward_batch = fftw_plan_many_dft_c2r(3, n_fft, QBatch, coll_ctx[0].temp_batch, n_half, 1, N*N*(N/2+1), (double *)coll_ctx[0].temp_batch, n_real, 1, 2*N*N*(N/2+1), FFTW_MEASURE);	// set p_backward_batch to QBatch of the inverse FFTs of p_backward, in place in temp_batch
+		}
+		if(QMethod == QFFT)
+		{
+			p_forward_pad = fftw_plan_dft_3d (2*N, 2*N, 2*N, coll_ctx[0].conv_pad, coll_ctx[0].conv_pad, FFTW_FORWARD, FFTW_MEASURE);		// set p_forward_pad to a 3D fftw plan of dimension 2Nx2Nx2N, which will take the FFT of the vector in conv_pad in place (and is also applied to fHat_pad with fftw_execute_dft)
+			p_backward_pad = fftw_plan_dft_3d (2*N, 2*N, 2*N, coll_ctx[0].conv_pad, coll_ctx[0].conv_pad, FFTW_BACKWARD, FFTW_MEASURE);	// set p_backward_pad to a 3D fftw plan of dimension 2Nx2Nx2N, which will take the inverse FFT of the vector in conv_pad in place
+		}
 
 		wtN = (double *)malloc(N*sizeof(double));													// allocate enough space at the pointer wtN to store N many double numbers
 		v = (double *)malloc(N*sizeof(double));														// allocate enough space at the pointer v to store N many double numbers
 		eta = (double *)malloc(N*sizeof(double));													// allocate enough space at the pointer eta to store N many double numbers
+
   
-		Q1_fft = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));							// allocate enough space at the pointer Q1_fft for size_ft many complex numbers
-		Q2_fft = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));							// allocate enough space at the pointer Q2_fft for size_ft many complex numbers
-		Q3_fft = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));							// allocate enough space at the pointer Q3_fft for size_ft many complex numbers
-  
-		fftOut = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));							// allocate enough space at the pointer fftOut for size_ft many complex numbers
-		fftIn = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));							// allocate enough space at the pointer fftIn for size_ft many complex numbers
- 
-  
-		char buffer_weights[100], loading_buffer[100];												// declare the arrays buffer_weights (to store a string which displays the values of N & L_v) & loading_buffer (...?)
-		sprintf(buffer_weights,"Weights/N%d_L%g_Landau.wts",N,L_v);									// store the values of N & L_v in buffer_weights
+		char buffer_weights[100];																	// declare the array buffer_weights (to store the name of the weight cache file, which displays the values of N, L_v & R_v)
 		#ifdef FullandLinear																		// only do this if Fullandlinear was defined
-		char buffer_weights1[100];																	// declare the array buffer_weights1 (to store a string which displays the values of N & L_v for the linear case)
-		sprintf(buffer_weights1,"Weights/N%d_L%g_Landau_linear.wts",N,L_v);							// store the values of N & L_v in buffer_weights1 and note that it's for the linear Landau damping
+		char buffer_weights1[100];																	// declare the array buffer_weights1 (to store the name of the weight cache file for the linear case)
 		#endif
 
-		// COMMONLY USED CONSTANTS:
-		scale = 1.0/sqrt(2.0*M_PI);																	// set scale to 1/sqrt(2*pi)
-		scale3 = pow(scale, 3.0);																	// set scale3 to scale^3
-
-		//INITIALISE VELOCITY AND FOURIER DOMAINS:
-		L_v = Lv;//sqrt(0.5*(double)N*PI); 															// set L_v to Lv
-		L_eta = 0.5*(double)(N-1)*PI/L_v;					// BUG: N-1?							// set L_eta to (N-1)*Pi/(2*L_v)
-		h_v = 2.0*L_v/(double)(N-1);						// BUG: N-1?							// set h_v to 2*L_v/(N-1)
-		h_eta = 2.0*L_eta/(double)(N);						// BUG: N?								// set h_eta to 2*L_eta/N
-		for(i=0;i<N;i++)																			// store the discretised velocity and Fourier space points
-		{
-			eta[i] = -L_eta + (double)i*h_eta;														// set the ith value of eta to -L_eta + i*h_eta
-			v[i] = -L_v + (double)i*h_v;															// set the ith value of v to -L_v + i*h_v
-		}
-
-		trapezoidalRule(N, wtN);																	// set wtN to the weights required for a trapezoidal rule with N points
+		setSpectralDomains();																		// set scale, scale3, L_v, L_eta, h_v, h_eta and the discretised velocity & Fourier domains v & eta, with the trapezoidal weights wtN
+		initSpectralTransform(&spectral);															// compute the phase shifts & quadrature weights of fft3D, ifft3D & FS once
+		int_modes = (double *)malloc(3*N*Nv*2*sizeof(double));										// allocate enough space at the pointer int_modes for the real & imaginary parts of 3 moments for each of the N*Nv pairs (k, j)
+		generate_int_modes(int_modes);																// compute the 1-D integrals used by IntModes in the projection onto the DG basis once
+		proj_modes = (double *)malloc(2*N*6*Nv*sizeof(double));										// allocate enough space at the pointer proj_modes for a 2N x 6Nv real matrix
+		generate_proj_modes(int_modes, proj_modes);													// store the same integrals as the matrix used by ProjectOntoCells
   
 		createCCtAndPivot();																		// calculate the values of the conservation matrices
 
-		FILE *fidWeights;																			// declare a pointer to the file fidWeights (which will store the precomputed weights in Fourier transform of Q)
-		//check to see if these convolution weights have already been pre-computed
-		/*if(myrank_mpi==0){
-		if(fidWeights = fopen(buffer_weights,"r")) { //checks if we've already stored a file
-		printf("Stored weights found. Reading in weights... \n");
-			for(i=0;i<size_ft;i++)
+		if(myrank_mpi == 0)
+		{
+			printf("Computing the collision operator with the %s method. \n", QMethodName(QMethod));
+		}
+		if(QMethod == QMatrixFree || QMethod == QFFT || QCheck)
+		{
+			// ONLY THE 10 COEFFICIENTS PER OMEGA ARE NEEDED, SINCE ComputeQ REBUILDS EACH WEIGHT (OR EACH CONVOLUTION) FROM THEM (checkComputeQ ALSO USES THEM FOR THE QUADRATURE IT COMPARES WITH):
+			conv_coeffs = (double *)malloc(10*size_ft*sizeof(double));								// allocate enough space at the pointer conv_coeffs for 10*size_ft many double numbers
+			generate_conv_coeffs(conv_coeffs);														// calculate the coefficients which determine the convolution weights for each omega (for both the full and linear cases) and store them in conv_coeffs
+		}
+		if(QMethod == QSymmetric)
+		{
+			// ONLY ONE ROW OF WEIGHTS IS NEEDED FOR EACH ORBIT OF xi UNDER THE SYMMETRIES OF THE WEIGHTS:
+			buildWeightSymmetry(&conv_weights_sym);													// choose the representative of each orbit of xi and the symmetries relating them
+			generateSymWeights(&conv_weights_sym, WeightsFull);										// calculate the weights for the single species collision operator for each representative
+			#ifdef FullandLinear																	// only do this FullandLinear was defined
+			generateSymWeights(&conv_weights_sym, WeightsLinear);									// calculate the weights for the linear two species collision operator for each representative
+			#endif
+			if(myrank_mpi == 0)
 			{
-				tp=fread(conv_weights[i], sizeof(double), size_ft, fidWeights);
-				if(tp != size_ft){printf("reaing error! tp=%d\n", tp);exit(0);}
-			}
-		  fclose(fidWeights);
-			}
-			else {
-		  printf("Stored weights NOT found. Please go back and launch MPI_WeightGenerator. \n");
-		  MPI_Finalize();
-		  exit (1);
+				printf("Stored %d rows of %d weights for the %d values of xi (%.1f times fewer weights than conv_weights). \n",
+							conv_weights_sym.n_rows, conv_weights_sym.size_ext, size_ft, (double)size_ft*size_ft/((double)conv_weights_sym.n_rows*conv_weights_sym.size_ext));
 			}
-		  }
-
-		  for(k=0;k<size_ft;k++)MPI_Bcast(conv_weights[k], size_ft, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-	  MPI_Barrier(MPI_COMM_WORLD);
-  
-		  #ifdef FullandLinear
-		  FILE *fidWeights1;
-		  if(myrank_mpi==0){
-			if(fidWeights1 = fopen(buffer_weights1,"r")) { //checks if we've already stored a file
-		  printf("Stored weights found. Reading in weights... \n");
-		  for(i=0;i<size_ft;i++) {
-			tp=fread(conv_weights_linear[i], sizeof(double), size_ft, fidWeights1);
-			if(tp != size_ft){printf("reaing error! tp=%d\n", tp);exit(0);}
-		  }
-		  fclose(fidWeights1);
-			}
-			else {
-			  printf("Stored weights NOT found. Please go back and launch MPI_WeightGenerator. \n");
-			  MPI_Finalize();
-			  exit (1);
-			}
-		  }
-  
-		  for(k=0;k<size_ft;k++)MPI_Bcast(conv_weights_linear[k], size_ft, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-		MPI_Barrier(MPI_COMM_WORLD);
-		  #endif
-		 */
-  
-		// Directly compute the weights; not from precomputed (for small number of nodes, it's very fast)
-		generate_conv_weights(conv_weights); 														// calculate the values of the convolution weights (the matrix G_Hat(xi, omega), for xi = (xi_i, xi_j, xi_k), omega = (omega_l, omega_m, omega_n), i,j,k,l,m,n = 0,1,...,N-1) and store the values in conv_weights
-		#ifdef FullandLinear																		// only do this FullandLinear was defined
-		generate_conv_weights_linear(conv_weights_linear);											// calculate the values of the convolution weights for the linear case (the matrix G_Hat(xi, omega), for xi = (xi_i, xi_j, xi_k), omega = (omega_l, omega_m, omega_n), i,j,k,l,m,n = 0,1,...,N-1) and store the values in conv_weights_linear
-		#endif
+		}
+		else if(QMethod == QDirect)
+		{
+			// USE THE CONVOLUTION WEIGHTS STORED IN Weights (BY THE WEIGHT GENERATOR OR A PREVIOUS RUN) IF THEY MATCH THIS N, L_v & R_v, OTHERWISE COMPUTE THEM DIRECTLY AND STORE THEM FOR NEXT TIME:
+			weightCacheName(buffer_weights, WeightsFull);											// store the name of the weight cache file, with the values of N, L_v & R_v, in buffer_weights
+			loadConvWeights(buffer_weights, WeightsFull, conv_weights, &weights_storage);			// map the weights in the file buffer_weights read-only into conv_weights (or calculate the values of the convolution weights once per node and store them in conv_weights), recording where they are in weights_storage
+			#ifdef FullandLinear																	// only do this FullandLinear was defined
+			weightCacheName(buffer_weights1, WeightsLinear);										// store the name of the weight cache file for the linear case, with the values of N, L_v & R_v, in buffer_weights1
+			loadConvWeights(buffer_weights1, WeightsLinear, conv_weights_linear,
+												&weights_storage_linear);							// map the weights in the file buffer_weights1 read-only into conv_weights_linear (or calculate the values of the convolution weights for the linear case once per node and store them in conv_weights_linear), recording where they are in weights_storage_linear
+			#endif
+		}
 
+		#ifdef UseMPI
 		MPI_Barrier(MPI_COMM_WORLD);																// set an MPI barrier to ensure that all processes have reached this point before continuing
+		#endif
 	}
 
 	char buffer_moment[100], buffer_u[100], buffer_ufull[100], buffer_flags[100],
@@ -337,6 +335,8 @@ int main()
 					nu, A_amp, k_wave, Nx, Lx, Nv, Lv, N, dt, nT, buffer_flags);					// create a .dc file name, located in the directory Data, whose name is EntropyVals_ followed by the values of nu, A_amp, k_wave, Nx, Lx, Nv, Lv, N, dt, nT and the contents of buffer_flags and store it in buffer_moment
 
 	#ifdef First																					// only do this if First was defined (setting initial conditions)
+	if(myrank_mpi==0)																				// only the process with rank 0 will do this (as only it stores every space cell)
+	{
 		#ifdef Damping																				// only do this if Damping was defined
 		SetInit_LD(U);																				// set initial DG solution for Landau Damping. For the first time run t=0, use this to give init solution (otherwise, comment out)
 		#endif
@@ -349,6 +349,7 @@ int main()
 		#ifdef TwoHump																				// only do this if TwoHump was defined
 		SetInit_2H(U);																				// set initial DG solution with the 2Hump IC. For the first time run t=0, use this to give init solution (otherwise, comment out)
 		#endif
+	}
 	#endif
 
 	FILE *fmom, *fu, *fufull, *fmarg, *fphi, *fent;													// declare pointers to the files fmom (which will store the moments), fu (which will store the solution U), fufull (which will store the solution U in the TwoStream case), fmarg (which will store the values of the marginals), fphi (which will store the values of the potential phi) & fent (which will store the values fo the entropy)
@@ -408,43 +409,6 @@ int main()
 		fphi=fopen(buffer_phi,"w");																	// set fphi to be a file with the name stored in buffer_phi and set the file access mode of fphi to w (which creates an empty file and allows it to be written to)
 		fent=fopen(buffer_ent,"w");																	// set fent to be a file with the name stored in buffer_ent and set the file access mode of fent to w (which creates an empty file and allows it to be written to)
 
-		FindNegVals(U, fNegVals, fAvgVals);															// find out in which cells the approximate solution goes negative and record it in fNegVals
-
-		/* DEBUG TEST
-		for(int i=0;i<Nx;i++)
-		{
-			printf("i = %d: ", i);
-			for(int j1=0;j1<Nv;j1++)
-			{
-				for(int j2=0;j2<Nv;j2++)
-				{
-					for(int j3=0;j3<Nv;j3++)
-					{
-						printf("%g ", fEquiVals[5*(5*(5*(5*(i*size_v + j1*Nv*Nv+j2*Nv+j3)+2) + 2) + 2) + 2]);
-					}
-				}
-			}
-			printf("\n");
-		}
-		*/
-
-		mass=computeMass(U);																		// set mass to the value calculated through computeMass, for the solution f(x,v,t) at the current time t, using its DG coefficients stored U
-		computeMomentum(U, a);																		// calculate the momentum for the solution f(x,v,t) at the current time t, using its DG coefficients stored U, and store it in a
-		KiE=computeKiE(U);																			// set KiE to the value calculated through computeKiE, for the solution f(x,v,t) at the current time t, using its DG coefficients stored U
-		EleE=computeEleE(U);																		// set EleE to the value calculated through computeEleE, for the solution f(x,v,t) at the current time t, using its DG coefficients stored U
-		tmp = sqrt(EleE);																			// set tmp to the square root of EleE
-		ent1 = computeEntropy(U);																	// set ent1 the value calculated through computeEntropy
-		l_ent1 = log(fabs(ent1));																	// set l_ent1 to the log of ent1
-		ll_ent1 = log(fabs(l_ent1));																// set ll_ent1 to the log of l_ent1
-		printf("step #0: %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g %11.8g %11.8g \n",
-				mass, a[0], a[1], a[2], KiE, EleE, tmp, log(tmp), KiE+EleE, ent1);					// display in the output file that this is step 0 (so these are the initial conditions), then the mass, 3 components of momentum, kinetic energy, electric energy, sqrt(electric energy), log(sqrt(electric energy)), total energy & entropy
-		fprintf(fmom, "%11.8g %11.8g %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g \n",
-				mass, a[0], a[1], a[2], KiE, EleE, tmp, log(tmp), KiE+EleE);						// in the file tagged as fmom, print the initial mass, 3 components of momentum, kinetic energy, electric energy, sqrt(electric energy), log(sqrt(electric energy)) & total energy
-		fprintf(fent, "%11.8g %11.8g %11.8g \n", ent1, l_ent1, ll_ent1);							// in the file tagged as fent, print the entropy, its log and the log of that
-
-		KiEratio = computeKiEratio(U, fNegVals);													// compute the ratio of the kinetic energy where f is negative to that where it is positive and store it in KiEratio
-		printf("Kinetic Energy Ratio = %g\n", KiEratio);											// print the ratio of the kinetic energy where f is negative to that where it is positive
-
 		//fufull=fopen("Data/U_nu0.02A0.5k1.5708Nx48Lx4Nv32Lv4SpectralN24dt0.004_non_nu002_time15s.dc", "w");
 		//fprintf(fmom, "%11.8g  %11.8g\n", EleE, log(tmp));
 		/*#ifdef TwoStream
@@ -459,10 +423,38 @@ int main()
 		PrintMarginal(U, fmarg);																	// print the marginal distribution for the initial condition, using the DG coefficients in U, in the file tagged as fmarg
 	}
   
-	MPI_Bcast(U, size*6, MPI_DOUBLE, 0, MPI_COMM_WORLD);   											// send the contents of U, which will be 6*size entries of datatype MPI_DOUBLE, from the process with rank 0 to all processes, using the communicator MPI_COMM_WORLD
+	#ifdef UseMPI
+	scatterSlabs(U);																				// send the slab of space cells of each process from U on the process with rank 0 to the U of that process
+	#endif
+
+	computeDiagnostics(U, 1, rel_entropy_used, &diag);												// calculate the mass, momentum, kinetic energy, electric energy, entropy (and relative entropy, if it was asked for) & kinetic energy ratio for the initial condition, each process summing the space cells it owns
+	if(myrank_mpi==0)																				// only the process with rank 0 will do this
+	{
+		tmp = sqrt(diag.EleE);																			// set tmp to the square root of EleE
+		l_ent1 = log(fabs(diag.ent));																	// set l_ent1 to the log of the entropy
+		ll_ent1 = log(fabs(l_ent1));																// set ll_ent1 to the log of l_ent1
+		printf("step #0: %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g %11.8g %11.8g \n",
+				diag.mass, diag.momentum[0], diag.momentum[1], diag.momentum[2], diag.KiE, diag.EleE, tmp, log(tmp), diag.KiE+diag.EleE, diag.ent);					// display in the output file that this is step 0 (so these are the initial conditions), then the mass, 3 components of momentum, kinetic energy, electric energy, sqrt(electric energy), log(sqrt(electric energy)), total energy & entropy
+		fprintf(fmom, "%11.8g %11.8g %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g \n",
+				diag.mass, diag.momentum[0], diag.momentum[1], diag.momentum[2], diag.KiE, diag.EleE, tmp, log(tmp), diag.KiE+diag.EleE);						// in the file tagged as fmom, print the initial mass, 3 components of momentum, kinetic energy, electric energy, sqrt(electric energy), log(sqrt(electric energy)) & total energy
+		fprintf(fent, "%11.8g %11.8g %11.8g ", diag.ent, l_ent1, ll_ent1);							// in the file tagged as fent, print the entropy, its log and the log of that
+		if(RelEntropyFile != NULL)
+		{
+			fprintf(fent, "%11.8g ", diag.rel_ent);													// followed by the relative entropy, if it was asked for
+		}
+		fprintf(fent, "\n");
+
+		printf("Kinetic Energy Ratio = %g\n", diag.KiEratio);											// print the ratio of the kinetic energy where f is negative to that where it is positive
+		printf("Negative Cells = %d\n", diag.n_neg);													// print the number of cells where f is negative anywhere
+	}
+  
+	#ifdef UseMPI
 	MPI_Barrier(MPI_COMM_WORLD);																	// set an MPI barrier to ensure that all processes have reached this point before continuing
   
 	MPIt1 = MPI_Wtime();																			// set MPIt1 to the current time in the MPI process
+	#else
+	MPIt1 = omp_get_wtime();																		// set MPIt1 to the current time
+	#endif
 	while(t < nT) 																					// if t < nT (i.e. not yet reached the final timestep), perform time-splitting to first advect the particle through the collisionless step and then perform one space homogeneous collisional step)
 	{
 		RK3(U); 																					// Use RK3 to perform one timestep of the collisionless problem
@@ -471,92 +463,101 @@ int main()
 		{
 			setInit_spectral(U, f); 																// Take the coefficient of the DG solution from the advection step, and project them onto the grid used for the spectral method to perform the collision step
 
-			for(l=chunk_Nx*myrank_mpi;l<chunk_Nx*(myrank_mpi+1) && l<Nx;l++) 						// divide the number of discretised space points equally over the number of MPI processes, so that each process receives a different chunk of space to work on
+			if(QCheck && t == 0 && myrank_mpi == 0)
 			{
 				#ifdef FullandLinear																// only do this if FullandLinear was defined
-				ComputeQ(f[l%chunk_Nx], qHat, conv_weights, qHat_linear, conv_weights_linear);		// using the coefficients of the current solution stored in f (but only for the chunk of space being taken care of by the current MPI process), calculate the Fourier tranform of Q(f,f) using conv_weights for the weights in the convolution in the full part of Q & conv_weights_linear in the convolution in the linear part of Q, then store the results of each Fourier transform in qHat & qHat_linear, respectively
-				conserveAllMoments(qHat, qHat_linear);												// perform the explicit conservation calculation
-				RK4(f[l%chunk_Nx], l, qHat, conv_weights, qHat_linear, conv_weights_linear,
-						U, Utmp_coll);																// advance to the next time step in the collisional problem using RK4 at the given space-step l, taking the current solution stored in f (but only for the chunk of space being taken care of by the current MPI process), as well as qHat, conv_weights, qHat_linear & conv_weights_linear (to allow more Fourier transforms of Q to be made), storing the output partially in U and partially in Utmp_coll
-				#else																				// otherwise, if FullandLinear was not defined...
-				ComputeQ(f[l%chunk_Nx], qHat, conv_weights);										// using the coefficients of the current solution stored in f (but only for the chunk of space being taken care of by the current MPI process), calculate the Fourier tranform of Q(f,f) using conv_weights for the weights in the convolution, then store the results of the Fourier transform in qHat
-				conserveAllMoments(qHat);															// perform the explicit conservation calculation
-				RK4(f[l%chunk_Nx], l, qHat, conv_weights, U, Utmp_coll);							// advance to the next time step in the collisional problem using RK4 at the given space-step l, taking the current solution stored in f (but only for the chunk of space being taken care of by the current MPI process), as well as qHat & conv_weights (to allow more Fourier transforms of Q to be made), storing the output partially in U and partially in Utmp_coll
+				printf("Relative difference in qHat between the %s method and the matrix-free quadrature: %g \n", QMethodName(QMethod), checkComputeQ(&coll_ctx[0], f[0], conv_weights, conv_weights_linear));	// check the method used for the convolution on the first space-step (conv_weights & conv_weights_linear are only read by the direct method)
+				#else
+				printf("Relative difference in qHat between the %s method and the matrix-free quadrature: %g \n", QMethodName(QMethod), checkComputeQ(&coll_ctx[0], f[0], conv_weights, NULL));	// check the method used for the convolution on the first space-step (conv_weights is only read by the direct method)
 				#endif
 			}
 
-			MPI_Barrier(MPI_COMM_WORLD);															// set an MPI barrier to ensure that all processes have reached this point before continuing
-			if(myrank_mpi == 0) 																	// only the process with rank 0 will do this
+			for(l=chunk_Nx*myrank_mpi;l<chunk_Nx*(myrank_mpi+1) && l<Nx && QBatch>1;l+=n_batch)		// if QBatch > 1, go through the chunk of space for this process in batches of up to QBatch space-steps
 			{
-				// TRANSFER CONTENTS OF THE dU (Utmp_coll) THAT HAVE BEEN COMPUTED INTO U1 (U):
-				for(l=0;l<chunk_Nx;l++) 															// cycle through all space-steps stored in the first chunk of the space interval (which is stored on the process with rank 0)
+				n_batch = QBatch;
+				if(l + n_batch > chunk_Nx*(myrank_mpi+1))
 				{
-					for(k=0;k<size_v;k++)															// cycle through all size_v (= Nv^3) many velocity-steps (which will exist for each space-step)
-					{
-						k_v = l*size_v + k;															// set k_v to be the value associated with the k-th velocity-step for the l-th space-step
-						U[k_v*6+0] = Utmp_coll[k_v*5];												// set the 6*k_v-th entry of U to the 5*k_v-th entry of Utmp_coll
-						U[k_v*6+5] = Utmp_coll[k_v*5+4]; 											// set the (6*k_v + 5)-th entry of U to the (5*k_v + 4)-th entry of Utmp_coll
-						U[k_v*6+2] = Utmp_coll[k_v*5+1];  											// set the (6*k_v + 2)-th entry of U to the (5*k_v + 1)-th entry of Utmp_coll
-						U[k_v*6+3] = Utmp_coll[k_v*5+2];	 										// set the (6*k_v + 3)-th entry of U to the (5*k_v + 2)-th entry of Utmp_coll
-						U[k_v*6+4] = Utmp_coll[k_v*5+3];											// set the (6*k_v + 4)-th entry of U to the (5*k_v + 3)-th entry of Utmp_coll
-					}
+					n_batch = chunk_Nx*(myrank_mpi+1) - l;											// the last batch stops at the end of the chunk of space for this process
 				}
-				// RECEIVE FROM ALL OTHER PROCESSES CONSECUTIVELY TO ENSURE THE WEIGHTS ARE STORED IN THE FILE U CONSECUTIVELY:
-				for(i=1;i<nprocs_Nx;i++)															// store the DG coefficients of the current solution in U that were calculated by the remaining processes (with ranks i = 1, 2, ..., nprocs_Nx-1) for their corresponding chunk of space
+				if(l + n_batch > Nx)
 				{
-					MPI_Recv(output_buffer, chunk_Nx*size_v*5, MPI_DOUBLE, i, i,
-							MPI_COMM_WORLD, &status);											 	// receive a message of 5*chunk_Nx_size_v entries of datatype MPI_DOUBLE from the process with rank i (storing the i-th space chunk of U, containing the DG coefficients calculate on the processor with corresponding rank), storing the data in output_buffer, with tag i in the communicator MPI_COMM_WORLD, storing the status of the receive in status
-					for(l=0;l<chunk_Nx;l++)															// cycle through all space-steps stored in the chunk of the space interval dealt with by the i-th process
-					{
-						if((chunk_Nx*i+l)<Nx)														// ensure that the space-step being dealt with exists
-						{
-							for(k=0;k<size_v;k++)													// cycle through all size_v (= Nv^3) many velocity-steps (which will exist for each space-step)
-							{
-								k_v = (chunk_Nx*i+l)*size_v + k; 									// set k_v to be the value associated with the k-th velocity-step for the (chunk_Nx*i + l)-th space-step (which is the l-th space-step in the current chunk)
-								k_local = l*size_v + k;												// set k_local to be the value associated with the k-th veolcity-step for the l-th local space step (which is the current one, as indicated in the previous line)
-
-								// STORE CONTENTS OF THE RECEIVE BUFFER IN THE CORRECT PORTION OF U TO ADD THIS PART OF THE SOLUTION:
-								U[k_v*6+0] = output_buffer[k_local*5];								// set the 6*k_v-th entry of U to the 5*k_local-th entry of Utmp_coll
-								U[k_v*6+5] = output_buffer[k_local*5+4];							// set the (6*k_v + 5)-th entry of U to the (5*k_local + 4)-th entry of Utmp_coll
-								U[k_v*6+2] = output_buffer[k_local*5+1];  							// set the (6*k_v + 2)-th entry of U to the (5*k_local + 1)-th entry of Utmp_coll
-								U[k_v*6+3] = output_buffer[k_local*5+2];	 						// set the (6*k_v + 3)-th entry of U to the (5*k_local + 2)-th entry of Utmp_coll
-								U[k_v*6+4] = output_buffer[k_local*5+3];							// set the (6*k_v + 4)-th entry of U to the (5*k_local + 3)-th entry of Utmp_coll
-							}
-						}
-					}
+					n_batch = Nx - l;																// ...or at the end of the space domain
 				}
+				#ifdef FullandLinear																// only do this if FullandLinear was defined
+				RK4_Batch(&coll_ctx[0], &f[l%chunk_Nx], l, n_batch, conv_weights, conv_weights_linear, U);	// perform the collision step (calculating Q(f,f), conserving its moments and advancing with RK4) for the n_batch space-steps starting at l together, so that each convolution weight is loaded once per batch
+				#else																				// otherwise, if FullandLinear was not defined...
+				RK4_Batch(&coll_ctx[0], &f[l%chunk_Nx], l, n_batch, conv_weights, U);							// perform the collision step (calculating Q(f,f), conserving its moments and advancing with RK4) for the n_batch space-steps starting at l together, so that each convolution weight is loaded once per batch
+				#endif
 			}
-			else 																					// the remaining processes, with rank 1, 2, ..., nprocs_Nx-1 will do this
+
+			l_end = (QBatch == 1) ? chunk_Nx*(myrank_mpi+1) : chunk_Nx*myrank_mpi;					// if QBatch == 1 (otherwise there is nothing left to do here), divide the number of discretised space points equally over the number of MPI processes, so that each process receives a different chunk of space to work on
+			if(l_end > Nx)
 			{
-				if(myrank_mpi<nprocs_Nx)
-				{
-					MPI_Send(Utmp_coll, chunk_Nx*size_v*5, MPI_DOUBLE, 0, myrank_mpi,
-							MPI_COMM_WORLD);														// send the contents of Utmp_coll, which will be 5*chunk_Nx*size_v entries of datatype MPI_DOUBLE, to the process with rank 0, tagged with the rank of the current process, via the MPI_COMM_WORLD communicator
-				}
+				l_end = Nx;
+			}
+			#pragma omp parallel for schedule(dynamic) private(l, ctx) shared(f, U, conv_weights, coll_ctx) if(QParallel == QParallelCells)	// with QParallelCells, each thread computes whole collision steps with its own context (the OpenMP loops inside them then run on that thread alone); otherwise the space-steps are computed one after another with the first context
+			for(l=chunk_Nx*myrank_mpi;l<l_end;l++)
+			{
+				ctx = &coll_ctx[omp_get_thread_num()];												// the work arrays of the current thread (always the first context with QParallelModes, since the loop is then run by the master thread alone)
+				#ifdef FullandLinear																// only do this if FullandLinear was defined
+				ComputeQ(ctx, f[l%chunk_Nx], ctx->qHat, conv_weights, ctx->qHat_linear, conv_weights_linear);		// using the coefficients of the current solution stored in f (but only for the chunk of space being taken care of by the current MPI process), calculate the Fourier tranform of Q(f,f) using conv_weights for the weights in the convolution in the full part of Q & conv_weights_linear in the convolution in the linear part of Q, then store the results of each Fourier transform in qHat & qHat_linear, respectively
+				conserveAllMoments(ctx->qHat, ctx->qHat_linear);									// perform the explicit conservation calculation
+				RK4(ctx, f[l%chunk_Nx], l, ctx->qHat, conv_weights, ctx->qHat_linear, conv_weights_linear,
+						U);																		// advance to the next time step in the collisional problem using RK4 at the given space-step l, taking the current solution stored in f (but only for the chunk of space being taken care of by the current MPI process), as well as qHat, conv_weights, qHat_linear & conv_weights_linear (to allow more Fourier transforms of Q to be made), storing the output in the coefficients of the collision invariants at the space-step l in U
+				#else																				// otherwise, if FullandLinear was not defined...
+				ComputeQ(ctx, f[l%chunk_Nx], ctx->qHat, conv_weights);								// using the coefficients of the current solution stored in f (but only for the chunk of space being taken care of by the current MPI process), calculate the Fourier tranform of Q(f,f) using conv_weights for the weights in the convolution, then store the results of the Fourier transform in qHat
+				conserveAllMoments(ctx->qHat);														// perform the explicit conservation calculation
+				RK4(ctx, f[l%chunk_Nx], l, ctx->qHat, conv_weights, U);								// advance to the next time step in the collisional problem using RK4 at the given space-step l, taking the current solution stored in f (but only for the chunk of space being taken care of by the current MPI process), as well as qHat & conv_weights (to allow more Fourier transforms of Q to be made), storing the output in the coefficients of the collision invariants at the space-step l in U
+				#endif
 			}
-		    MPI_Bcast(U, size*6, MPI_DOUBLE, 0, MPI_COMM_WORLD);    								// send the contents of U, from the process with rank 0, which contains 6*size entries of datatype MPI_DOUBLE, to all processes via the communicator MPI_COMM_WORLD (so that all processes have the coefficients of the DG approximation to f at the current time-step for the start of the next calculation)
 		}
+
+		moment_step = ((t+1)%MomentStep == 0);														// print the moments after every MomentStep-th time-step
+		entropy_step = ((t+1)%EntropyStep == 0);													// print the entropy after every EntropyStep-th time-step
+		marginal_step = (t%MarginalStep == 0);														// print the marginals after time-steps 1, MarginalStep+1, 2*MarginalStep+1, ...
+		if(moment_step || entropy_step)
+		{
+			computeDiagnostics(U, entropy_step, rel_entropy_used, &diag);							// calculate the mass, momentum, kinetic energy, electric energy, kinetic energy ratio (and entropy & relative entropy, if they are to be printed) for the solution f(x,v,t) at the current time t, each process summing the space cells it owns
+		}
+
+		#ifdef UseMPI
+		if(marginal_step)
+		{
+			gatherSlabs(U);																			// collect the space cells advected & collided by the other processes in U on the process with rank 0 (for the marginals)
+		}
+		#endif
    
 		if(myrank_mpi==0)																			// only the process with rank 0 will do this
 		{
-			FindNegVals(U, fNegVals, fAvgVals);																// find out in which cells the approximate solution goes negative and record it in fNegVals
-
-			mass=computeMass(U);																	// set mass to the value calculated through computeMass, for the solution f(x,v,t) at the current time t, using its DG coefficients stored U
-			computeMomentum(U, a);																	// calculate the momentum for the solution f(x,v,t) at the current time t, using its DG coefficients stored U, and store it in a
-			KiE=computeKiE(U);																		// set KiE to the value calculated through computeKiE, for the solution f(x,v,t) at the current time t, using its DG coefficients stored U
-			EleE=computeEleE(U);																	// set EleE to the value calculated through computeEleE, for the solution f(x,v,t) at the current time t, using its DG coefficients stored U
-			tmp = sqrt(EleE);																		// set tmp to the square root of EleE
-			ent1 = computeEntropy(U);																// set ent1 the value calculated through computeEntropy
-			l_ent1 = log(fabs(ent1));																// set l_ent1 to the log of ent1
-			ll_ent1 = log(fabs(l_ent1));															// set ll_ent1 to the log of l_ent1
-			printf("step %d: %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g %11.8g %11.8g \n",
-					t+1, mass, a[0], a[1], a[2], KiE, EleE, tmp, log(tmp), KiE+EleE, ent1);			// display in the output file that this is step t+1, then the mass, 3 components of momentum, kinetic energy, electric energy, sqrt(electric energy), log(sqrt(electric energy)), total energy & entropy
-			fprintf(fmom, "%11.8g %11.8g %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g \n",
-					mass, a[0], a[1], a[2], KiE, EleE, tmp, log(tmp), KiE+EleE);					// in the file tagged as fmom, print the initial mass, 3 components of momentum, kinetic energy, electric energy, sqrt(electric energy), log(sqrt(electric energy)) & total energy
-			fprintf(fent, "%11.8g %11.8g %11.8g \n", ent1, l_ent1, ll_ent1);						// in the file tagged as fent, print the entropy, its log and the log of that
-
-			KiEratio = computeKiEratio(U, fNegVals);												// compute the ratio of the kinetic energy where f is negative to that where it is positive and store it in KiEratio
-			printf("Kinetic Energy Ratio = %g\n", KiEratio);										// print the ratio of the kinetic energy where f is negative to that where it is positive
+			if(moment_step)
+			{
+				tmp = sqrt(diag.EleE);																// set tmp to the square root of EleE
+				if(entropy_step)
+				{
+					printf("step %d: %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g %11.8g %11.8g \n",
+							t+1, diag.mass, diag.momentum[0], diag.momentum[1], diag.momentum[2], diag.KiE, diag.EleE, tmp, log(tmp), diag.KiE+diag.EleE, diag.ent);	// display in the output file that this is step t+1, then the mass, 3 components of momentum, kinetic energy, electric energy, sqrt(electric energy), log(sqrt(electric energy)), total energy & entropy
+				}
+				else
+				{
+					printf("step %d: %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g %11.8g \n",
+							t+1, diag.mass, diag.momentum[0], diag.momentum[1], diag.momentum[2], diag.KiE, diag.EleE, tmp, log(tmp), diag.KiE+diag.EleE);	// the same without the entropy
+				}
+				fprintf(fmom, "%11.8g %11.8g %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g  %11.8g \n",
+						diag.mass, diag.momentum[0], diag.momentum[1], diag.momentum[2], diag.KiE, diag.EleE, tmp, log(tmp), diag.KiE+diag.EleE);	// in the file tagged as fmom, print the mass, 3 components of momentum, kinetic energy, electric energy, sqrt(electric energy), log(sqrt(electric energy)) & total energy
+				printf("Kinetic Energy Ratio = %g\n", diag.KiEratio);								// print the ratio of the kinetic energy where f is negative to that where it is positive
+				printf("Negative Cells = %d\n", diag.n_neg);										// print the number of cells where f is negative anywhere
+			}
+			if(entropy_step)
+			{
+				l_ent1 = log(fabs(diag.ent));														// set l_ent1 to the log of the entropy
+				ll_ent1 = log(fabs(l_ent1));														// set ll_ent1 to the log of l_ent1
+				fprintf(fent, "%11.8g %11.8g %11.8g ", diag.ent, l_ent1, ll_ent1);					// in the file tagged as fent, print the entropy, its log and the log of that
+				if(RelEntropyFile != NULL)
+				{
+					fprintf(fent, "%11.8g ", diag.rel_ent);											// followed by the relative entropy, if it was asked for
+				}
+				fprintf(fent, "\n");
+			}
 
 			//fprintf(fmom, "%11.8g  %11.8g\n", EleE, log(tmp));
 			/*#ifdef TwoStream
@@ -575,7 +576,7 @@ int main()
       
 
 	    	//if(t%400==0)fwrite(U,sizeof(double),size*6,fu);
-			if(t%20==0)
+			if(marginal_step)
 			{
 				PrintMarginal(U, fmarg);															// print the marginal distribution for the initial condition, using the DG coefficients in U, in the file tagged as fmarg
 			}
@@ -583,10 +584,16 @@ int main()
 	
 		t++;																						// increment t by one
 	
-		MPI_Barrier(MPI_COMM_WORLD);																// set an MPI barrier to ensure that all processes have reached this point before continuing
 	}
   
+	#ifdef UseMPI
 	MPIelapsed = MPI_Wtime() - MPIt1;																// set MPIelapsed to the current time minus MPIt1 to calculate how long nT time-steps took
+	#else
+	MPIelapsed = omp_get_wtime() - MPIt1;															// set MPIelapsed to the current time minus MPIt1 to calculate how long nT time-steps took
+	#endif
+	#ifdef UseMPI
+	gatherSlabs(U);																					// collect the final solution on the process with rank 0 (for the files written at the end)
+	#endif
 	if(myrank_mpi==0)																				// only the process with rank 0 will do this
 	{
 		printf("time duration for %d time steps is %gs\n",nT, MPIelapsed);							// display in the output file how long it took to calculate nT time-steps
@@ -596,7 +603,9 @@ int main()
 	
 		fclose(fu);  																				// remove the tag fu to close the file
 	}
+	#ifdef UseMPI
 	MPI_Barrier(MPI_COMM_WORLD);																	// set an MPI barrier to ensure that all processes have reached this point before continuing
+	#endif
   
 	if(myrank_mpi==0)																				// only the process with rank 0 will do this
 	{
@@ -611,22 +620,59 @@ int main()
 	if(nu > 0.)
 	{
 		free(C1); free(C2); free(v); free(eta); free(wtN);											// delete the dynamic memory allocated for C1, C2, v, eta & wtN
-		free(f); free(conv_weights); free(output_buffer); 											// delete the dynamic memory allocated for f, conv_weights, output_buffer
-		fftw_free(temp); fftw_free(qHat);															// delete the dynamic memory allocated for temp & qhat
-		fftw_free(Q1_fft); fftw_free(Q2_fft); fftw_free(Q3_fft); fftw_free(fftOut); fftw_free(fftIn); // delete the dynamic memory allocated for Q1_fft, Q2_fft, Q3_fft, fftOut & fftIn
-		free(Q);free(f1);free(Q1); free(Utmp_coll);// free(f2); free(f3);//free(Q3);				// delete the dynamic memory allocated for Q, f1, Q1 & Utmp_coll
+		free(f); 																					// delete the dynamic memory allocated for f
+		if(QMethod == QMatrixFree || QMethod == QFFT || QCheck)
+		{
+			free(conv_coeffs);																		// delete the dynamic memory allocated for conv_coeffs
+		}
+		if(QMethod == QSymmetric)
+		{
+			freeSymWeights(&conv_weights_sym);														// delete the compressed weights and the tables of the symmetries
+		}
+		if(QMethod != QDirect)
+		{
+			free(conv_weights);																		// delete the dynamic memory allocated for the (unused) pointers to the rows of conv_weights
+		}
+		else
+		{
+			freeConvWeights(conv_weights, &weights_storage);										// delete the weights in conv_weights (unmapping the weight cache file or freeing the shared window they are stored in)
+		}
+		for(i=0;i<n_coll_ctx;i++)
+		{
+			freeCollisionContext(&coll_ctx[i]);														// delete the work arrays of the i-th context
+		}
+		free(coll_ctx);																				// delete the dynamic memory allocated for coll_ctx
+		freeSpectralTransform(&spectral);															// delete the phase shifts & quadrature weights of the spectral transforms
+		free(int_modes);																			// delete the dynamic memory allocated for int_modes
+		free(proj_modes);																			// delete the dynamic memory allocated for proj_modes
+		// free(f2); free(f3);//free(Q3);
 		#ifdef FullandLinear																		// only do this if FullandLinear is defined
-		fftw_free(qHat_linear); fftw_free(Q1_fft_linear); 											// delete the dynamic memory allocated for qHat_linear & Q1_fft_linear
-		fftw_free(Q2_fft_linear); fftw_free(Q3_fft_linear); 										// delete the dynamic memory allocated for Q2_fft_linear & Q3_fft_linear
-		free(conv_weights_linear);																	// delete the dynamic memory allocated for conv_weights_linear
+		if(QMethod != QDirect)
+		{
+			free(conv_weights_linear);																// delete the dynamic memory allocated for the (unused) pointers to the rows of conv_weights_linear
+		}
+		else
+		{
+			freeConvWeights(conv_weights_linear, &weights_storage_linear);						// delete the weights in conv_weights_linear (unmapping the weight cache file or freeing the shared window they are stored in)
+		}
 		#endif
 	}
-	free(output_buffer_vp);																			// delete the dynamic memory allocated for output_buffer_vp
-	free(U); free(U1); free(Utmp); // free(H);														// delete the dynamic memory allocated for U, U1 & Utmp
-	free(cp); free(intE); free(intE1); free(intE2);													// delete the dynamic memory allocated for cp, intE, intE1 & inteE2
+	#ifdef UseMPI
+	free(U_block); free(U1_block); free(Utmp); // free(H);											// delete the dynamic memory allocated for U, U1 & Utmp
+	#else
+	free(U_block); free(U1); free(Utmp);															// delete the dynamic memory allocated for U, U1 & Utmp (which RK3 swaps without MPI)
+	#endif
+	free(cp); free(intE); free(intE1); free(intE2); free(rhoMoments);								// delete the dynamic memory allocated for cp, intE, intE1, inteE2 & rhoMoments
 
-	free(fNegVals); free(fAvgVals);	free (fEquiVals);												// delete the dynamic memory allocated for fNegVals, fAvgVals & fEquiVals
+	freeCellQuadrature(&cell_quad);																	// delete the tables of the quadrature on each cell
+	if(RelEntropyFile != NULL)
+	{
+		free(rel_entropy.rho_vals); free(rel_entropy.maxwell_vals);									// delete the tables of the equilibrium for the relative entropy
+	}
   
+	#ifdef UseMPI
 	MPI_Finalize();																					// ensure that MPI exits cleanly
+	#endif
 	return 0;																						// return 0, since main is of type int (and this shows the program completed correctly)
 }
+#endif
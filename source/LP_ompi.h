@@ -17,7 +17,6 @@
 //        LIBRARIES       //
 //************************//
 
-#include <mpi.h>																					// allows all MPI routines to be used
 #include <stdio.h>																					// allows the object type FILE (an object suitable for storing information for a file stream) to be used, as well as the functions printf, sprintf, fopen, fread, fclose
 #include <malloc.h>																					// allows malloc to be used
 #include <math.h>																					// allows sqrt to be used as well as the value of M_PI
@@ -28,14 +27,21 @@
 #include <mkl.h>
 #elif HAVE_OPENBLAS
 #include <lapacke.h>
+#include <cblas.h>
 #endif
 
 //************************//
 //         MACROS         //
 //************************//
 
-// CHOOSE WHETHER OR NOT TO USE MPI:
-#define UseMPI 																						// define the macro MPI (UNCOMMENT IF THE CODE SHOULD UTILISE MPI)
+// CHOOSE WHETHER OR NOT TO USE MPI (solver IS BUILT WITH MPI & solver_omp, WHICH RUNS ON ONE NODE WITH OpenMP ALONE, IS BUILT WITH -DNoMPI):
+#ifndef NoMPI
+#define UseMPI 																						// define the macro MPI (COMMENT OUT IF THE CODE SHOULD NOT UTILISE MPI)
+#endif
+
+#ifdef UseMPI
+#include <mpi.h>																					// allows all MPI routines to be used
+#endif
 
 // CHOOSE WHICH VARIATION OF THE CODE TO RUN:
 //#define Damping																					// define the macro Damping (UNCOMMENT IF BEING RUN FOR THE LANDAU DAMPING PROBLEM)
@@ -44,6 +50,19 @@
 #define FourHump																					// define the macro FourHump (UNCOMMENT IF BEING RUN FOR THE FOUR HUMP IC PROBLEM)
 //#define TwoHump																					// define the macro TwoHump (UNCOMMENT IF BEING RUN FOR THE TWO HUMP IC PROBLEM)
 
+// THE METHODS AVAILABLE FOR THE CONVOLUTION IN ComputeQ (THE ONE USED IS STORED IN QMethod, WHICH CAN BE CHANGED AT RUN TIME WITH THE OPTION -qmethod):
+#define QDirect 0																					// read each convolution weight from the N^3 x N^3 table conv_weights (the default)
+#define QMatrixFree 1																				// rebuild each convolution weight inline from the 10 coefficients per omega stored in conv_coeffs (only O(N^3) memory)
+#define QFFT 2																						// split the quadrature into 10 convolutions of weighted copies of fHat (using conv_coeffs) and calculate each with zero-padded FFTs (O(N^3 log N) work)
+#define QSymmetric 3																				// read each convolution weight from the table compressed by the symmetries of the weights in conv_weights_sym (about 1/48 of the rows of conv_weights)
+#define QNumMethods 4																				// the number of methods available (THE METHODS ARE LABELLED 0 TO QNumMethods-1)
+
+// THE WAYS THE COLLISION STEPS CAN BE SHARED OUT BETWEEN THE OpenMP THREADS (THE ONE USED IS STORED IN QParallel, WHICH CAN BE CHANGED AT RUN TIME WITH THE OPTION -qparallel):
+#define QParallelAuto 0																				// choose between the two below from N, chunk_Nx & nthread (the default, see chooseQParallel)
+#define QParallelCells 1																			// each thread computes whole collision steps for its own space-steps, with its own CollisionContext
+#define QParallelModes 2																			// the space-steps are computed one after another, with the threads sharing out the loops inside each collision step
+#define QNumParallel 3																				// the number of ways available (THEY ARE LABELLED 0 TO QNumParallel-1)
+
 // CHOOSE IF THIS IS THE INITIAL RUN OR A SUBSEQUENT RUN:
 #define First																						// define the macro First (UNCOMMENT IF RUNNING THE CODE FOR THE FIRST TIME)
 //#define Second																					// define the macro Second (UNCOMMENT IF PICKING UP DATA FROM A PREVIOUS RUN)
@@ -65,37 +84,34 @@ extern double L_v, R_v, L_eta;																		// declare L_v (for -Lv < v < Lv
 extern double h_eta, h_v;																			// declare h_eta (the Fourier stepsize) & h_v (also the velocity stepsize but for the collision problem)
 extern double nu, dt, nthread; 																		// declare nu (1/knudson#) and set it to 0.1, dt (the timestep) and set it to 0.004 & nthread (the number of OpenMP threads) and set it to 16
 
+extern int QMethod, QCheck, QBatch, QParallel;														// declare QMethod (the method used for the convolution in ComputeQ, either QDirect, QMatrixFree, QFFT or QSymmetric), QCheck (whether or not to check the method against the matrix-free quadrature at the start of the run), QBatch (the number of space-steps whose collision steps are computed together) & QParallel (how the collision steps are shared out between the threads, either QParallelAuto, QParallelCells or QParallelModes)
+extern int MPIProgress;																				// declare MPIProgress (whether or not the master thread polls the ghost exchange of the advection while the interior planes are calculated)
+extern int MomentStep, EntropyStep, MarginalStep;													// declare MomentStep, EntropyStep & MarginalStep (the number of time-steps between each time the moments, the entropy & the marginals are printed)
+extern char *RelEntropyFile;																		// declare RelEntropyFile (the file of the equilibrium density for the relative entropy, or NULL if it isn't calculated)
+extern double *proj_modes;																			// declare a pointer to proj_modes (the 1-D integrals in int_modes as a real matrix, so the projection onto the DG basis can be done with dgemm, see generate_proj_modes)
+extern double *int_modes;																			// declare a pointer to int_modes (the 1-D integrals over each velocity cell which IntModes multiplies together, see generate_int_modes)
+extern double *conv_coeffs;																			// declare a pointer to conv_coeffs (the 10 coefficients for each omega which determine the convolution weights, used when QMethod is QMatrixFree or QFFT)
+
 extern double *v, *eta;																				// declare v (the velocity variable) & eta (the Fourier space variable)
 extern double *wtN;																					// declare wtN (the trapezoidal rule weights to be used)
 extern double scale, scale3, scaleL, scalev;														// declare scale (the 1/sqrt(2pi) factor appearing in Gaussians), scale (the 1/(sqrt(2pi))^3 factor appearing in the Maxwellian), scaleL (the volume of the velocity domain) and set it to 8Lv^3 & scalev (the volume of a discretised velocity element) and set it to dv^3
 extern double **C1, **C2;																			// declare pointers to matrices C1 (the real part of the conservation matrix C) & C2 (the imaginary part of the conservation matrix C), CCt (of dimension 5x5) & CCt_linear (of dimension 2x2)
 extern double CCt[5*5], CCt_linear[2*2];															// declare matrices CCt (C*C^T, for the conservation matrix C) & CCt_linear (C*C^T, for the conservation matrix C, in the two species collision operator)
-extern double lamb[5], lamb_linear[2];																// declare the arrays lamb (to hold 5 values) & lamb_linear (to hold 2 values)
-
-extern double *U1, *Utmp, *output_buffer_vp;//, **H;												// declare pointers to U1, Utmp (both used to help store the values in U, declared later) & output_buffer_vp (a buffer used when sending the data between MPI processes during the VP method)
-extern double *Q, *f1, *Q1, *Utmp_coll;//*f2, *f3;													// declare pointers to Q (the discretised collision operator), f1 (used to help store the solution during the collisional problem), Q1 (used in calculation of the collision operator) & Utmp_coll (used to store calculations from the RK4 method used in the collisional problem)
-extern fftw_complex *Q1_fft, *Q2_fft, *Q3_fft;														// declare pointers to the complex numbers Q1_fft, Q2_fft & Q3_fft (involved in storing the FFT of Q)
 
-#ifdef FullandLinear																				// only do this if FullandLinear was defined
-extern fftw_complex *Q1_fft_linear, *Q2_fft_linear, *Q3_fft_linear;									// declare pointers to the complex numbers Q1_fft_linear, Q2_fft_linear & Q3_fft_linear (involved in storing the FFT of the two species collison operator Q)
-#endif
-
-extern fftw_complex *fftIn, *fftOut;																// declare pointers to the FFT variables fftIn (a vector to be to have the FFT applied to it) & fftOut (the output of an FFT)
+extern double *U1, *Utmp;//, **H;																	// declare pointers to U1 & Utmp (both used to help store the values in U, declared later)
 //extern double IntM[10];																				// declare an array IntM to hold 10 double variables
 //#pragma omp threadprivate(IntM)																	// start the OpenMP parallel construct to start the threads which will run in parallel, passing IntM to each thread as private variables which will have their contents deleted when the threads finish (doesn't seem to be doing anything since no {} afterwards???)
 
 extern double ce, *cp, *intE, *intE1, *intE2;														// declare ce and pointers to cp, intE, intE1 & intE2 (precomputed quantities for advections)
+extern double *rhoMoments;																			// declare a pointer to rhoMoments (the sums over the velocity cells of the charge in each space cell, from which computeFieldCoeffs calculates ce, cp, intE, intE1 & intE2)
 
 extern fftw_plan p_forward; 																		// declare the fftw_plan p_forward (an object which contains all the data which allows fftw3 to compute the FFT)
 extern fftw_plan p_backward; 																		// declare the fftw_plan p_backward (an object which contains all the data which allows fftw3 to compute the inverse FFT)
-extern fftw_complex *temp;																			// declare a pointer to complex number temp (a temporary array used when calculating the FFT)
+extern fftw_plan p_forward_batch, p_backward_batch;													// declare the fftw_plans p_forward_batch & p_backward_batch (the same FFTs as p_forward & p_backward for QBatch cells at once, used by fft3D_Batch & FS_Batch)
+extern fftw_plan p_forward_pad, p_backward_pad;														// declare the fftw_plans p_forward_pad & p_backward_pad (for the FFT & inverse FFT of size (2N)^3 used by ComputeQ_FFT)
 
 extern int myrank_mpi, nprocs_mpi, nprocs_Nx;														// declare myrank_mpi (the rank of the current MPI process running), nprocs_mpi (the total number of MPI processes) & nprocs_Nx (the amount of MPI processes used for the collisionless VP problem)
-extern int chunksize_dg, chunksize_ft, chunk_Nx;													// declare chunksize_dg (the amount of data each processes works on during the DG method in the VP problem), chunksize_ft (the amount of data each process works on during the collisional problem) & chunk_Nx (the number of space-steps sent to each process in the collisional problem)
-
-extern int *fNegVals;																				// declare fNegVals (to store where DG solution goes negative - a 1 if negative and a 0 if positive)
-extern double *fAvgVals;																			// declare fAvgVals (to store the average values of f on each cell)
-extern double *fEquiVals;																			// declare f_equivals (to store the equilibrium solution)
+extern int chunksize_ft, chunk_Nx;																// declare chunksize_ft (the amount of data each process works on during the collisional problem) & chunk_Nx (the number of space-steps owned by each process, which it both advects & collides)
 
 //extern double a[3];
 
@@ -107,11 +123,17 @@ extern double *fEquiVals;																			// declare f_equivals (to store the
 #include "SetInit_1.h"																				// allows TrapezoidalRule, SetInit_LD, SetInit_4H, SetInit_2H & setInit_spectral to be used
 #include "conservationRoutines.h"         															// allows createCCtAndPivot & conserveAllMoments to be used
 #include "collisionRoutines_1.h"            														// allows generate_conv_weights, generate_conv_weights_linear, computeQ & RK4 to be used
-#include "MomentCalculations.h"																		// allows computeMass, computeMomentum, computeKiE, computeKiERatio, computeEleE to be used
-#include "EntropyCalculations.h"																	// allows computeEntropy, computeEntropy_wAvg & computeRelEntropy to be used
+#include "WeightCache.h"																			// allows loadConvWeights, writeWeightCache & freeConvWeights to be used
+#include "WeightSymmetry.h"																			// allows buildWeightSymmetry, generateSymWeights & freeSymWeights to be used
+#include "SpectralTransform.h"																		// allows initSpectralTransform, freeSpectralTransform, fft3D & FS to be used
+#include "CollisionContext.h"																		// allows chooseQParallel, allocCollisionContext & freeCollisionContext to be used
+#include "RunOptions.h"																				// allows readRunOptions to be used
+#include "MomentCalculations.h"																		// allows computeDiagnostics to be used
+#include "CellQuadrature.h"																		// allows initCellQuadrature, freeCellQuadrature, integrateRow & integrateCells to be used
+#include "EntropyCalculations.h"																	// allows computeRelEntropy to be used
 #include "MarginalCreation.h"																		// allows PrintMarginalLoc & PrintMarginal to be used
-#include "EquilibriumSolution.h"																	// allows ExportRhoQuadVals, ComputeEquiVals & PrintEquiVals to be used
-#include "NegativityChecks.h"																		// allows computeCellAvg, FindNegVals & CheckNegVals to be used
+#include "EquilibriumSolution.h"																	// allows ExportRhoQuadVals, ComputeEquiTables & PrintEquiVals to be used
+#include "NegativityChecks.h"																		// allows computeCellAvg, computeCellMin & CheckNegVals to be used
 #include "FieldCalculations.h"																		// allows PrintPhiVals to be used
 
 #endif /* LP_OMPI_H_ */
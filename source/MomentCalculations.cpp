@@ -1,111 +1,170 @@
 /* This is the source file which contains the subroutines necessary for calculating the moments of the
  * solution.
  *
- * Functions included: computeMass, computeMomentum, computeKiE, computeKiEratio, computeEleE
+ * Functions included: EleEFromMoments, computeDiagnostics
  *
  *  Created on: Nov 15, 2017
  */
 
 #include "MomentCalculations.h"																			// MomentCalculations.h is where the prototypes for the functions contained in this file are declared
 
-double computeMass(double *U)
+static double EleEFromMoments(double *moments)															// function to compute the electric energy from the two charge moments of each space cell, moments[2*i] = sum_j U[k*6+0] + U[k*6+5]/4. & moments[2*i+1] = sum_j U[k*6+1] (k = i*size_v + j)
 {
-  int k;
-  double tmp=0.;
-  #pragma omp parallel for shared(U) reduction(+:tmp)
-  for(k=0;k<Nx*size_v;k++) tmp += U[k*6+0] + U[k*6+5]/4.;
-
-  return tmp*dx*scalev;
-}
-
-void computeMomentum(double *U, double *a)
-{
-  int k, i, j,j1,j2,j3; //k=i*Nv*Nv*Nv + (j1*Nv*Nv + j2*Nv + j3);
-  double tmp1=0., tmp2=0., tmp3=0.;
-  a[0]=0.; a[1]=0.; a[2]=0.; // the three momentum
-  #pragma omp parallel for private(k,i,j,j1,j2,j3) shared(U) reduction(+:tmp1, tmp2, tmp3)  //reduction directive may change the result a little bit
-  for(k=0;k<Nx*size_v;k++){
-    j=k%size_v; i=(k-j)/size_v;
-    j3=j%Nv; j2=((j-j3)%(Nv*Nv))/Nv; j1=(j-j3-j2*Nv)/(Nv*Nv);
-    tmp1 += Gridv((double)j1)*dv*U[k*6+0] + U[k*6+2]*dv*dv/12. + U[k*6+5]*Gridv((double)j1)*dv/4.;
-    tmp2 += Gridv((double)j2)*dv*U[k*6+0] + U[k*6+3]*dv*dv/12. + U[k*6+5]*Gridv((double)j2)*dv/4.;
-    tmp3 += Gridv((double)j3)*dv*U[k*6+0] + U[k*6+4]*dv*dv/12. + U[k*6+5]*Gridv((double)j3)*dv/4.;
-  }
-  a[0]=tmp1*dx*dv*dv; a[1]=tmp2*dx*dv*dv; a[2]=tmp3*dx*dv*dv;
-}
+  int i;
+  double retn, tmp1=0., tmp2=0., tmp3=0., tmp4=0., tmp5=0., tmp6=0., tp1, tp2, c, sum_c0;
+  double ce1, cp1;
 
-double computeKiE(double *U)
-{
-  int k, i, j,j1,j2,j3;
-  double tmp=0., tp=0., tp1=0.;
-  //#pragma omp parallel for private(k,i,j,j1,j2,j3,tp, tp1) shared(U) reduction(+:tmp)
-  for(k=0;k<Nx*size_v;k++){
-    j=k%size_v; i=(k-j)/size_v;
-    j3=j%Nv; j2=((j-j3)%(Nv*Nv))/Nv; j1=(j-j3-j2*Nv)/(Nv*Nv);
-    //tp = ( pow(Gridv(j1+0.5), 3)- pow(Gridv(j1-0.5), 3) + pow(Gridv(j2+0.5), 3)- pow(Gridv(j2-0.5), 3) + pow(Gridv(j3+0.5), 3)- pow(Gridv(j3-0.5), 3) )/3.;
-    tp1 = Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3);
-    //tmp += U[k][0]*tp + (Gridv(j1)*U[k][2]+Gridv(j2)*U[k][3]+Gridv(j3)*U[k][4])*dv*dv/6. + U[k][5]*( dv*(dv*dv*3./80. + tp1/12.) + tp/6. );
-    tmp += U[k*6+0]*(tp1 + dv*dv/4.)*dv + (Gridv(j1)*U[k*6+2]+Gridv(j2)*U[k*6+3]+Gridv(j3)*U[k*6+4])*dv*dv/6. + U[k*6+5]*( dv*dv*dv*19./240. + tp1*dv/4.);
+  // RUNNING SUMS OVER THE EARLIER SPACE CELLS, AS IN computeFieldCoeffs (ce1 = computePhi_x_0(U), cp1 = computeC_rho(U,i) & c = Int_Int_rho(U,i)):
+  sum_c0 = 0.;
+  for(i=0;i<Nx;i++){
+    tmp1 += sum_c0 + 0.5*moments[2*i] - moments[2*i+1]/12.;
+    sum_c0 += moments[2*i];
   }
-  tmp *= dx*dv*dv;
-  return 0.5*tmp;
-}
-
-double computeKiEratio(double *U, int *NegVals)
-{
-	int k, i, j,j1,j2,j3;
-	double KiEpos, KiEneg;																	// declare KiEpos (the kinetic energy where f is positive all over the cells) & KiEneg (the kinetic energy where f goes negative in the cells)
-	double tmp=0., tp=0., tp1=0.;
-	KiEpos = 0;
-	KiEneg = 0;
-	#pragma omp parallel for private(k,i,j,j1,j2,j3,tp, tp1) shared(U) reduction(+:KiEpos,KiEneg)
-	for(k=0;k<Nx*size_v;k++)
-	{
-		if(NegVals[k] == 0)
-		{
-			j=k%size_v; i=(k-j)/size_v;
-			j3=j%Nv; j2=((j-j3)%(Nv*Nv))/Nv; j1=(j-j3-j2*Nv)/(Nv*Nv);
-			tp1 = Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3);
-			KiEpos += U[k*6+0]*(tp1 + dv*dv/4.)*dv + (Gridv(j1)*U[k*6+2]+Gridv(j2)*U[k*6+3]+Gridv(j3)*U[k*6+4])*dv*dv/6. + U[k*6+5]*( dv*dv*dv*19./240. + tp1*dv/4.);
-		}
-		else
-		{
-			j=k%size_v; i=(k-j)/size_v;
-			j3=j%Nv; j2=((j-j3)%(Nv*Nv))/Nv; j1=(j-j3-j2*Nv)/(Nv*Nv);
-			tp1 = Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3);
-			KiEneg += U[k*6+0]*(tp1 + dv*dv/4.)*dv + (Gridv(j1)*U[k*6+2]+Gridv(j2)*U[k*6+3]+Gridv(j3)*U[k*6+4])*dv*dv/6. + U[k*6+5]*( dv*dv*dv*19./240. + tp1*dv/4.);
-		}
-	}
-	return KiEneg/KiEpos;
-}
-
-double computeEleE(double *U)
-{
-  int k, i, j;
-  double retn, tmp1=0., tmp2=0., tmp3=0., tmp4=0., tmp5=0., tmp6=0., tmp7=0., tp1, tp2, c;
-  double ce1, cp1;
-  ce1 = computePhi_x_0(U);
+  ce1 = 0.5*Lx - tmp1*scalev*dx*dx/Lx;
 
   tmp1 = ce1*ce1*Lx;
   tmp2 = Lx*Lx*Lx/3.; tmp3 = -ce1*Lx*Lx;
 
-  //#pragma omp parallel for private(j,k, i, tp1, tp2, cp1, c) shared(U) reduction(+:tmp4, tmp5, tmp6)
+  sum_c0 = 0.;
   for(i=0;i<Nx;i++){
-    c = Int_Int_rho(U,i);
-    cp1 = computeC_rho(U,i);
+    tp1 = moments[2*i]; tp2 = moments[2*i+1];
+    c = (0.5*tp1 - tp2/12.)*dx*dx*scalev;
+    cp1 = sum_c0*dx*scalev;
+    sum_c0 += tp1;
     tmp4 += dx*cp1 + c;
     tmp5 += dx*Gridx((double)i)*cp1;
-    tp1=0.; tp2=0.;
-    for(j=0;j<size_v;j++){
-      k = i*size_v + j;
-      tp1 += (U[k*6+0] + U[k*6+5]/4.);
-      tp2 += U[k*6+1];
-    }
     tmp5 += scalev* (tp1*( (pow(Gridx(i+0.5), 3) - pow(Gridx(i-0.5), 3))/3. - Gridx(i-0.5)*Gridx((double)i)*dx ) - tp2 * dx*dx*Gridx((double)i)/12.);
 
     tp2 *= dx/2.;
-    tmp6 +=  cp1*cp1*dx + 2*cp1*c + pow(dv, 6)* ( tp1*tp1*dx*dx*dx/3. + tp2*tp2*dx/30. - tp1*tp2*dx*dx/6.);//+ tp1*tp2*(dx*Gridx((double)i)/6. - dx*dx/4.) ); //Int_Cumulativerho_sqr(i);
+    tmp6 +=  cp1*cp1*dx + 2*cp1*c + pow(dv, 6)* ( tp1*tp1*dx*dx*dx/3. + tp2*tp2*dx/30. - tp1*tp2*dx*dx/6.);
   }
   retn = tmp1 + tmp2 + tmp3 + 2*ce1*tmp4 - 2*tmp5 + tmp6;
   return 0.5*retn;
 }
+
+/*
+function computeDiagnostics
+---------------------------
+Calculates everything printed after each time step (the mass, momentum, kinetic energy, electric energy,
+entropy & the ratio of the kinetic energy in the cells where the average of f is negative to that in the
+others, with the number of cells where f is negative anywhere, from computeCellMin) in one sweep through U,
+rather than one sweep for each of them.
+The entropy, which needs f at all the quadrature points of each cell, is only calculated if entropy is 1,
+along with the relative entropy with respect to the equilibrium in rel_entropy unless that is NULL (both
+integrands share the values of f at the points of each row).
+The rows of Nv cells (i, j1, j2) are shared out between the OpenMP threads: each row adds its moments,
+its kinetic energy & the quadrature of f*log(f) at the points of its cells (see integrateRow) to the
+sums and stores the two charge moments it contributes to its space cell i (only for the rows of the space
+cells of this process).  The charge moments of each space cell are then added up in order and the
+electric energy follows from their running sums (O(Nx) work).
+Each MPI process only sweeps the space cells it owns (chunk_Nx*myrank_mpi <= i < chunk_Nx*(myrank_mpi+1)),
+so U only has to be up to date there, and the sums & charge moments are added together on the process
+with rank 0 with one MPI_Reduce (MUST BE CALLED BY ALL PROCESSES; only diag on rank 0 is set).
+*/
+void computeDiagnostics(double *U, int entropy, RelEntropyIntegrand *rel_entropy, Diagnostics *diag)
+{
+	int row, i, j1, j2, j3, k, n_neg, i_start, i_end, row_start;										// declare row (the index of the row of cells I_i x K_(j1,j2,j3) with j3 = 0,...,Nv-1, row = j2 + Nv*(j1 + Nv*i)), i, j1, j2, j3 (the indices of the cell), k (the location of the cell in U), n_neg (the number of cells where f is negative anywhere), i_start, i_end (the space cells of this process) & row_start (the first row of those)
+	double v1, v2, v3, tp1, avg, kin, c0, c1;															// declare v1, v2, v3 (the velocity at the center of the cell), tp1 (|v|^2 there), avg (the average of f on the cell), kin (the kinetic energy in the cell, without the factors common to all cells) & c0, c1 (the charge moments of the row)
+	double mass, a1, a2, a3, KiEpos, KiEneg, ent, rel_ent;												// declare mass, a1, a2, a3, KiEpos, KiEneg, ent & rel_ent (the sums for the mass, the three components of momentum, the kinetic energy where the average of f is positive & negative, the entropy and the relative entropy)
+	double *row_moments, *sums, *moments, *f_vals;														// declare row_moments (the charge moments of each row of this process), sums (the sums to be reduced, followed by moments, the charge moments of each space cell) & f_vals (the values of f at the quadrature points of the current row)
+	EntropyIntegrand integrand;																			// declare integrand (f*log(f))
+	RelEntropyIntegrand rel_integrand;																	// declare rel_integrand (f*log(f/f_eq), a copy of rel_entropy for each thread)
+
+#ifdef UseMPI
+	i_start = chunk_Nx*myrank_mpi;
+	i_end = (i_start + chunk_Nx < Nx) ? i_start + chunk_Nx : Nx;
+#else
+	i_start = 0; i_end = Nx;
+#endif
+	if(i_end < i_start) i_end = i_start;																// a process after the last slab owns no space cells
+	row_start = i_start*Nv*Nv;
+
+	row_moments = (double*)malloc(2*(i_end - i_start)*Nv*Nv*sizeof(double));
+	sums = (double*)malloc((DiagSums + 2*Nx)*sizeof(double));
+	moments = &sums[DiagSums];
+	mass = 0.; a1 = 0.; a2 = 0.; a3 = 0.; KiEpos = 0.; KiEneg = 0.; ent = 0.; rel_ent = 0.; n_neg = 0;
+	#pragma omp parallel private(row,i,j1,j2,j3,k,v1,v2,v3,tp1,avg,kin,c0,c1,f_vals,rel_integrand) firstprivate(integrand) shared(U,row_moments,i_start,i_end,row_start,entropy,rel_entropy) reduction(+:mass,a1,a2,a3,KiEpos,KiEneg,ent,rel_ent,n_neg)
+	{
+		if(rel_entropy != NULL)
+		{
+			rel_integrand = *rel_entropy;
+		}
+		f_vals = (double*)malloc(Nv*QuadPts*sizeof(double));
+		#pragma omp for
+		for(row=row_start;row<i_end*Nv*Nv;row++)
+		{
+			j1 = (row/Nv)%Nv; j2 = row%Nv;
+			v1 = Gridv((double)j1); v2 = Gridv((double)j2);
+			c0 = 0.; c1 = 0.;
+			for(j3=0;j3<Nv;j3++)
+			{
+				k = row*Nv + j3;																		// k = i*Nv^3 + j1*Nv^2 + j2*Nv + j3
+				v3 = Gridv((double)j3);
+				avg = U[k*6+0] + U[k*6+5]/4.;
+				c0 += avg;
+				c1 += U[k*6+1];
+				a1 += v1*dv*U[k*6+0] + U[k*6+2]*dv*dv/12. + U[k*6+5]*v1*dv/4.;							// the momentum
+				a2 += v2*dv*U[k*6+0] + U[k*6+3]*dv*dv/12. + U[k*6+5]*v2*dv/4.;
+				a3 += v3*dv*U[k*6+0] + U[k*6+4]*dv*dv/12. + U[k*6+5]*v3*dv/4.;
+				tp1 = v1*v1 + v2*v2 + v3*v3;
+				kin = U[k*6+0]*(tp1 + dv*dv/4.)*dv + (v1*U[k*6+2]+v2*U[k*6+3]+v3*U[k*6+4])*dv*dv/6. + U[k*6+5]*( dv*dv*dv*19./240. + tp1*dv/4.);	// the kinetic energy
+				if(avg < 0)																				// the cells counted as negative for the kinetic energy ratio
+				{
+					KiEneg += kin;
+				}
+				else
+				{
+					KiEpos += kin;
+				}
+				if(computeCellMin(U, k) < 0)															// the exact minimum of f on the cell, so that cells which are only negative in part are counted too
+				{
+					n_neg++;
+				}
+			}
+			mass += c0;
+			row_moments[2*(row-row_start)] = c0; row_moments[2*(row-row_start)+1] = c1;
+
+			if(entropy == 1)
+			{
+				evalCellQuadrature(U, row, f_vals);														// the values of f at the quadrature points of the row
+				ent += integrateRow(f_vals, row, integrand);											// the quadrature of f*log(f) on the cells of the row
+				if(rel_entropy != NULL)
+				{
+					rel_ent += integrateRow(f_vals, row, rel_integrand);								// and of f*log(f/f_eq)
+				}
+			}
+		}
+		free(f_vals);
+	}
+
+	for(i=0;i<Nx;i++)																					// add up the charge moments of the rows in each space cell (those of the other processes are left as 0)
+	{
+		c0 = 0.; c1 = 0.;
+		if(i >= i_start && i < i_end)
+		{
+			for(row=i*Nv*Nv;row<(i+1)*Nv*Nv;row++)
+			{
+				c0 += row_moments[2*(row-row_start)]; c1 += row_moments[2*(row-row_start)+1];
+			}
+		}
+		moments[2*i] = c0; moments[2*i+1] = c1;
+	}
+	sums[0] = mass; sums[1] = a1; sums[2] = a2; sums[3] = a3;
+	sums[4] = KiEpos; sums[5] = KiEneg; sums[6] = ent; sums[7] = n_neg; sums[8] = rel_ent;
+#ifdef UseMPI
+	MPI_Reduce((myrank_mpi == 0) ? MPI_IN_PLACE : sums, sums, DiagSums + 2*Nx, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+#endif
+
+	if(myrank_mpi == 0)
+	{
+		diag->mass = sums[0]*dx*scalev;
+		diag->momentum[0] = sums[1]*dx*dv*dv; diag->momentum[1] = sums[2]*dx*dv*dv; diag->momentum[2] = sums[3]*dx*dv*dv;
+		diag->KiE = 0.5*(sums[4] + sums[5])*dx*dv*dv;
+		diag->KiEratio = sums[5]/sums[4];
+		diag->n_neg = (int)sums[7];
+		diag->EleE = EleEFromMoments(moments);
+		diag->ent = sums[6]*dx*scalev;
+		diag->rel_ent = sums[8]*dx*scalev;
+	}
+	free(row_moments); free(sums);
+}
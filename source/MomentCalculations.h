@@ -20,17 +20,33 @@
 #include "FieldCalculations.h"																			// allows the function prototypes declared in FieldCalculations.h to be used in the advection_1 functions
 
 //************************//
-//   FUNCTION PROTOTYPES  //
+//         MACROS         //
 //************************//
 
-double computeMass(double *U);
+#define DiagSums 9																						// the number of sums over the cells added together by computeDiagnostics (mass, three components of momentum, kinetic energy where the average of f is positive & negative, entropy, the number of negative cells & relative entropy), before the charge moments
+
+//************************//
+//    DATA STRUCTURES     //
+//************************//
 
-void computeMomentum(double *U, double *a);
+struct RelEntropyIntegrand;																				// the integrand of the relative entropy (declared in EntropyCalculations.h, which includes this file through LP_ompi.h)
 
-double computeKiE(double *U);
+typedef struct
+{
+	double mass;																						// the mass
+	double momentum[3];																					// the three components of momentum
+	double KiE;																							// the kinetic energy
+	double KiEratio;																					// the ratio of the kinetic energy in the cells where the average of f is negative to that in the others
+	int n_neg;																							// the number of cells where f is negative anywhere (computeCellMin)
+	double EleE;																						// the electric energy
+	double ent;																							// the entropy (only if it was asked for)
+	double rel_ent;																						// the relative entropy with respect to the equilibrium of the option -relentropy (only if it was asked for, with the entropy)
+} Diagnostics;
 
-double computeKiEratio(double *U, int *NegVals);
+//************************//
+//   FUNCTION PROTOTYPES  //
+//************************//
 
-double computeEleE(double *U);
+void computeDiagnostics(double *U, int entropy, RelEntropyIntegrand *rel_entropy, Diagnostics *diag);
 
 #endif /* MOMENTCALCULATIONS_H_ */
@@ -24,9 +24,7 @@
 
 double computeCellAvg(double *U, int i, int j1, int j2, int j3);
 
-void FindNegVals(double *U, int *NegVals, double *AvgVals);
-
-void FindNegVals_old(double *U, int *NegVals);
+double computeCellMin(double *U, int k);
 
 void CheckNegVals(double *U, int *NegVals, double *AvgVals);
 
@@ -0,0 +1,172 @@
+/* This is the source file which contains the subroutines necessary for reading the options given on
+ * the command line when the solver is run, which can be used to change the choices that do not affect
+ * the results of a run (only how they are computed, or what is printed and how often) without recompiling.
+ * The default for each option is the value given to the corresponding variable in LP_ompi.cpp.
+ *
+ * The options currently available are:
+ *	-qmethod direct|matrixfree|fft|symmetric
+ *								the method used for the convolution in ComputeQ (sets QMethod)
+ *	-qcheck							compare qHat from this method with the matrix-free quadrature (the same sum as the direct
+ *								method) at the start of the run, so not with -qmethod matrixfree (sets QCheck)
+ *	-qbatch n|all						compute the collision steps of up to n space-steps (or of the whole chunk of space
+ *								of each process) together, with batched FFTs (sets QBatch)
+ *	-qparallel auto|cells|modes
+ *								share out the space-steps (cells) or the loops inside each collision step (modes)
+ *								between the OpenMP threads, or choose between them from N & chunk_Nx (sets QParallel;
+ *								cells is replaced by modes with -qbatch, whose batches are computed one after another)
+ *	-mpiprogress						have the master thread poll the ghost exchange of the advection with MPI_Testall while
+ *								the interior planes are calculated, for MPI libraries without asynchronous progress (sets MPIProgress)
+ *	-momentstep n						print the moments (mass, momentum & energies) after every n-th time-step (sets MomentStep)
+ *	-entropystep n						print the entropy after every n-th time-step (sets EntropyStep)
+ *	-marginalstep n						print the marginals after every n-th time-step, starting with the first (sets MarginalStep)
+ *	-relentropy file					also print the relative entropy with the entropy, with respect to the equilibrium whose density
+ *								is read from file (as written by ExportRhoQuadVals) (sets RelEntropyFile)
+ *
+ * Functions included: readRunOptions, QMethodName, QParallelName
+ *
+ */
+
+#include "RunOptions.h"																					// RunOptions.h is where the prototypes for the functions contained in this file are declared
+
+#include <string.h>																						// allows strcmp to be used
+
+const char *QMethodName(int method)																		// function to return the name of the convolution method labelled by method (as used for the option -qmethod)
+{
+	switch(method)
+	{
+		case QDirect:		return "direct";
+		case QMatrixFree:	return "matrixfree";
+		case QFFT:			return "fft";
+		case QSymmetric:	return "symmetric";
+		default:			return "unknown";
+	}
+}
+
+const char *QParallelName(int mode)																	// function to return the name of the way the collision steps are shared out between the threads labelled by mode (as used for the option -qparallel)
+{
+	switch(mode)
+	{
+		case QParallelAuto:		return "auto";
+		case QParallelCells:	return "cells";
+		case QParallelModes:	return "modes";
+		default:				return "unknown";
+	}
+}
+
+static void runOptionError(const char *message, const char *option)									// function to display an error with the command line options and stop the run (all processes read the same options, so all of them stop)
+{
+	if(myrank_mpi == 0)
+	{
+		printf("Error: %s %s\n", message, option);
+		printf("Usage: solver [-qmethod direct|matrixfree|fft|symmetric] [-qcheck] [-qbatch n|all] [-qparallel auto|cells|modes] [-mpiprogress]\n"
+				"       [-momentstep n] [-entropystep n] [-marginalstep n] [-relentropy file]\n");
+	}
+	#ifdef UseMPI
+	MPI_Finalize();																						// ensure that MPI exits cleanly
+	#endif
+	exit(1);
+}
+
+void readRunOptions(int argc, char *argv[])															// function to set the variables controlled by the command line options in argv (MUST BE CALLED BY ALL PROCESSES, after MPI has been initialised)
+{
+	int i, method, mode, step;																			// declare i (a counter for the arguments), method (a counter for the convolution methods), mode (a counter for the ways of sharing out the collision steps) & step (the number of time-steps given to -momentstep, -entropystep or -marginalstep)
+
+	for(i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i], "-qmethod") == 0)
+		{
+			if(i+1 == argc)
+			{
+				runOptionError("no value given for the option", argv[i]);
+			}
+			i++;
+			for(method=QDirect;method<QNumMethods;method++)
+			{
+				if(strcmp(argv[i], QMethodName(method)) == 0)
+				{
+					break;
+				}
+			}
+			if(method == QNumMethods)
+			{
+				runOptionError("unknown convolution method", argv[i]);
+			}
+			QMethod = method;																			// use the method named after -qmethod for the convolution in ComputeQ
+		}
+		else if(strcmp(argv[i], "-qcheck") == 0)
+		{
+			QCheck = 1;																					// check the method against the matrix-free quadrature at the start of the run
+		}
+		else if(strcmp(argv[i], "-qbatch") == 0)
+		{
+			if(i+1 == argc || (atoi(argv[i+1]) < 1 && strcmp(argv[i+1], "all") != 0))
+			{
+				runOptionError("the number of space-steps in a batch must be at least 1 (or all) for the option", argv[i]);
+			}
+			i++;
+			QBatch = (strcmp(argv[i], "all") == 0) ? Nx : atoi(argv[i]);								// compute the collision steps of up to this many space-steps together (all of them is cut down to the chunk of space of each process in main)
+		}
+		else if(strcmp(argv[i], "-qparallel") == 0)
+		{
+			if(i+1 == argc)
+			{
+				runOptionError("no value given for the option", argv[i]);
+			}
+			i++;
+			for(mode=QParallelAuto;mode<QNumParallel;mode++)
+			{
+				if(strcmp(argv[i], QParallelName(mode)) == 0)
+				{
+					break;
+				}
+			}
+			if(mode == QNumParallel)
+			{
+				runOptionError("unknown way of sharing out the collision steps", argv[i]);
+			}
+			QParallel = mode;																			// share out the collision steps between the threads as named after -qparallel
+		}
+		else if(strcmp(argv[i], "-mpiprogress") == 0)
+		{
+			MPIProgress = 1;																			// poll the ghost exchange of each stage of RK3 while its interior planes are calculated
+		}
+		else if(strcmp(argv[i], "-momentstep") == 0 || strcmp(argv[i], "-entropystep") == 0 || strcmp(argv[i], "-marginalstep") == 0)
+		{
+			if(i+1 == argc || atoi(argv[i+1]) < 1)
+			{
+				runOptionError("the number of time-steps must be at least 1 for the option", argv[i]);
+			}
+			step = atoi(argv[i+1]);
+			if(strcmp(argv[i], "-momentstep") == 0)
+			{
+				MomentStep = step;																		// print the moments after every step-th time-step
+			}
+			else if(strcmp(argv[i], "-entropystep") == 0)
+			{
+				EntropyStep = step;																		// print the entropy after every step-th time-step
+			}
+			else
+			{
+				MarginalStep = step;																	// print the marginals after every step-th time-step
+			}
+			i++;
+		}
+		else if(strcmp(argv[i], "-relentropy") == 0)
+		{
+			if(i+1 == argc)
+			{
+				runOptionError("no file given for the option", argv[i]);
+			}
+			i++;
+			RelEntropyFile = argv[i];																	// calculate the relative entropy with respect to the equilibrium density in this file
+		}
+		else
+		{
+			runOptionError("unknown option", argv[i]);
+		}
+	}
+	if(QCheck && QMethod == QMatrixFree)
+	{
+		runOptionError("the matrix-free method is the reference quadrature, so it can't be checked with the option", "-qcheck");	// checkComputeQ would compare the method with itself (the weights of the direct method aren't loaded for any other method)
+	}
+}
@@ -0,0 +1,30 @@
+/* This is the header file associated to RunOptions.cpp in which the prototypes for the functions
+ * contained in that file are declared.  Any other header files which must be linked to for the
+ * functions here are also included.
+ *
+ */
+
+//************************//
+//     INCLUDE GUARDS     //
+//************************//
+
+#ifndef RUNOPTIONS_H_
+#define RUNOPTIONS_H_
+
+//************************//
+//        INCLUDES        //
+//************************//
+
+#include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the RunOptions functions
+
+//************************//
+//   FUNCTION PROTOTYPES  //
+//************************//
+
+void readRunOptions(int argc, char *argv[]);
+
+const char *QMethodName(int method);
+
+const char *QParallelName(int mode);
+
+#endif /* RUNOPTIONS_H_ */
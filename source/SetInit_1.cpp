@@ -2,7 +2,7 @@
  * projecting to the function required as the initial condition to the spectral method for the collision problem
  * resulting from time-splitting, as well as the function for setting the trapezoidal weights.
  *
- * Functions included: trapezoidalRule, f_TS, f_2Gauss, Mw, Mw_x, f_2H, SetInit_LD, SetInit_4H, SetInit_2H,
+ * Functions included: trapezoidalRule, setSpectralDomains, f_TS, f_2Gauss, Mw, Mw_x, f_2H, SetInit_LD, SetInit_4H, SetInit_2H,
  * setInit_spectral
  *
  */
@@ -26,6 +26,28 @@ void trapezoidalRule(int nPoints, double *weight)
 	for(i=1;i<nPoints-1;i++) weight[i] = 1.0;
 }
 
+void setSpectralDomains()																						// function to set the commonly used constants and the discretised velocity & Fourier domains (v, eta & the trapezoidal weights wtN, which must already be allocated) for the spectral method
+{
+	int i;																										// declare i (a counter for the nodes)
+
+	// COMMONLY USED CONSTANTS:
+	scale = 1.0/sqrt(2.0*M_PI);																					// set scale to 1/sqrt(2*pi)
+	scale3 = pow(scale, 3.0);																					// set scale3 to scale^3
+
+	//INITIALISE VELOCITY AND FOURIER DOMAINS:
+	L_v = Lv;//sqrt(0.5*(double)N*PI); 																			// set L_v to Lv
+	L_eta = 0.5*(double)(N-1)*PI/L_v;					// BUG: N-1?											// set L_eta to (N-1)*Pi/(2*L_v)
+	h_v = 2.0*L_v/(double)(N-1);						// BUG: N-1?											// set h_v to 2*L_v/(N-1)
+	h_eta = 2.0*L_eta/(double)(N);						// BUG: N?												// set h_eta to 2*L_eta/N
+	for(i=0;i<N;i++)																							// store the discretised velocity and Fourier space points
+	{
+		eta[i] = -L_eta + (double)i*h_eta;																		// set the ith value of eta to -L_eta + i*h_eta
+		v[i] = -L_v + (double)i*h_v;																			// set the ith value of v to -L_v + i*h_v
+	}
+
+	trapezoidalRule(N, wtN);																					// set wtN to the weights required for a trapezoidal rule with N points
+}
+
 double f_TS(double v1, double v2, double v3) //two-stream instability initial
 {
   double r2=v1*v1+v2*v2+v3*v3;
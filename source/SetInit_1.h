@@ -24,6 +24,8 @@
 
 void trapezoidalRule(int nPoints, double *weight);
 
+void setSpectralDomains();
+
 double f_TS(double v1, double v2, double v3);
 
 double f_2Gauss(double v1, double v2, double v3);
@@ -0,0 +1,296 @@
+/* This is the source file which contains the subroutines necessary for the shifted spectral transforms
+ * between the velocity domain v and the Fourier domain eta (fft3D, ifft3D & FS).
+ *
+ * Since v[i] = -L_v + i*h_v & eta[i] = -L_eta + i*h_eta, every phase shift the transforms apply before
+ * and after the FFT depends only on i+j+k, so the cos & sin of each of them are computed once for the
+ * 3N-2 values of i+j+k by initSpectralTransform, together with the quadrature weights (and, for fft3D,
+ * the shift before the FFT, which is +/-1 as L_eta*h_v = PI), and each transform is then only a few
+ * multiplies fused with the copies into and out of the work array.  The FFTs themselves are real-to-complex
+ * & complex-to-real, stored in place in the work array the caller passes (the temp array of its
+ * CollisionContext, see hermitianHalf), so that several transforms can run at the same time.
+ *
+ * The batched versions (fft3D_Batch & FS_Batch) transform the cells of a batch of space-steps with one
+ * call of fftw3, through plans for spectral.n_batch cubes stored one after another.
+ *
+ * Functions included: initSpectralTransform, freeSpectralTransform, forwardShiftIn, forwardShiftOut, fft3D,
+ * fft3D_Batch, hermitianHalf, inverseShiftOut, ifft3D, FS, FS_Batch
+ *
+ */
+
+#include "SpectralTransform.h"																			// SpectralTransform.h is where the prototypes for the functions contained in this file are declared
+
+SpectralTransform spectral;																				// declare spectral (the phase shifts & weights of fft3D, ifft3D & FS, computed once by initSpectralTransform)
+
+void initSpectralTransform(SpectralTransform *st)														// function to compute the phase shifts & quadrature weights of the spectral transforms in st (once v, eta, wtN, h_v, h_eta, L_v, L_eta & scale3 have been set by setSpectralDomains)
+{
+	int i, j, k, s;																						// declare i, j, k (counters for the grid) & s (the value of i+j+k)
+	double sum;																							// declare sum (the phase of a shift)
+
+	st->n_sums = 3*N - 2;
+	st->n_batch = (QBatch > 1) ? QBatch : 0;
+	st->forward_in = (double *)malloc(size_ft*sizeof(double));
+	st->inverse_wt = (double *)malloc(size_ft*sizeof(double));
+	st->forward_cos = (double *)malloc(st->n_sums*sizeof(double));
+	st->forward_sin = (double *)malloc(st->n_sums*sizeof(double));
+	st->inverse_cos = (double *)malloc(st->n_sums*sizeof(double));
+	st->inverse_sin = (double *)malloc(st->n_sums*sizeof(double));
+	st->inverse_sign = (double *)malloc(st->n_sums*sizeof(double));
+
+	for(s=0;s<st->n_sums;s++)
+	{
+		sum = L_v*(-3.*L_eta + (double)s*h_eta);														// L_v*(eta[i] + eta[j] + eta[k]) for i+j+k = s
+		st->forward_cos[s] = cos(sum);
+		st->forward_sin[s] = sin(sum);
+		sum = 3.*L_eta*L_v - (double)s*L_v*h_eta;														// the shift of the 'eta' terms before the inverse FFT, together with the constant part of the shift of the 'v' terms after it
+		st->inverse_cos[s] = cos(sum);
+		st->inverse_sin[s] = sin(sum);
+		st->inverse_sign[s] = cos((double)s*L_eta*h_v);													// the rest of the shift of the 'v' terms (+/-1, so the output stays real)
+	}
+
+	for(i=0;i<N;i++)
+	{
+		for(j=0;j<N;j++)
+		{
+			for(k=0;k<N;k++)
+			{
+				//h_v & h_eta correspond to the velocity & Fourier space scalings - they ensure that the FFTs are properly scaled since fftw does no scaling at all
+				st->forward_in[k + N*(j + N*i)] = scale3*h_v*h_v*h_v*wtN[i]*wtN[j]*wtN[k]*cos((double)(i+j+k)*L_eta*h_v);
+				st->inverse_wt[k + N*(j + N*i)] = h_eta*h_eta*h_eta*wtN[i]*wtN[j]*wtN[k];
+			}
+		}
+	}
+}
+
+void freeSpectralTransform(SpectralTransform *st)														// function to delete the dynamic memory allocated for the phase shifts & weights in st
+{
+	free(st->forward_in); free(st->inverse_wt);
+	free(st->forward_cos); free(st->forward_sin);
+	free(st->inverse_cos); free(st->inverse_sin); free(st->inverse_sign);
+}
+
+/*$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$*/
+
+/*
+function forwardShiftIn & forwardShiftOut
+-----------------------------------------
+The two halves of fft3D around the real-to-complex FFT: forwardShiftIn stores the real vector in, with
+the weights & shift of the 'v' terms, in work (each row padded to 2*(N/2+1) doubles) and forwardShiftOut
+shifts the 'eta' terms of the half spectrum in work into out, filling in the modes with k > N/2 from the
+conjugates of their mirror images
+*/
+static void forwardShiftIn(double *in, fftw_complex *work)
+{
+  int i, j, k, row;
+  int N_half = N/2 + 1;
+  double *temp_real = (double *)work; // the input of the real-to-complex FFT, stored in place in work with each row padded to 2*(N/2+1) doubles
+  double *fw_in = spectral.forward_in;
+
+  for(i=0;i<N;i++)
+    for(j=0;j<N;j++)
+      {
+	row = N*(j + N*i);
+	#pragma omp simd
+	for(k=0;k<N;k++)
+	  temp_real[k + 2*N_half*(j + N*i)] = fw_in[row + k]*in[row + k];
+      }
+}
+
+static void forwardShiftOut(fftw_complex *work, fftw_complex *out)
+{
+  int i, j, k, s, row, row_half, row_mirror;
+  int N_half = N/2 + 1;
+  double *fw_cos = spectral.forward_cos, *fw_sin = spectral.forward_sin;
+
+  for(i=0;i<N;i++)
+    for(j=0;j<N;j++)
+      {
+	row = N*(j + N*i);
+	row_half = N_half*(j + N*i);
+	row_mirror = N_half*((N-j)%N + N*((N-i)%N));
+	#pragma omp simd private(s)
+	for(k=0;k<N_half;k++)
+	  {
+	    s = i + j + k;
+	    out[row + k][0] = fw_cos[s]*work[row_half + k][0] - fw_sin[s]*work[row_half + k][1];
+	    out[row + k][1] = fw_cos[s]*work[row_half + k][1] + fw_sin[s]*work[row_half + k][0];
+	  }
+	#pragma omp simd private(s)
+	for(k=N_half;k<N;k++)
+	  {
+	    s = i + j + k;
+	    out[row + k][0] = fw_cos[s]*work[row_mirror + N - k][0] + fw_sin[s]*work[row_mirror + N - k][1];
+	    out[row + k][1] = -fw_cos[s]*work[row_mirror + N - k][1] + fw_sin[s]*work[row_mirror + N - k][0];
+	  }
+      }
+}
+
+/*
+function fft3D
+--------------
+Computes the fourier transform of the real vector in, and adjusts the coefficients based on our v, eta
+(since in is real, this uses a real-to-complex FFT, which only computes the modes with k <= N/2, the
+others being the complex conjugates of their mirror images)
+*/
+void fft3D(double *in, fftw_complex *out, fftw_complex *work)
+{
+  //shift the 'v' terms in the exponential to reflect our velocity domain (with the weights, from spectral.forward_in)
+  forwardShiftIn(in, work);
+  //computes fft
+  fftw_execute_dft_r2c(p_forward, (double *)work, work);
+  //shifts the 'eta' terms to reflect our fourier domain
+  forwardShiftOut(work, out);
+}
+
+/*
+function fft3D_Batch
+--------------------
+Computes fft3D(in[b], out[b]) for the n_cells real vectors in[0], ..., in[n_cells-1].  If n_cells is
+spectral.n_batch, the cells are stored one after another in work (which must hold n_cells copies of temp)
+and transformed together by the one batched plan p_forward_batch, with the shifts before and after it
+shared out between the threads cell by cell; otherwise each cell is transformed in turn in the start of work.
+*/
+void fft3D_Batch(double **in, fftw_complex **out, int n_cells, fftw_complex *work)
+{
+  int b;
+  int size_half = N*N*(N/2+1);
+
+  if(n_cells != spectral.n_batch)
+    {
+      for(b=0;b<n_cells;b++)
+	fft3D(in[b], out[b], work);
+      return;
+    }
+
+  #pragma omp parallel for private(b) shared(in, work)
+  for(b=0;b<n_cells;b++)
+    forwardShiftIn(in[b], &work[b*size_half]);
+  fftw_execute_dft_r2c(p_forward_batch, (double *)work, work);
+  #pragma omp parallel for private(b) shared(out, work)
+  for(b=0;b<n_cells;b++)
+    forwardShiftOut(&work[b*size_half], out[b]);
+}
+
+/*$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$*/
+/*
+function hermitianHalf
+----------------------
+Stores in work the half spectrum (k <= N/2) of the hermitian part of in, with the 'eta' terms shifted
+to reflect our fourier domain (and the quadrature weights applied if weighted is 1), so that the
+complex-to-real inverse FFT of work is the real part of the inverse FFT of the shifted in
+(the constant part of the shift of the 'v' terms is also applied here, leaving only a factor of
+spectral.inverse_sign = +/-1 for after the inverse FFT)
+*/
+
+void hermitianHalf(fftw_complex *in, int weighted, fftw_complex *work)
+{
+  int i, j, k, k_m, s, s_m, row, row_m, row_half;
+  int N_half = N/2 + 1;
+  double wt, wt_m, re, im, re_m, im_m;
+  double *inv_cos = spectral.inverse_cos, *inv_sin = spectral.inverse_sin, *inv_wt = spectral.inverse_wt;
+
+  for(i=0;i<N;i++)
+    for(j=0;j<N;j++)
+      {
+	row = N*(j + N*i);
+	row_m = N*((N-j)%N + N*((N-i)%N));
+	row_half = N_half*(j + N*i);
+	#pragma omp simd private(k_m,s,s_m,wt,wt_m,re,im,re_m,im_m)
+	for(k=0;k<N_half;k++)
+	  {
+	    k_m = (k == 0) ? 0 : N - k;
+	    s = i + j + k;
+	    s_m = (N-i)%N + (N-j)%N + k_m;
+	    wt = weighted ? inv_wt[row + k] : 1.;
+	    wt_m = weighted ? inv_wt[row_m + k_m] : 1.;
+
+	    re = wt*(inv_cos[s]*in[row + k][0] - inv_sin[s]*in[row + k][1]);
+	    im = wt*(inv_cos[s]*in[row + k][1] + inv_sin[s]*in[row + k][0]);
+	    re_m = wt_m*(inv_cos[s_m]*in[row_m + k_m][0] - inv_sin[s_m]*in[row_m + k_m][1]);
+	    im_m = wt_m*(inv_cos[s_m]*in[row_m + k_m][1] + inv_sin[s_m]*in[row_m + k_m][0]);
+
+	    work[row_half + k][0] = 0.5*(re + re_m);
+	    work[row_half + k][1] = 0.5*(im - im_m);
+	  }
+      }
+}
+
+/*
+function inverseShiftOut
+------------------------
+Shifts the 'v' terms of the real output of the complex-to-real inverse FFT stored in place in work
+(see hermitianHalf) to reflect our velocity domain and stores it, times numScale, in out
+*/
+static void inverseShiftOut(fftw_complex *work, double *out, double numScale)
+{
+  int i, j, k, row;
+  int N_half = N/2 + 1;
+  double *temp_real = (double *)work, *inv_sign = spectral.inverse_sign;
+
+  for(i=0;i<N;i++)
+    for(j=0;j<N;j++)
+      {
+	row = N*(j + N*i);
+	#pragma omp simd
+	for(k=0;k<N;k++)
+	  out[row + k] = inv_sign[i+j+k]*temp_real[k + 2*N_half*(j + N*i)]*numScale;
+      }
+}
+
+/*$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$*/
+/*
+function ifft3D
+---------------
+Computes the real part of the inverse fourier transform of in (out), and adjusts the coefficients based on our v, eta
+*/
+
+void ifft3D(fftw_complex *in, double *out, fftw_complex *work)
+{
+  double numScale = scale3;//= pow((double)N, -3.0);
+
+  //shifts the 'eta' terms to reflect our fourier domain
+  hermitianHalf(in, 1, work);
+  //compute IFFT
+  fftw_execute_dft_c2r(p_backward, work, (double *)work);
+  //shifts the 'v' terms to reflect our velocity domain
+  inverseShiftOut(work, out, numScale);
+}
+
+void FS(fftw_complex *in, double *out, fftw_complex *work) // compute the Fourier series approximation of f (out), through fhat (in) - only its real part is kept, so this uses a complex-to-real IFFT
+{
+  double numScale = 1./scaleL/scale3;
+
+  //shifts the 'eta' terms to reflect our fourier domain
+  hermitianHalf(in, 0, work);
+  //compute IFFT
+  fftw_execute_dft_c2r(p_backward, work, (double *)work);
+  //shifts the 'v' terms to reflect our velocity domain
+  inverseShiftOut(work, out, numScale);
+}
+
+/*
+function FS_Batch
+-----------------
+Computes FS(in[b], out[b]) for the n_cells cells in[0], ..., in[n_cells-1], with the one batched plan
+p_backward_batch if n_cells is spectral.n_batch (see fft3D_Batch) and cell by cell otherwise.
+*/
+void FS_Batch(fftw_complex **in, double **out, int n_cells, fftw_complex *work)
+{
+  int b;
+  int size_half = N*N*(N/2+1);
+  double numScale = 1./scaleL/scale3;
+
+  if(n_cells != spectral.n_batch)
+    {
+      for(b=0;b<n_cells;b++)
+	FS(in[b], out[b], work);
+      return;
+    }
+
+  #pragma omp parallel for private(b) shared(in, work)
+  for(b=0;b<n_cells;b++)
+    hermitianHalf(in[b], 0, &work[b*size_half]);
+  fftw_execute_dft_c2r(p_backward_batch, work, (double *)work);
+  #pragma omp parallel for private(b) shared(out, work, numScale)
+  for(b=0;b<n_cells;b++)
+    inverseShiftOut(&work[b*size_half], out[b], numScale);
+}
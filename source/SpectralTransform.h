@@ -0,0 +1,62 @@
+/* This is the header file associated to SpectralTransform.cpp in which the record of the precomputed
+ * phase shifts and quadrature weights of the spectral transforms, the prototypes for the functions
+ * contained in that file and the external variables they set are declared.  Any other header files
+ * which must be linked to for the functions here are also included.
+ *
+ */
+
+//************************//
+//     INCLUDE GUARDS     //
+//************************//
+
+#ifndef SPECTRALTRANSFORM_H_
+#define SPECTRALTRANSFORM_H_
+
+//************************//
+//        INCLUDES        //
+//************************//
+
+#include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the SpectralTransform functions
+
+//************************//
+//    DATA STRUCTURES     //
+//************************//
+
+typedef struct
+{
+	int n_sums;																							// the number of values of i+j+k for the indices (i,j,k) of the grid, 3N-2 (every phase shift depends only on i+j+k)
+	double *forward_in;																					// forward_in[k + N*(j + N*i)] = scale3*h_v^3*wtN[i]*wtN[j]*wtN[k]*cos((i+j+k)*L_eta*h_v), the factor fft3D multiplies its (real) input by
+	double *forward_cos, *forward_sin;																	// forward_cos[s] & forward_sin[s] are the cos & sin of L_v*(eta[i] + eta[j] + eta[k]) for i+j+k = s (the shift fft3D applies to its output)
+	double *inverse_cos, *inverse_sin;																	// inverse_cos[s] & inverse_sin[s] are the cos & sin of 3*L_eta*L_v - s*L_v*h_eta (the shift hermitianHalf applies to its input)
+	double *inverse_sign;																				// inverse_sign[s] = cos(s*L_eta*h_v) = +/-1 (the shift left to apply to the output of ifft3D & FS)
+	double *inverse_wt;																					// inverse_wt[k + N*(j + N*i)] = h_eta^3*wtN[i]*wtN[j]*wtN[k], the quadrature weights of ifft3D
+	int n_batch;																						// the number of cells transformed together by the batched plans p_forward_batch & p_backward_batch (QBatch, or 0 if there are no batches)
+} SpectralTransform;
+
+//************************//
+//   EXTERNAL VARIABLES   //
+//************************//
+
+extern SpectralTransform spectral;																		// declare spectral (the phase shifts & weights of fft3D, ifft3D & FS, computed once by initSpectralTransform)
+
+//************************//
+//   FUNCTION PROTOTYPES  //
+//************************//
+
+void initSpectralTransform(SpectralTransform *st);
+
+void freeSpectralTransform(SpectralTransform *st);
+
+void fft3D(double *in, fftw_complex *out, fftw_complex *work);
+
+void fft3D_Batch(double **in, fftw_complex **out, int n_cells, fftw_complex *work);
+
+void hermitianHalf(fftw_complex *in, int weighted, fftw_complex *work);
+
+void ifft3D(fftw_complex *in, double *out, fftw_complex *work);
+
+void FS(fftw_complex *in, double *out, fftw_complex *work);
+
+void FS_Batch(fftw_complex **in, double **out, int n_cells, fftw_complex *work);
+
+#endif /* SPECTRALTRANSFORM_H_ */
@@ -0,0 +1,304 @@
+/* This is the source file which contains the subroutines necessary for storing the convolution weights
+ * of the collision operator in, and loading them from, the binary weight cache files in Weights/.
+ *
+ * A weight cache file consists of a WeightCacheHeader (recording the version of the layout, the type
+ * of operator and the values of N, L_v & R_v used, as well as a checksum of the weights) followed by
+ * the size_ft*size_ft weights, stored row by row as doubles.  The files are mapped read-only into
+ * memory, so that the rows of conv_weights point directly into the file and nothing has to be read
+ * in or recomputed at the start of a run (the operating system shares the pages between all of the
+ * processes on a node).  When the weights have to be computed, they are stored in an MPI-3 shared
+ * memory window instead, so that there is still only one copy of them on each node.  The rows are then
+ * shared out between every process (on all of the nodes) to compute them, and the first process on each
+ * node gathers the rows computed on the other nodes into its window.  Without MPI the only process
+ * computes every row, in memory allocated with malloc.
+ *
+ * Functions included: weightCacheName, weightChecksum, writeWeightCache, mapWeightCache, allocConvWeights,
+ * generateConvWeights, loadConvWeights, freeConvWeights
+ *
+ */
+
+#include "WeightCache.h"																				// WeightCache.h is where the prototypes for the functions contained in this file are declared
+
+#include <string.h>																						// allows memcpy, memset, strncpy & strncmp to be used
+#include <fcntl.h>																						// allows open to be used
+#include <unistd.h>																						// allows close to be used
+#include <sys/stat.h>																					// allows fstat to be used
+#include <sys/mman.h>																					// allows mmap & munmap to be used
+
+void weightCacheName(char *filename, int type)															// function to store the name of the weight cache file for the operator labelled by type, with the current values of N, L_v & R_v, in filename
+{
+	if(type == WeightsLinear)
+	{
+		sprintf(filename,"Weights/N%d_L%g_R%g_Landau_linear.wts",N,L_v,R_v);							// store the values of N, L_v & R_v in filename and note that it's for the linear Landau damping
+	}
+	else
+	{
+		sprintf(filename,"Weights/N%d_L%g_R%g_Landau.wts",N,L_v,R_v);									// store the values of N, L_v & R_v in filename
+	}
+}
+
+unsigned long long weightChecksum(double **conv_weights)												// function to calculate a Fletcher-style checksum of the size_ft*size_ft weights in conv_weights (treating each weight as a 64-bit word, so that the result is independent of the floating point arithmetic)
+{
+	int i, j;																							// declare i, j (counters for the rows & columns of conv_weights)
+	unsigned long long word, p, sum1, sum2, n_words;													// declare word (to store the bits of the current weight), p (the position of the current weight), sum1 (the sum of all words), sum2 (the sum of all partial sums of words, which makes the checksum depend on the order of the weights) & n_words (the total number of weights)
+
+	n_words = (unsigned long long)size_ft*(unsigned long long)size_ft;									// set n_words to size_ft^2
+	sum1 = 0;																							// set sum1 to 0 originally
+	sum2 = 0;																							// set sum2 to 0 originally
+	#pragma omp parallel for private(i,j,word,p) shared(conv_weights,n_words) reduction(+:sum1,sum2)
+	for(i=0;i<size_ft;i++)
+	{
+		for(j=0;j<size_ft;j++)
+		{
+			memcpy(&word, &conv_weights[i][j], sizeof(word));											// store the bits of the weight in row i & column j in word
+			p = (unsigned long long)i*(unsigned long long)size_ft + (unsigned long long)j;				// set p to the position of this weight in the file
+			sum1 += word;																				// add the word to sum1 (all arithmetic is modulo 2^64)
+			sum2 += (n_words - p)*word;																	// the word at position p appears in the last n_words - p partial sums, so add that many copies of it to sum2 (this is what allows the sum to be split over the threads)
+		}
+	}
+
+	return sum1 ^ (sum2 << 32 | sum2 >> 32);															// return the combination of the two sums
+}
+
+int writeWeightCache(const char *filename, int type, double **conv_weights)							// function to store the weights in conv_weights, for the operator labelled by type, in the weight cache file with the name filename (returns 0 if this was successful)
+{
+	int i, ok;																							// declare i (a counter for the rows of conv_weights) & ok (to store whether or not everything was written)
+	char tmpname[200];																					// declare tmpname (the name of the file the weights are written to before it is moved to filename)
+	FILE *fidWeights;																					// declare a pointer to the file fidWeights (which will store the weights)
+	WeightCacheHeader header;																			// declare header (the header to be written at the start of the file)
+
+	memset(&header, 0, sizeof(header));																	// set all of the entries of header to zero (including the unused ones)
+	strncpy(header.magic, "LPWTS", sizeof(header.magic));												// identify this as a weight cache file
+	header.version = WeightCacheVersion;																// record the version of the layout being written
+	header.type = type;																					// record the type of operator the weights belong to
+	header.N = N;																						// record the number of spectral nodes the weights were computed with
+	header.size_ft = size_ft;																			// record the number of rows & columns stored
+	header.L_v = L_v;																					// record the value of L_v the weights were computed with
+	header.R_v = R_v;																					// record the value of R_v the weights were computed with
+	header.checksum = weightChecksum(conv_weights);														// record the checksum of the weights
+
+	// WRITE TO A TEMPORARY FILE FIRST AND THEN RENAME IT, SO THAT ANOTHER RUN CAN NEVER FIND A PARTIALLY WRITTEN FILE:
+	sprintf(tmpname, "%s.tmp%d", filename, (int)getpid());												// set tmpname to filename with .tmp and the process id added to the end
+	fidWeights = fopen(tmpname, "wb");																	// set fidWeights to be the file with the name stored in tmpname, opened for writing in binary
+	if(fidWeights == NULL)
+	{
+		return 1;																						// if the file could not be created (e.g. the directory Weights does not exist), return 1 to indicate that nothing was stored
+	}
+	ok = (fwrite(&header, sizeof(header), 1, fidWeights) == 1);											// write the header at the start of the file
+	for(i=0;i<size_ft && ok;i++)
+	{
+		ok = (fwrite(conv_weights[i], sizeof(double), size_ft, fidWeights) == (size_t)size_ft);		// write the ith row of weights after the rows before it
+	}
+	ok = (fclose(fidWeights) == 0) && ok;																// close the file (which may also fail if the last writes could not be completed)
+	if(!ok || rename(tmpname, filename) != 0)
+	{
+		remove(tmpname);																				// if anything could not be written, remove what was written and return 1
+		return 1;
+	}
+
+	return 0;
+}
+
+int mapWeightCache(const char *filename, int type, double **conv_weights, WeightStorage *storage)	// function to map the weight cache file with the name filename read-only into memory and point the rows of conv_weights at the weights in it, if the file exists and matches the current run; returns 1 (with the mapping recorded in storage, to be passed to freeConvWeights) or 0 if the file cannot be used (MUST BE CALLED BY ALL PROCESSES)
+{
+	int i, fd, valid;																					// declare i (a counter for the rows of conv_weights), fd (the file descriptor of the open file) & valid (to store whether or not the file can be used)
+	size_t expected_size;																				// declare expected_size (the size that the file should have)
+	struct stat file_stat;																				// declare file_stat (to store the details of the file)
+	void *map;																							// declare map (the start of the file in memory)
+	WeightCacheHeader *header;																			// declare a pointer to the header at the start of the file
+	double *weights;																					// declare a pointer to the first weight after the header
+
+	expected_size = sizeof(WeightCacheHeader) + (size_t)size_ft*(size_t)size_ft*sizeof(double);		// set expected_size to the size of the header plus size_ft^2 doubles
+	map = NULL;																							// set map to NULL until the file has been mapped
+	valid = 0;																							// assume the file can not be used until it has been checked
+
+	fd = open(filename, O_RDONLY);																		// open the file read-only
+	if(fd >= 0)
+	{
+		if(fstat(fd, &file_stat) == 0 && (size_t)file_stat.st_size == expected_size)
+		{
+			map = mmap(NULL, expected_size, PROT_READ, MAP_SHARED, fd, 0);								// if the file has the correct size, map all of it read-only into memory (the pages are shared by all processes on the node which map the same file)
+			if(map == MAP_FAILED)
+			{
+				map = NULL;
+			}
+		}
+		close(fd);																						// the file is no longer needed once it has been mapped
+	}
+
+	if(map != NULL)
+	{
+		// CHECK THAT THE FILE WAS WRITTEN WITH THE CURRENT LAYOUT FOR THE CURRENT OPERATOR AND DISCRETISATION:
+		header = (WeightCacheHeader*)map;
+		valid = (strncmp(header->magic, "LPWTS", sizeof(header->magic)) == 0 &&
+				header->version == WeightCacheVersion && header->type == type &&
+				header->N == N && header->size_ft == size_ft && header->L_v == L_v && header->R_v == R_v);
+		if(valid)
+		{
+			weights = (double*)((char*)map + sizeof(WeightCacheHeader));								// the weights start immediately after the header
+			for(i=0;i<size_ft;i++)
+			{
+				conv_weights[i] = weights + (size_t)i*(size_t)size_ft;									// point the ith row of conv_weights at the ith row of weights in the file
+			}
+			if(myrank_mpi == 0)
+			{
+				valid = (weightChecksum(conv_weights) == header->checksum);								// the process with rank 0 checks that the weights have not been corrupted (all processes map the same file)
+				if(!valid)
+				{
+					printf("Checksum of the stored weights in %s does not match. \n", filename);
+				}
+			}
+		}
+	}
+
+	#ifdef UseMPI
+	MPI_Allreduce(MPI_IN_PLACE, &valid, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);							// only use the file if every process was able to map it and it passed all of the checks
+	#endif
+	if(!valid)
+	{
+		if(map != NULL)
+		{
+			munmap(map, expected_size);																	// if the file can not be used, remove it from memory
+		}
+		return 0;
+	}
+
+	storage->storage = WeightsMapped;																	// record that the weights are in the mapped file
+	storage->map = map;
+	storage->map_size = expected_size;
+	return 1;
+}
+
+void allocConvWeights(double **conv_weights, WeightStorage *storage)									// function to allocate the size_ft*size_ft weights once per node, in an MPI shared memory window which every process on the node can read and write, and point the rows of conv_weights at them (MUST BE CALLED BY ALL PROCESSES)
+{
+	int i;																								// declare i (a counter for the rows of conv_weights)
+	double *weights;																					// declare a pointer to the first weight in the window
+
+	#ifdef UseMPI
+	int node_rank, disp_unit;																			// declare node_rank (the rank of this process on its node) & disp_unit (the displacement unit of the window, which is not used)
+	MPI_Aint win_size;																					// declare win_size (the size of the window)
+
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &storage->node_comm);	// group the processes which can share memory (i.e. those on the same node) into node_comm
+	MPI_Comm_rank(storage->node_comm, &node_rank);
+
+	// ONLY THE FIRST PROCESS ON EACH NODE ALLOCATES THE WEIGHTS, THE OTHERS JUST FIND WHERE THEY ARE:
+	win_size = (node_rank == 0) ? (MPI_Aint)size_ft*(MPI_Aint)size_ft*(MPI_Aint)sizeof(double) : 0;
+	MPI_Win_allocate_shared(win_size, sizeof(double), MPI_INFO_NULL, storage->node_comm, &weights, &storage->win);
+	MPI_Win_shared_query(storage->win, 0, &win_size, &disp_unit, &weights);							// set weights to the start of the memory allocated by the first process on the node
+	#else
+	weights = (double *)malloc((size_t)size_ft*(size_t)size_ft*sizeof(double));						// without MPI this process is the only one on the node
+	#endif
+
+	for(i=0;i<size_ft;i++)
+	{
+		conv_weights[i] = weights + (size_t)i*(size_t)size_ft;											// point the ith row of conv_weights at the ith row of weights in the window
+	}
+	storage->storage = WeightsShared;																	// record that the weights are in the shared window
+}
+
+void generateConvWeights(int type, double **conv_weights, WeightStorage *storage)						// function to calculate the values of the convolution weights for the operator labelled by type in the shared window allocated by allocConvWeights, with the rows shared out between all of the processes (MUST BE CALLED BY ALL PROCESSES)
+{
+	int row_start, row_end;																				// declare row_start & row_end (the rows calculated by this process)
+
+	#ifdef UseMPI
+	int i, node_rank, node_size, node_index, n_nodes;													// declare i (a counter for the nodes), node_rank & node_size (the rank of this process on its node and the number of processes on the node) and node_index & n_nodes (the index of this node and the number of nodes)
+	int *node_rows, *node_start;																		// declare node_rows & node_start (the number of rows calculated on each node and the first of them)
+	MPI_Comm leader_comm;																				// declare leader_comm (the communicator of the first process on each node)
+	MPI_Datatype row_type;																				// declare row_type (an MPI type for one row of weights, since the whole table can have more than INT_MAX weights)
+
+	MPI_Comm_rank(storage->node_comm, &node_rank);
+	MPI_Comm_size(storage->node_comm, &node_size);
+
+	// NUMBER THE NODES, USING THE FIRST PROCESS ON EACH ONE:
+	MPI_Comm_split(MPI_COMM_WORLD, (node_rank == 0) ? 0 : MPI_UNDEFINED, myrank_mpi, &leader_comm);
+	if(node_rank == 0)
+	{
+		MPI_Comm_rank(leader_comm, &node_index);
+		MPI_Comm_size(leader_comm, &n_nodes);
+	}
+	MPI_Bcast(&node_index, 1, MPI_INT, 0, storage->node_comm);
+	MPI_Bcast(&n_nodes, 1, MPI_INT, 0, storage->node_comm);
+
+	// SHARE THE ROWS OUT BETWEEN THE NODES AS EVENLY AS POSSIBLE, THEN BETWEEN THE PROCESSES ON EACH NODE (AND THEN BETWEEN THE THREADS OF EACH PROCESS):
+	node_rows = (int *)malloc(n_nodes*sizeof(int));
+	node_start = (int *)malloc(n_nodes*sizeof(int));
+	for(i=0;i<n_nodes;i++)
+	{
+		node_start[i] = (int)((long)size_ft*i/n_nodes);
+		node_rows[i] = (int)((long)size_ft*(i+1)/n_nodes) - node_start[i];
+	}
+	row_start = node_start[node_index] + (int)((long)node_rows[node_index]*node_rank/node_size);
+	row_end = node_start[node_index] + (int)((long)node_rows[node_index]*(node_rank+1)/node_size);
+	#else
+	row_start = 0; row_end = size_ft;																	// without MPI this process calculates every row (shared out between its threads)
+	#endif
+
+	if(type == WeightsLinear)
+	{
+		generate_conv_weights_linear_rows(conv_weights, row_start, row_end);							// calculate the rows of the convolution weights for the linear case (the matrix G_Hat(xi, omega), for xi = (xi_i, xi_j, xi_k), omega = (omega_l, omega_m, omega_n), i,j,k,l,m,n = 0,1,...,N-1) belonging to this process
+	}
+	else
+	{
+		generate_conv_weights_rows(conv_weights, row_start, row_end);									// calculate the rows of the convolution weights (the matrix G_Hat(xi, omega), for xi = (xi_i, xi_j, xi_k), omega = (omega_l, omega_m, omega_n), i,j,k,l,m,n = 0,1,...,N-1) belonging to this process
+	}
+
+	#ifdef UseMPI
+	MPI_Win_fence(0, storage->win);																		// make sure that every process on the node has finished writing its rows before they are sent to the other nodes
+	if(node_rank == 0)
+	{
+		if(n_nodes > 1)
+		{
+			MPI_Type_contiguous(size_ft, MPI_DOUBLE, &row_type);
+			MPI_Type_commit(&row_type);
+			MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, conv_weights[0], node_rows, node_start,
+															row_type, leader_comm);						// give every node the rows calculated on all of the others (the rows of the window are contiguous, starting at conv_weights[0])
+			MPI_Type_free(&row_type);
+		}
+		MPI_Comm_free(&leader_comm);
+	}
+	MPI_Win_fence(0, storage->win);																		// make sure that every row has arrived before any of them are read
+
+	free(node_rows); free(node_start);
+	#endif
+}
+
+void loadConvWeights(const char *filename, int type, double **conv_weights, WeightStorage *storage)	// function to set the rows of conv_weights to the weights for the operator labelled by type, using the weight cache file with the name filename if it matches the current run and otherwise computing the weights directly (once per node) and storing them there for the next run; where the weights are stored is recorded in storage (MUST BE CALLED BY ALL PROCESSES)
+{
+	if(mapWeightCache(filename, type, conv_weights, storage))											// try to use the weights stored in the file filename
+	{
+		if(myrank_mpi == 0)
+		{
+			printf("Stored weights found. Using the weights in %s. \n", filename);
+		}
+		return;
+	}
+
+	if(myrank_mpi == 0)
+	{
+		printf("Stored weights NOT found in %s. Computing the weights... \n", filename);
+	}
+	allocConvWeights(conv_weights, storage);															// allocate the weights once per node
+	generateConvWeights(type, conv_weights, storage);													// calculate the values of the convolution weights, shared out between all of the processes
+	if(myrank_mpi == 0 && writeWeightCache(filename, type, conv_weights) != 0)
+	{
+		printf("Warning: could not store the weights in %s. \n", filename);							// the run can continue without the file, it just means the weights will be computed again next time
+	}
+}
+
+void freeConvWeights(double **conv_weights, WeightStorage *storage)									// function to delete the weights in conv_weights, which were either mapped from a weight cache file or allocated in a shared window, as recorded in storage (MUST BE CALLED BY ALL PROCESSES)
+{
+	if(storage->storage == WeightsMapped)
+	{
+		munmap(storage->map, storage->map_size);														// remove the file from memory
+	}
+	else
+	{
+		#ifdef UseMPI
+		MPI_Win_free(&storage->win);																	// delete the shared window (the memory is released once every process on the node has freed it)
+		MPI_Comm_free(&storage->node_comm);
+		#else
+		free(conv_weights[0]);																			// delete the weights (the rows are contiguous, starting at conv_weights[0])
+		#endif
+	}
+	free(conv_weights);																					// delete the dynamic memory allocated for the pointers to the rows
+}
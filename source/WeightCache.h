@@ -0,0 +1,80 @@
+/* This is the header file associated to WeightCache.cpp in which the layout of the binary weight
+ * cache files, the record of where a set of weights is stored, the prototypes for the functions
+ * contained in that file and the macros which label the type of collision operator the weights belong
+ * to and where they are stored are declared.  Any other header files which
+ * must be linked to for the functions here are also included.
+ *
+ */
+
+//************************//
+//     INCLUDE GUARDS     //
+//************************//
+
+#ifndef WEIGHTCACHE_H_
+#define WEIGHTCACHE_H_
+
+//************************//
+//        INCLUDES        //
+//************************//
+
+#include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the WeightCache functions
+
+//************************//
+//         MACROS         //
+//************************//
+
+#define WeightCacheVersion 1																			// the version of the layout of the weight cache files (INCREASE THIS IF THE LAYOUT OF THE HEADER OR THE WEIGHTS IN THE FILE EVER CHANGES, SO THAT OLD FILES ARE REJECTED)
+#define WeightsFull 0																					// label for the weights of the single species (ele-ele) collision operator, generated by generate_conv_weights
+#define WeightsLinear 1																					// label for the weights of the linear two species (ele-ion) collision operator, generated by generate_conv_weights_linear
+
+#define WeightsMapped 0																					// label for weights which were mapped read-only from a weight cache file
+#define WeightsShared 1																					// label for weights which are stored in an MPI shared memory window, once per node (or in memory allocated by the only process, without MPI)
+
+//************************//
+//    DATA STRUCTURES     //
+//************************//
+
+typedef struct
+{
+	char magic[8];																						// the characters "LPWTS" followed by zeros, identifying this as a weight cache file
+	int version;																						// the value of WeightCacheVersion when the file was written
+	int type;																							// the type of collision operator the weights belong to (WeightsFull or WeightsLinear)
+	int N;																								// the number of nodes in each direction of the spectral method
+	int size_ft;																						// the number of rows (and columns) of weights stored (which should be N^3)
+	double L_v, R_v;																					// the values of L_v (the velocity domain is -L_v < v < L_v) & R_v (the radius of the ball B_(R_v)) which the weights were computed with
+	unsigned long long checksum;																		// the checksum of the size_ft*size_ft weights following the header (as calculated by weightChecksum)
+	char reserved[16];																					// unused, pads the header to 64 bytes so that the weights following it are aligned
+} WeightCacheHeader;
+
+typedef struct
+{
+	int storage;																						// where the weights are stored (WeightsMapped or WeightsShared)
+	void *map;																							// the start of the mapped weight cache file (if storage is WeightsMapped)
+	size_t map_size;																					// the size of the mapping (if storage is WeightsMapped)
+	#ifdef UseMPI
+	MPI_Win win;																						// the shared memory window containing the weights (if storage is WeightsShared)
+	MPI_Comm node_comm;																					// the communicator of the processes on this node, which share the window (if storage is WeightsShared)
+	#endif
+} WeightStorage;
+
+//************************//
+//   FUNCTION PROTOTYPES  //
+//************************//
+
+void weightCacheName(char *filename, int type);
+
+unsigned long long weightChecksum(double **conv_weights);
+
+int writeWeightCache(const char *filename, int type, double **conv_weights);
+
+int mapWeightCache(const char *filename, int type, double **conv_weights, WeightStorage *storage);
+
+void allocConvWeights(double **conv_weights, WeightStorage *storage);
+
+void generateConvWeights(int type, double **conv_weights, WeightStorage *storage);
+
+void loadConvWeights(const char *filename, int type, double **conv_weights, WeightStorage *storage);
+
+void freeConvWeights(double **conv_weights, WeightStorage *storage);
+
+#endif /* WEIGHTCACHE_H_ */
@@ -0,0 +1,73 @@
+/* This is the main source file for the weight generator, which computes the convolution weights of the
+ * collision operator for the values of N, L_v & R_v set in LP_ompi.cpp and stores them in the weight
+ * cache files in Weights/, so that the solver can map them in at the start of a run instead of
+ * computing them (which takes a long time for N = 16-32).
+ *
+ * The weight generator is built from the same source files as the solver, with the macro
+ * WeightGenerator defined (which removes the main function of the solver in LP_ompi.cpp), so that the
+ * weights it stores always match the ones the solver would compute.  Everything in this file is
+ * skipped when building the solver.
+ *
+ */
+
+#include "LP_ompi.h"																				// LP_ompi.h is where the libraries required by the program included, all macros (to decide the behaviour of a given run) are defined and all variables to be used throughout the various files are defined as external
+
+#ifdef WeightGenerator																				// only do this if WeightGenerator was defined
+void generateAndStoreWeights(int type)																// function to compute the convolution weights for the operator labelled by type and store them in the corresponding weight cache file
+{
+	char buffer_weights[100];																		// declare the array buffer_weights (to store the name of the weight cache file)
+	double **conv_weights;																			// declare a pointer to conv_weights (a matrix of the weights for the convolution in Fourier space)
+	double MPIt1;																					// declare MPIt1 (the time the computation started)
+	WeightStorage weights_storage;																	// declare weights_storage (to record where the weights are stored)
+
+	weightCacheName(buffer_weights, type);															// store the name of the weight cache file, with the values of N, L_v & R_v, in buffer_weights
+
+	conv_weights = (double **)malloc(size_ft*sizeof(double *));										// allocate enough space at the pointer conv_weights for size_ft many pointers to double numbers
+	allocConvWeights(conv_weights, &weights_storage);												// allocate the weights once per node, in a shared window
+
+	MPIt1 = MPI_Wtime();																			// set MPIt1 to the current time in the MPI process
+	generateConvWeights(type, conv_weights, &weights_storage);										// calculate the values of the convolution weights for the operator labelled by type, with the rows shared out between all of the processes
+
+	if(myrank_mpi == 0)																				// only the process with rank 0 will do this
+	{
+		printf("Computed the weights for N=%d, L_v=%g, R_v=%g in %gs. \n", N, L_v, R_v, MPI_Wtime() - MPIt1);
+		if(writeWeightCache(buffer_weights, type, conv_weights) == 0)
+		{
+			printf("Stored the weights in %s. \n", buffer_weights);
+		}
+		else
+		{
+			printf("Error: could not store the weights in %s (does the directory Weights exist?). \n", buffer_weights);
+		}
+	}
+
+	freeConvWeights(conv_weights, &weights_storage);												// delete the shared window and the pointers to the rows of conv_weights
+}
+
+int main()
+{
+	int required=MPI_THREAD_FUNNELED;																// declare required and set it to MPI_THREAD_FUNNELED (only the master thread calls MPI: the shared window, the exchange of the rows of weights & the checks of the weight cache are all made outside the parallel regions)
+	int provided;																					// declare provided (the actual provided level of MPI thread support)
+
+	MPI_Init_thread(NULL, NULL, required, &provided);												// initialise the hybrid MPI & OpenMP environment, requesting the level of thread support to be required and store the actual thread support provided in provided
+	MPI_Comm_rank(MPI_COMM_WORLD, &myrank_mpi);														// store the rank of the current process in the MPI_COMM_WORLD communicator in myrank_mpi
+	MPI_Comm_size(MPI_COMM_WORLD, &nprocs_mpi);														// store the total number of processes running in the MPI_COMM_WORLD communicator in nprocs_mpi
+	omp_set_num_threads(nthread);																	// set the number of OpenMP threads to nthread
+
+	wtN = (double *)malloc(N*sizeof(double));														// allocate enough space at the pointer wtN to store N many double numbers
+	v = (double *)malloc(N*sizeof(double));															// allocate enough space at the pointer v to store N many double numbers
+	eta = (double *)malloc(N*sizeof(double));														// allocate enough space at the pointer eta to store N many double numbers
+
+	setSpectralDomains();																			// set L_v, L_eta, h_v, h_eta and the discretised velocity & Fourier domains v & eta exactly as the solver does
+
+	generateAndStoreWeights(WeightsFull);															// compute and store the weights for the single species collision operator
+	#ifdef FullandLinear																			// only do this if FullandLinear was defined
+	generateAndStoreWeights(WeightsLinear);															// compute and store the weights for the linear two species collision operator
+	#endif
+
+	free(wtN); free(v); free(eta);																	// delete the dynamic memory allocated for wtN, v & eta
+
+	MPI_Finalize();																					// ensure that MPI exits cleanly
+	return 0;																						// return 0, since main is of type int (and this shows the program completed correctly)
+}
+#endif
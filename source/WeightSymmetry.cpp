@@ -0,0 +1,162 @@
+/* This is the source file which contains the subroutines necessary for storing the convolution weights
+ * of the collision operator compressed by their symmetries.
+ *
+ * Since eta[i] = h_eta*(i - N/2), the grid is unchanged by permuting the axes and (apart from the points
+ * with index 0) by reflecting any of them (i -> N - i).  gHat3(xi, omega) & gHat3_linear(xi, omega) are
+ * unchanged when the same permutation and reflections are applied to both xi & omega, so the weights
+ * are only stored for one xi in each orbit of the 48 symmetries (about size_ft/48 rows instead of
+ * size_ft).  To keep the reflections of omega on the grid, each row is stored for omega on the grid
+ * extended by the point eta = L_eta (with index N) in each direction.  The weight for any xi & omega is
+ * then found as weights[row[t]][omega[op[t]][w]], where t & w are the indices of xi & omega.
+ *
+ * Functions included: applySymOp, buildWeightSymmetry, generateSymWeights, freeSymWeights
+ *
+ */
+
+#include "WeightSymmetry.h"																				// WeightSymmetry.h is where the prototypes for the functions contained in this file are declared
+
+SymWeights conv_weights_sym;																			// declare conv_weights_sym (the symmetry-compressed convolution weights, used when QMethod is QSymmetric)
+
+int sym_perm[6][3] = {{0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0}};							// the 6 permutations of the axes (the dth axis of the result is the axis sym_perm[p][d] of the original)
+
+void applySymOp(int g, int i, int j, int k, int *result)												// function to store the indices of the image of the point with indices (i,j,k) under the symmetry g (where g = 8*p + r for the permutation sym_perm[p] and the reflection of each axis d with bit d of r set) in result, on the grid extended by the index N
+{
+	int d, index[3], reflected[3];																		// declare d (a counter for the axes), index (the indices of the point) & reflected (the indices after the reflections)
+
+	index[0] = i; index[1] = j; index[2] = k;
+	for(d=0;d<3;d++)
+	{
+		reflected[d] = ((g % 8) >> d & 1) ? N - index[d] : index[d];									// reflecting eta[i] gives -eta[i] = eta[N-i]
+	}
+	for(d=0;d<3;d++)
+	{
+		result[d] = reflected[sym_perm[g/8][d]];
+	}
+}
+
+void buildWeightSymmetry(SymWeights *sym)																// function to choose the representative of each orbit of xi, record the symmetry which takes each xi to its representative and the images of every omega under every symmetry in sym
+{
+	int t, w, g, d, p, i, j, k, r, tmp, index[3], sorted[3], image[3];									// declare t & w (the indices of xi & omega), g (a counter for the symmetries), d (a counter for the axes), p (the permutation chosen), (i,j,k) (the indices of xi), r (the reflections chosen), tmp (used when sorting), index (the indices of xi after the reflections), sorted (the indices of the representative) & image (the indices of the image of omega)
+	int *row_of;																						// declare row_of (the row stored for each representative, or -1 if it has not been seen yet)
+
+	sym->size_ext = (N+1)*(N+1)*(N+1);
+	sym->row = (int *)malloc(size_ft*sizeof(int));
+	sym->op = (int *)malloc(size_ft*sizeof(int));
+	sym->omega = (int *)malloc(SymOps*size_ft*sizeof(int));
+	sym->weights = NULL;
+	sym->weights_linear = NULL;
+	row_of = (int *)malloc(size_ft*sizeof(int));
+	for(t=0;t<size_ft;t++)
+	{
+		row_of[t] = -1;
+	}
+
+	// THE REPRESENTATIVE OF EACH xi HAS eta >= 0 IN EVERY DIRECTION WHERE IT CAN BE REFLECTED, SORTED INTO DECREASING ORDER:
+	sym->n_rows = 0;
+	for(t=0;t<size_ft;t++)
+	{
+		index[2] = t % N; index[1] = (t/N) % N; index[0] = t/(N*N);
+		r = 0;
+		for(d=0;d<3;d++)
+		{
+			if(index[d] > 0 && index[d] < N/2)
+			{
+				r |= 1 << d;																			// reflect the directions where eta < 0 (except eta[0], whose reflection is not on the grid)
+				index[d] = N - index[d];
+			}
+		}
+		for(p=0;p<6;p++)
+		{
+			for(d=0;d<3;d++)
+			{
+				sorted[d] = index[sym_perm[p][d]];
+			}
+			if(sorted[0] >= sorted[1] && sorted[1] >= sorted[2])
+			{
+				break;																					// the first permutation which sorts the indices into decreasing order
+			}
+		}
+		sym->op[t] = 8*p + r;
+		tmp = sorted[2] + N*(sorted[1] + N*sorted[0]);													// the index of the representative
+		if(row_of[tmp] < 0)
+		{
+			row_of[tmp] = sym->n_rows;																	// the first time a representative is seen, give it the next row
+			sym->n_rows++;
+		}
+		sym->row[t] = row_of[tmp];
+	}
+
+	// THE IMAGE OF EVERY omega UNDER EVERY SYMMETRY, ON THE EXTENDED GRID:
+	#pragma omp parallel for private(g,w,i,j,k,image) shared(sym)
+	for(g=0;g<SymOps;g++)
+	{
+		for(w=0;w<size_ft;w++)
+		{
+			k = w % N; j = (w/N) % N; i = w/(N*N);
+			applySymOp(g, i, j, k, image);
+			sym->omega[g*size_ft + w] = image[2] + (N+1)*(image[1] + (N+1)*image[0]);
+		}
+	}
+
+	free(row_of);
+}
+
+void generateSymWeights(SymWeights *sym, int type)														// function to calculate the weights (for the operator labelled by type, WeightsFull or WeightsLinear) for the representative of each orbit of xi, for every omega on the extended grid, and store them in sym
+{
+	int t, r, e, i, j, k, l, m, n;																		// declare t (the index of xi), r (the row), e (the index of omega on the extended grid), (i,j,k) (the indices of the representative) & (l,m,n) (the indices of omega)
+	int *xi_of_row;																						// declare xi_of_row (the index of the representative for each row)
+	double *eta_ext, *weights;																			// declare eta_ext (the grid extended by eta[N] = L_eta) & weights (the weights being calculated)
+
+	eta_ext = (double *)malloc((N+1)*sizeof(double));
+	for(i=0;i<N;i++)
+	{
+		eta_ext[i] = eta[i];
+	}
+	eta_ext[N] = -eta[0];																				// eta[N] = L_eta is the reflection of eta[0]
+
+	xi_of_row = (int *)malloc(sym->n_rows*sizeof(int));
+	for(t=0;t<size_ft;t++)
+	{
+		if(sym->op[t] == 0)
+		{
+			xi_of_row[sym->row[t]] = t;																	// the representative is the xi which is its own image (the symmetry 0 changes nothing)
+		}
+	}
+
+	weights = (double *)malloc((size_t)sym->n_rows*(size_t)sym->size_ext*sizeof(double));
+	#pragma omp parallel for schedule(dynamic) private(r,t,e,i,j,k,l,m,n) shared(sym, weights, eta_ext, xi_of_row)
+	for(r=0;r<sym->n_rows;r++)
+	{
+		t = xi_of_row[r];
+		k = t % N; j = (t/N) % N; i = t/(N*N);
+		for(e=0;e<sym->size_ext;e++)
+		{
+			n = e % (N+1); m = (e/(N+1)) % (N+1); l = e/((N+1)*(N+1));
+			if(type == WeightsLinear)
+			{
+				weights[(size_t)r*sym->size_ext + e] = gHat3_linear(eta[i], eta[j], eta[k], eta_ext[l], eta_ext[m], eta_ext[n]);
+			}
+			else
+			{
+				weights[(size_t)r*sym->size_ext + e] = gHat3(eta[i], eta[j], eta[k], eta_ext[l], eta_ext[m], eta_ext[n]);
+			}
+		}
+	}
+
+	if(type == WeightsLinear)
+	{
+		sym->weights_linear = weights;
+	}
+	else
+	{
+		sym->weights = weights;
+	}
+	free(xi_of_row); free(eta_ext);
+}
+
+void freeSymWeights(SymWeights *sym)																	// function to delete the dynamic memory allocated for the symmetry-compressed weights in sym
+{
+	free(sym->row); free(sym->op); free(sym->omega);
+	free(sym->weights);
+	free(sym->weights_linear);																			// (free does nothing if weights_linear was never calculated)
+}
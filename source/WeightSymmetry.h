@@ -0,0 +1,60 @@
+/* This is the header file associated to WeightSymmetry.cpp in which the record of the symmetry-
+ * compressed convolution weights, the prototypes for the functions contained in that file and the
+ * external variables they set are declared.  Any other header files which must be linked to for the
+ * functions here are also included.
+ *
+ */
+
+//************************//
+//     INCLUDE GUARDS     //
+//************************//
+
+#ifndef WEIGHTSYMMETRY_H_
+#define WEIGHTSYMMETRY_H_
+
+//************************//
+//        INCLUDES        //
+//************************//
+
+#include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the WeightSymmetry functions
+
+//************************//
+//         MACROS         //
+//************************//
+
+#define SymOps 48																						// the number of symmetries of the weights (the 6 permutations of the axes, each combined with the 8 choices of which axes to reflect)
+
+//************************//
+//    DATA STRUCTURES     //
+//************************//
+
+typedef struct
+{
+	int n_rows;																							// the number of rows of weights stored (one for each orbit of xi under the symmetries)
+	int size_ext;																						// the length of each row, (N+1)^3 (omega runs over the grid extended by eta = L_eta in each direction, so that every reflection of the grid stays on it)
+	int *row;																							// row[t] is the row stored for the orbit of the xi with index t
+	int *op;																							// op[t] is the symmetry which takes the xi with index t to the xi its row was computed for
+	int *omega;																							// omega[g*size_ft + w] is the index on the extended grid of the image of the omega with index w under the symmetry g
+	double *weights;																					// the n_rows*size_ext weights gHat3(xi, omega) for the representative xi of each orbit
+	double *weights_linear;																				// the same for gHat3_linear (only calculated if FullandLinear was defined)
+} SymWeights;
+
+//************************//
+//   EXTERNAL VARIABLES   //
+//************************//
+
+extern SymWeights conv_weights_sym;																		// declare conv_weights_sym (the symmetry-compressed convolution weights, used when QMethod is QSymmetric)
+
+//************************//
+//   FUNCTION PROTOTYPES  //
+//************************//
+
+void applySymOp(int g, int i, int j, int k, int *result);
+
+void buildWeightSymmetry(SymWeights *sym);
+
+void generateSymWeights(SymWeights *sym, int type);
+
+void freeSymWeights(SymWeights *sym);
+
+#endif /* WEIGHTSYMMETRY_H_ */
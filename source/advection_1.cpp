@@ -3,7 +3,8 @@
  * moments or entropy, etc.
  *
  * Functions included: Gridv, Gridx, rho_x, rho, computePhi_x_0, computePhi, PrintPhiVals, computeC_rho, Int_Int_rho
- * Int_Int_rho1st, Int_E, Int_E1st, Int_E2nd, Int_fE, I1, I2, I3, I5, computeH, RK3
+ * Int_Int_rho1st, Int_E, Int_E1st, Int_E2nd, Int_fE, I1, I2, I3, I5, allocSlab, RK3_Stage, computeH, startGhostExchange, advectStage, RK3,
+ * gatherSlabs, scatterSlabs
  *
  */
 
@@ -161,6 +162,142 @@ double I5(double *U, int k, int l) 	// Calculate the difference of the fifth and
   	return result;
 }
 
+/*
+function allocSlab
+------------------
+Allocates a solution (U or U1) for this process and returns it, indexed by the global index k of the cell as
+U[k*6 + l], storing the allocated block in *block (which is what must be freed).  Each process only stores the
+planes of its slab of space cells, x_start <= i < x_end (see startGhostExchange), and the ghost planes next to it,
+i = x_start-1 & i = x_end (even where the periodic neighbour is the plane Nx-1 or 0), so that the memory of each
+process shrinks with the number of processes.  The process with rank 0 stores every plane, -1 <= i <= Nx, as it
+also collects the whole solution for the marginals & the output (see gatherSlabs).  Without MPI the process owns
+every cell, which have no ghost planes.
+*/
+double *allocSlab(double **block)
+{
+#ifdef UseMPI
+  int plane = size_v*6, x_first = chunk_Nx*myrank_mpi, n_planes = chunk_Nx + 2; // the number of doubles in a plane, the first plane of the slab & the number of planes stored
+
+  if(myrank_mpi == 0) n_planes = Nx + 2;
+  *block = (double *)malloc((long)n_planes*plane*sizeof(double));
+  return *block + (long)(1 - x_first)*plane; // the ghost plane x_first-1 is the first plane of the block
+#else
+  *block = (double *)malloc(size*6*sizeof(double));
+  return *block;
+#endif
+}
+
+/*
+function RK3_Stage
+------------------
+Calculates one stage of RK3 for the cells k in the space cells x_from <= i < x_to, which must lie in the slab of this
+process (chunk_Nx*myrank_mpi <= i < min(chunk_Nx*(myrank_mpi+1), Nx), see startGhostExchange), and stores the result
+in Uout[(k - k_start)*6 + l] for k_start = chunk_Nx*myrank_mpi*size_v the first cell of the slab:
+  stage 0: Uout = U + dt*H(U),
+  stage 1: Uout = 0.75*U + 0.25*U1 + 0.25*dt*H(U1),
+  stage 2: Uout = U/3 + 2*U1/3 + 2*dt*H(U1)/3,
+where the six components of H are (I1 - I2 - I3 + I5)(k, l), with the same values as the functions I1, I2, I3 & I5.
+Rather than calling those 24 times per cell (each time recovering (i, j1, j2, j3) from k and choosing the upwind
+cells again) the cells are taken a row of Nv at a time (fixed i, j1 & j2): the upwind cells in x (which depend on
+the sign of v1, i.e. on j1) and in v1 (which depend on the sign of intE[i]) are then the same along the row, so
+they are chosen once per row and the loop over j3 has no branches and is vectorised with omp simd.  A neighbour
+in v1 beyond the boundary (where gh = 0) is read from the cell itself and multiplied by 0, which gives the
+boundary formulas of I5 from its interior ones.
+While the ghost planes of the solution are still on their way (see RK3) the planes which don't read them are
+calculated first; if MPIProgress is set, the master thread then also calls MPI_Testall on the requests of the
+exchange (progress_req) after each of its rows until they complete, so that the exchange
+moves on even when the MPI library only progresses messages inside its own calls.
+*/
+#ifdef UseMPI
+static MPI_Request *progress_req;																		// the requests of the ghost exchange the interior planes are calculated during (set by RK3)
+static int progress_n;																					// the number of them left to complete (0 if there is nothing to poll)
+#endif
+
+void RK3_Stage(int stage, double *U, double *U1, double *Uout, int x_from, int x_to)
+{
+  int k_start = chunk_Nx*myrank_mpi*size_v;
+  double *V = (stage == 0) ? U : U1;																	// the solution H is calculated for
+  int row;
+  #ifdef UseMPI
+  int poll = MPIProgress && progress_n > 0;
+  #endif
+
+  #pragma omp parallel for schedule(dynamic) private(row) shared(U, U1, V, Uout, k_start, x_from, x_to, stage)
+  for(row=x_from*Nv*Nv;row<x_to*Nv*Nv;row++){ // row = i*Nv*Nv + j1*Nv + j2, so that k = row*Nv + j3
+    int i = row/(Nv*Nv), j1 = (row/Nv)%Nv, iir, iil;
+    int xr, xl, vr, vl;																				// the offsets from k to kkr & kkl in I3 (xr & xl) and in I5 (vr & vl)
+    double v1 = Gridv((double)j1), sx, sv, mr, ml, eI = intE[i], eI1 = intE1[i], eI2 = intE2[i];		// sx & sv are the signs of ur & ul in I3 & I5, mr & ml are 0 if the neighbour on the right or the left in v1 is beyond the boundary (and 1 otherwise)
+
+    if(j1<Nv/2){ // information flows from right to left in x
+      iir = i+1; if(iir==Nx && chunk_Nx>=Nx) iir=0; //periodic bc (unless this process only stores its slab, when the ghost plane is at i = Nx, see allocSlab)
+      xr = (iir-i)*size_v; xl = 0; sx = -1.;
+    }
+    else{ // information flows from left to right in x
+      iil = i-1; if(iil==-1 && chunk_Nx>=Nx) iil=Nx-1; // periodic bc (unless the ghost plane is at i = -1, as above)
+      xr = 0; xl = (iil-i)*size_v; sx = 1.;
+    }
+    if(eI>0){ // information flows against the field, from right to left in v1
+      if(j1+1<Nv){ vr = Nv*Nv; mr = 1.; }
+      else{ vr = 0; mr = 0.; }
+      vl = 0; ml = 1.; sv = -1.;
+    }
+    else{ // from left to right in v1
+      vr = 0; mr = 1.;
+      if(j1>0){ vl = -Nv*Nv; ml = 1.; }
+      else{ vl = 0; ml = 0.; }
+      sv = 1.;
+    }
+
+    #pragma omp simd
+    for(int j3=0;j3<Nv;j3++){
+      int k = row*Nv + j3;
+      const double *c = &V[k*6], *xR = &V[(k+xr)*6], *xL = &V[(k+xl)*6], *vR = &V[(k+vr)*6], *vL = &V[(k+vl)*6];
+      double ur = sx*xR[1], ul = sx*xL[1];															// I3's ur & ul
+      double r0 = mr*vR[0], r1 = mr*vR[1], r3 = mr*vR[3], r4 = mr*vR[4], r5 = mr*vR[5], wr = sv*(mr*vR[2]);	// I5's U[kkr*6+l] & ur
+      double l0 = ml*vL[0], l1 = ml*vL[1], l3 = ml*vL[3], l4 = ml*vL[4], l5 = ml*vL[5], wl = sv*(ml*vL[2]);	// I5's U[kkl*6+l] & ul
+      double a1, a2, a5, b0, b1, b2, b3, b4, b5, e0, e1, e2, e3, e4, e5, tp0, tp1, tp2, tp3, tp4, tp5, H[6];
+
+      a1 = dv*dv*dv*( v1*c[0] + dv*c[2]/12. + c[5]*v1/4.);											// I1(k,1)
+      a2 = ((c[0] + c[5]/4.)*eI + c[1]*eI1)*scalev/dv;												// I2(k,2)
+      a5 = c[2]*dv*dv*eI/6.;																		// I2(k,5)
+
+      b0 = dv*dv*dv*( (xR[0]+0.5*ur - xL[0]-0.5*ul)*v1 + (xR[2]-xL[2])*dv/12. + (xR[5]-xL[5])*v1/4.);		// I3(k,l)
+      b1 = 0.5*dv*dv*dv*( (xR[0]+0.5*ur + xL[0]+0.5*ul)*v1 + (xR[2]+xL[2])*dv/12. + (xR[5]+xL[5])*v1/4.);
+      b2 = dv*dv*(( (xR[0]-xL[0])*dv*dv + (ur-ul)*0.5*dv*dv + (xR[2]-xL[2])*dv*v1)/12. + (xR[5]-xL[5])*dv*dv*19./720.);
+      b3 = (xR[3]-xL[3])*v1*dv*dv*dv/12.;
+      b4 = (xR[4]-xL[4])*v1*dv*dv*dv/12.;
+      b5 = dv*dv*dv*((xR[0] + 0.5*ur - xL[0]-0.5*ul)*v1/4. + (xR[2]-xL[2])*dv*19./720. + (xR[5]-xL[5])*v1*19./240.);
+
+      e0 = dv*dv*(r0 + 0.5*wr + r5*5./12.- l0 - 0.5*wl - l5*5./12.)*eI + dv*dv*(r1-l1)*eI1;		// I5(k,l)
+      e1 = dv*dv*( (r0 + 0.5*wr + r5*5./12. - l0 - 0.5*wl - l5*5./12.)*eI1 + (r1 - l1)*eI2 );
+      e2 = 0.5*(dv*dv*(r0 + 0.5*wr + r5*5./12.+ l0 + 0.5*wl + l5*5./12.)*eI + dv*dv*(r1+l1)*eI1);
+      e3 = (r3-l3)*eI*dv*dv/12.;
+      e4 = (r4-l4)*eI*dv*dv/12.;
+      e5 = dv*dv*( ((r0 + 0.5*wr - l0 - 0.5*wl)*5./12. + (r5- l5)*133./720.)*eI + (r1 - l1)*eI1*5./12. );
+
+      tp0 = e0 - b0; tp1 = (a1 - b1) + e1; tp2 = (-a2 - b2) + e2; tp3 = e3 - b3; tp4 = e4 - b4; tp5 = (-a5 - b5) + e5;
+
+      H[0] = (19*tp0/4. - 15*tp5)/dx/scalev;
+      H[5] = (60*tp5 - 15*tp0)/dx/scalev;	
+      H[1] = tp1*12./dx/scalev; H[2] = tp2*12./dx/scalev; H[3] = tp3*12./dx/scalev; H[4] = tp4*12./dx/scalev;
+
+      for(int l=0;l<6;l++){
+        if(stage == 0) Uout[(k-k_start)*6+l] = U[k*6+l] + dt*H[l];
+        else if(stage == 1) Uout[(k-k_start)*6+l] = 0.75*U[k*6+l] + 0.25*U1[k*6+l] + 0.25*dt*H[l];
+        else Uout[(k-k_start)*6+l] = U[k*6+l]/3. + U1[k*6+l]*2./3. + dt*H[l]*2./3.;
+      }
+    }
+
+    #ifdef UseMPI
+    if(poll && omp_get_thread_num() == 0 && progress_n > 0){ // only the master thread touches the requests
+      int done = 0;
+      MPI_Testall(progress_n, progress_req, &done, MPI_STATUSES_IGNORE);
+      if(done) progress_n = 0;
+    }
+    #endif
+  }
+}
+
 #ifdef UseMPI
 /*
 void computeH(double *H, double *U)// H_k(i,j)(f, E, phi_l)  
@@ -182,165 +319,142 @@ void computeH(double *H, double *U)// H_k(i,j)(f, E, phi_l)
 }
 */
 
-void RK3(double *U) // RK3 for f_t = H(f)
+/*
+function startGhostExchange
+---------------------------
+Each process advects the slab of space cells it also collides, x_start <= i < x_end for x_start = chunk_Nx*myrank_mpi
+& x_end = min(chunk_Nx*(myrank_mpi+1), Nx), and I3 only reads the cells next to them in x, i.e. the planes
+i = x_start-1 & i = x_end (with periodic boundary conditions).  This starts the nonblocking receives of these two ghost
+planes into the planes of U next to the slab (see allocSlab, which stores them there even where the periodic neighbour
+is the plane Nx-1 or 0) from the processes which own them, and the sends of the first and last planes of this process
+to the processes which need them as ghosts, storing the requests in requests (which must have room for 4).
+Returns the number of requests started, to be completed with MPI_Waitall: 0 when this process owns no cells or when
+it owns every cell (so that its ghost planes are its own cells).
+*/
+int startGhostExchange(double *U, MPI_Request *requests)
 {
-  int i, k, l, k_local;
-  double tp0, tp1, tp2, tp3, tp4, tp5, H[6];//, tp0, tp5, tmp1, tmp2, tmp3, tmp5;
- 
-  MPI_Status status;
-  
-  ce = computePhi_x_0(U); 
+  int x_start = chunk_Nx*myrank_mpi, x_end = chunk_Nx*(myrank_mpi+1), x_left, x_right, rank_left, rank_right;
+  int plane = size_v*6; // the number of doubles in a plane of U at one space cell
 
-  #pragma omp parallel for private(i) shared(U,cp, intE, intE1)
-  for(i=0;i<Nx;i++){
-    cp[i] = computeC_rho(U,i); intE[i] = Int_E(U,i); intE1[i] = Int_E1st(U,i); 
-  }
-  
-  #pragma omp parallel for private(i) shared(intE2)
-  for(i=0;i<Nx;i++){
-    intE2[i] = Int_E2nd(U,i); // BUG: Int_E2nd() require knowldege of cp 
-  }
-  
-  #pragma omp parallel for schedule(dynamic)  private(H,k, k_local, l, tp0, tp1, tp2, tp3, tp4, tp5) shared(U, Utmp)
-  for(k=chunksize_dg*myrank_mpi;k<chunksize_dg*(myrank_mpi+1);k++){ 
-    k_local = k%chunksize_dg;
-    
-    tp0=I1(U,k,0)-I2(U,k,0)-I3(U,k,0)+I5(U,k,0);
-    tp1=I1(U,k,1)-I2(U,k,1)-I3(U,k,1)+I5(U,k,1);
-    tp2=I1(U,k,2)-I2(U,k,2)-I3(U,k,2)+I5(U,k,2);
-    tp3=I1(U,k,3)-I2(U,k,3)-I3(U,k,3)+I5(U,k,3);
-    tp4=I1(U,k,4)-I2(U,k,4)-I3(U,k,4)+I5(U,k,4);
-    tp5=I1(U,k,5)-I2(U,k,5)-I3(U,k,5)+I5(U,k,5);
+  if(x_end > Nx) x_end = Nx;
+  if(x_start >= x_end) return 0;
+  x_left = (x_start == 0) ? Nx-1 : x_start-1; //periodic bc
+  x_right = (x_end == Nx) ? 0 : x_end;
+  rank_left = x_left/chunk_Nx; rank_right = x_right/chunk_Nx;
+  if(rank_left == myrank_mpi) return 0;
 
-    //H[k_local][0] = (19*tp[0]/4. - 15*tp[5])/dx/scalev;
-    //H[k_local][5] = (60*tp[5] - 15*tp[0])/dx/scalev;	
-    H[0] = (19*tp0/4. - 15*tp5)/dx/scalev;
-    H[5] = (60*tp5 - 15*tp0)/dx/scalev;	
-    //for(l=1;l<5;l++)H[l] = tp[l]*12./dx/scalev;;//H[k_local][l] = tp[l]*12./dx/scalev;
-    H[1] = tp1*12./dx/scalev; H[2] = tp2*12./dx/scalev; H[3] = tp3*12./dx/scalev; H[4] = tp4*12./dx/scalev;
-    
-    for(l=0;l<6;l++) Utmp[k_local*6+l] = U[k*6+l] + dt*H[l];	
-  }    
-  if(myrank_mpi == 0) {
-    //dump the weights we've computed into U1
-    for(k=0;k<chunksize_dg;k++) {
-	for(l=0;l<6;l++) U1[k*6+l] = Utmp[k*6+l];	
-    } 
-    //receive from all other processes
-    for(i=1;i<nprocs_mpi;i++) {
-	    MPI_Recv(output_buffer_vp, chunksize_dg*6, MPI_DOUBLE, i, i, MPI_COMM_WORLD, &status); // receive weight from other processes consecutively, rank i=1..numNodes-1, ensuring the weights are stored in the file consecutively !
-	    for(k=0;k<chunksize_dg;k++) {
-			for(l=0;l<6;l++)U1[(k + i*chunksize_dg)*6+l] = output_buffer_vp[k*6+l];
-		}			
-    }
-  }
-  else  MPI_Send(Utmp, chunksize_dg*6, MPI_DOUBLE, 0, myrank_mpi, MPI_COMM_WORLD);
-  
-  
-  MPI_Bcast(U1, size*6, MPI_DOUBLE, 0, MPI_COMM_WORLD);    
-  MPI_Barrier(MPI_COMM_WORLD);
-  /////////////////// 1st step of RK3 done//////////////////////////////////////////////////////// 
-    
-  ce = computePhi_x_0(U1); 
+  // TAG 0 FOR PLANES SENT TO THE LEFT AND TAG 1 FOR PLANES SENT TO THE RIGHT (SO THE TWO PLANES CAN'T BE MIXED UP WHEN rank_left = rank_right):
+  MPI_Irecv(&U[(x_start-1)*plane], plane, MPI_DOUBLE, rank_left, 1, MPI_COMM_WORLD, &requests[0]);
+  MPI_Irecv(&U[x_end*plane], plane, MPI_DOUBLE, rank_right, 0, MPI_COMM_WORLD, &requests[1]);
+  MPI_Isend(&U[x_start*plane], plane, MPI_DOUBLE, rank_left, 0, MPI_COMM_WORLD, &requests[2]);
+  MPI_Isend(&U[(x_end-1)*plane], plane, MPI_DOUBLE, rank_right, 1, MPI_COMM_WORLD, &requests[3]);
+  return 4;
+}
 
-  #pragma omp parallel for private(i) shared(U1,cp, intE, intE1)
-  for(i=0;i<Nx;i++){
-    cp[i] = computeC_rho(U1,i); intE[i] = Int_E(U1,i); intE1[i] = Int_E1st(U1,i); 
-  }
-  
-  #pragma omp parallel for private(i) shared(U1,intE2)
-  for(i=0;i<Nx;i++){
-    intE2[i] = Int_E2nd(U1,i); // BUG: Int_E2nd() require knowldege of cp 
+/*
+function advectStage
+--------------------
+Calculates stage stage of RK3 (see RK3_Stage) on the slab of this process into Utmp, once the ghost exchange of the
+solution it's calculated for (U for stage 0 and U1 otherwise) has been started with the n_req requests in requests:
+the planes x_start < i < x_end-1, which only read cells of this process, are calculated while the exchange is in
+flight, and the two planes next to the ghosts are calculated once it has completed.
+*/
+static void advectStage(int stage, double *U, double *U1, int n_req, MPI_Request *requests)
+{
+  int x_start = chunk_Nx*myrank_mpi, x_end = chunk_Nx*(myrank_mpi+1);
+
+  if(x_end > Nx) x_end = Nx;
+  if(x_start >= x_end) {
+    MPI_Waitall(n_req, requests, MPI_STATUSES_IGNORE);
+    return;
   }
-  
-  #pragma omp parallel for schedule(dynamic) private(H, k, k_local, l, tp0, tp1, tp2, tp3, tp4, tp5)  shared(U,Utmp)
-  for(k=chunksize_dg*myrank_mpi;k<chunksize_dg*(myrank_mpi+1);k++){      
-    k_local = k%chunksize_dg;
-    
-    tp0=I1(U1,k,0)-I2(U1,k,0)-I3(U1,k,0)+I5(U1,k,0);
-    tp1=I1(U1,k,1)-I2(U1,k,1)-I3(U1,k,1)+I5(U1,k,1);
-    tp2=I1(U1,k,2)-I2(U1,k,2)-I3(U1,k,2)+I5(U1,k,2);
-    tp3=I1(U1,k,3)-I2(U1,k,3)-I3(U1,k,3)+I5(U1,k,3);
-    tp4=I1(U1,k,4)-I2(U1,k,4)-I3(U1,k,4)+I5(U1,k,4);
-    tp5=I1(U1,k,5)-I2(U1,k,5)-I3(U1,k,5)+I5(U1,k,5);
-
-    //H[k_local][0] = (19*tp[0]/4. - 15*tp[5])/dx/scalev;
-    //H[k_local][5] = (60*tp[5] - 15*tp[0])/dx/scalev;	
-    H[0] = (19*tp0/4. - 15*tp5)/dx/scalev;
-    H[5] = (60*tp5 - 15*tp0)/dx/scalev;	
-    //for(l=1;l<5;l++)H[l] = tp[l]*12./dx/scalev;;//H[k_local][l] = tp[l]*12./dx/scalev;
-    H[1] = tp1*12./dx/scalev; H[2] = tp2*12./dx/scalev; H[3] = tp3*12./dx/scalev; H[4] = tp4*12./dx/scalev;
+  progress_req = requests; progress_n = n_req;
+  if(x_end - x_start > 2) RK3_Stage(stage, U, U1, Utmp, x_start+1, x_end-1);			// the interior planes
+  MPI_Waitall(progress_n, progress_req, MPI_STATUSES_IGNORE);								// (requests already completed by MPI_Testall are MPI_REQUEST_NULL)
+  progress_n = 0;
+  RK3_Stage(stage, U, U1, Utmp, x_start, x_start+1);										// the planes next to the ghosts
+  if(x_end - 1 > x_start) RK3_Stage(stage, U, U1, Utmp, x_end-1, x_end);
+}
+
+void RK3(double *U) // RK3 for f_t = H(f)
+{
+  int k, k_start, n_own, n_req;
+  MPI_Request requests[4];
+
+  k_start = chunk_Nx*myrank_mpi*size_v;
+  n_own = (chunk_Nx*(myrank_mpi+1) < Nx) ? chunk_Nx*size_v : (Nx - chunk_Nx*myrank_mpi)*size_v; // the number of cells of this process
+  if(n_own < 0) n_own = 0;
+
+  // EACH STAGE STARTS THE GHOST EXCHANGE OF THE SOLUTION IT NEEDS H OF, THEN SETS UP THE FIELD (WHOSE MPI_Allreduce RUNS WHILE THE PLANES ARE
+  // IN FLIGHT) & CALCULATES THE INTERIOR PLANES BEFORE WAITING FOR THE GHOSTS:
+  n_req = startGhostExchange(U, requests);
+  computeFieldCoeffs(U);															// calculate ce, cp, intE, intE1 & intE2 for the field of U
+  advectStage(0, U, U1, n_req, requests);													// Utmp = U + dt*H(U) on the cells of this process
+  #pragma omp parallel for private(k) shared(U1, Utmp)
+  for(k=0;k<n_own*6;k++) U1[k_start*6+k] = Utmp[k];
+  /////////////////// 1st step of RK3 done//////////////////////////////////////////////////////// 
     
-    for(l=0;l<6;l++) Utmp[k_local*6+l] = 0.75*U[k*6+l] + 0.25*U1[k*6+l] + 0.25*dt*H[l];
-  }    
-  if(myrank_mpi == 0) {
-    //dump the weights we've computed into U1
-    for(k=0;k<chunksize_dg;k++) {
-	      for(l=0;l<6;l++) U1[k*6+l] = Utmp[k*6+l];	
-    } 
-    //receive from all other processes
-    for(i=1;i<nprocs_mpi;i++) {      
-		MPI_Recv(output_buffer_vp, chunksize_dg*6, MPI_DOUBLE, i, i, MPI_COMM_WORLD, &status); // receive weight from other processes consecutively, rank i=1..numNodes-1, ensuring the weights are stored in the file consecutively !
-		for(k=0;k<chunksize_dg;k++) {
-			for(l=0;l<6;l++)U1[(k + i*chunksize_dg)*6+l] = output_buffer_vp[k*6+l];
-        }
-    }
-  }
-  else MPI_Send(Utmp, chunksize_dg*6, MPI_DOUBLE, 0, myrank_mpi, MPI_COMM_WORLD);
-  
-  
-  MPI_Bcast(U1, size*+6, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-  MPI_Barrier(MPI_COMM_WORLD);
+  n_req = startGhostExchange(U1, requests);
+  computeFieldCoeffs(U1);															// calculate ce, cp, intE, intE1 & intE2 for the field of U1
+  advectStage(1, U, U1, n_req, requests);													// Utmp = 0.75*U + 0.25*U1 + 0.25*dt*H(U1) on the cells of this process
+  #pragma omp parallel for private(k) shared(U1, Utmp)
+  for(k=0;k<n_own*6;k++) U1[k_start*6+k] = Utmp[k];
   /////////////////// 2nd step of RK3 done//////////////////////////////////////////////////////// 
    
-ce = computePhi_x_0(U1); 
+  n_req = startGhostExchange(U1, requests);
+  computeFieldCoeffs(U1);															// calculate ce, cp, intE, intE1 & intE2 for the field of U1
+  advectStage(2, U, U1, n_req, requests);													// Utmp = U/3 + 2*U1/3 + 2*dt*H(U1)/3 on the cells of this process
+  #pragma omp parallel for private(k) shared(U, Utmp)
+  for(k=0;k<n_own*6;k++) U[k_start*6+k] = Utmp[k];
+  /////////////////// 3rd step of RK3 done//////////////////////////////////////////////////////// 
+}
 
-  #pragma omp parallel for private(i) shared(U1,cp, intE, intE1)
-  for(i=0;i<Nx;i++){
-    cp[i] = computeC_rho(U1,i); intE[i] = Int_E(U1,i); intE1[i] = Int_E1st(U1,i); 
+/*
+function gatherSlabs
+--------------------
+Collects the slabs of space cells of the other processes (see startGhostExchange) in U on the process with rank 0,
+straight into their places in U, for the marginals & the output (the other processes only store their own slabs, see
+allocSlab).  The advection, the collision steps and the diagnostics only need the cells of each process and its ghost
+planes, so nothing is sent between them.
+*/
+void gatherSlabs(double *U)
+{
+  int i, x_i, n_i;
+  MPI_Status status;
+
+  if(myrank_mpi == 0) {
+    for(i=1;i<nprocs_mpi;i++) {
+      x_i = chunk_Nx*i; n_i = (x_i + chunk_Nx < Nx) ? chunk_Nx : Nx - x_i; // the slab of the process with rank i
+      if(n_i > 0) MPI_Recv(&U[x_i*size_v*6], n_i*size_v*6, MPI_DOUBLE, i, i, MPI_COMM_WORLD, &status);
+    }
   }
-  
-  #pragma omp parallel for private(i) shared(U1,intE2)
-  for(i=0;i<Nx;i++){
-    intE2[i] = Int_E2nd(U1,i); // BUG: Int_E2nd() require knowldege of cp 
+  else {
+    x_i = chunk_Nx*myrank_mpi; n_i = (x_i + chunk_Nx < Nx) ? chunk_Nx : Nx - x_i;
+    if(n_i > 0) MPI_Send(&U[x_i*size_v*6], n_i*size_v*6, MPI_DOUBLE, 0, myrank_mpi, MPI_COMM_WORLD);
   }
-  
-  #pragma omp parallel for schedule(dynamic) private(H, k, k_local, l, tp0, tp1, tp2, tp3, tp4, tp5)  shared(U,Utmp)
-  for(k=chunksize_dg*myrank_mpi;k<chunksize_dg*(myrank_mpi+1);k++){      
-    k_local = k%chunksize_dg;
-  
-    tp0=I1(U1,k,0)-I2(U1,k,0)-I3(U1,k,0)+I5(U1,k,0);
-    tp1=I1(U1,k,1)-I2(U1,k,1)-I3(U1,k,1)+I5(U1,k,1);
-    tp2=I1(U1,k,2)-I2(U1,k,2)-I3(U1,k,2)+I5(U1,k,2);
-    tp3=I1(U1,k,3)-I2(U1,k,3)-I3(U1,k,3)+I5(U1,k,3);
-    tp4=I1(U1,k,4)-I2(U1,k,4)-I3(U1,k,4)+I5(U1,k,4);
-    tp5=I1(U1,k,5)-I2(U1,k,5)-I3(U1,k,5)+I5(U1,k,5);
-
-    H[0] = (19*tp0/4. - 15*tp5)/dx/scalev;
-    H[5] = (60*tp5 - 15*tp0)/dx/scalev;	
-    //for(l=1;l<5;l++)H[l] = tp[l]*12./dx/scalev;;//H[k_local][l] = tp[l]*12./dx/scalev;
-    H[1] = tp1*12./dx/scalev; H[2] = tp2*12./dx/scalev; H[3] = tp3*12./dx/scalev; H[4] = tp4*12./dx/scalev;	
-
-    for(l=0;l<6;l++) Utmp[k_local*6+l] = U[k*6+l]/3. + U1[k*6+l]*2./3. + dt*H[l]*2./3.;
-  }    
+}
+
+/*
+function scatterSlabs
+---------------------
+Sends the slab of space cells of each of the other processes from U on the process with rank 0 (which sets the initial
+condition) into its place in the U of that process, the reverse of gatherSlabs.
+*/
+void scatterSlabs(double *U)
+{
+  int i, x_i, n_i;
+  MPI_Status status;
+
   if(myrank_mpi == 0) {
-    //dump the weights we've computed into U1
-    for(k=0;k<chunksize_dg;k++) {
-	      for(l=0;l<6;l++) U[k*6+l] = Utmp[k*6+l];	
-    } 
-    //receive from all other processes
-    for(i=1;i<nprocs_mpi;i++) {      
-	    MPI_Recv(output_buffer_vp, chunksize_dg*6, MPI_DOUBLE, i, i, MPI_COMM_WORLD, &status); // receive weight from other processes consecutively, rank i=1..numNodes-1, ensuring the weights are stored in the file consecutively !
-	    for(k=0;k<chunksize_dg;k++) {
-		  for(l=0;l<6;l++)U[(k + i*chunksize_dg)*6+l] = output_buffer_vp[k*6+l];
-        } 
+    for(i=1;i<nprocs_mpi;i++) {
+      x_i = chunk_Nx*i; n_i = (x_i + chunk_Nx < Nx) ? chunk_Nx : Nx - x_i; // the slab of the process with rank i
+      if(n_i > 0) MPI_Send(&U[x_i*size_v*6], n_i*size_v*6, MPI_DOUBLE, i, i, MPI_COMM_WORLD);
     }
   }
-  else MPI_Send(Utmp, chunksize_dg*6, MPI_DOUBLE, 0, myrank_mpi, MPI_COMM_WORLD);
-  
-  MPI_Bcast(U, size*6, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-  MPI_Barrier(MPI_COMM_WORLD); 
-  /////////////////// 3rd step of RK3 done//////////////////////////////////////////////////////// 
+  else {
+    x_i = chunk_Nx*myrank_mpi; n_i = (x_i + chunk_Nx < Nx) ? chunk_Nx : Nx - x_i;
+    if(n_i > 0) MPI_Recv(&U[x_i*size_v*6], n_i*size_v*6, MPI_DOUBLE, 0, myrank_mpi, MPI_COMM_WORLD, &status);
+  }
 }
 
 
@@ -393,31 +507,23 @@ void computeH(double *U)// H_k(i,j)(f, E, phi_l)
 
 void RK3(double *U) // RK3 for f_t = H(f)
 {
-  int k, l;
-  //double **H = (double **)malloc(size*sizeof(double *));
-  //for (l=0;l<size;l++) H[l] = (double*)malloc(6*sizeof(double));
-  //double **U1 = (double **)malloc(size*sizeof(double *));
-  //for (l=0;l<size;l++) U1[l] = (double*)malloc(6*sizeof(double));
-  
-  /*
-  computeH(U);
-   #pragma omp parallel for private(k,l) shared(U)
-  for(k=0;k<size;k++){				  
-	  for(l=0;l<6;l++) U1[k*6+l] = U[k*6+l] + dt*H[k*6+l];				  
-  }
- 
-  computeH(U1);
-   #pragma omp parallel for private(k,l) shared(U)
-  for(k=0;k<size;k++){						  
-	  for(l=0;l<6;l++) U1[k*6+l] = 0.75*U[k*6+l] + 0.25*U1[k*6+l] + 0.25*dt*H[k*6+l];		 
-  }
+  int k;
+  double *tmp;
 
-  computeH(U1);
-   #pragma omp parallel for private(k,l) shared(U)
-  for(k=0;k<size;k++){						  
-	for(l=0;l<6;l++) U[k*6+l] = U[k*6+l]/3. + U1[k*6+l]*2./3. + dt*H[k*6+l]*2./3.;			
-  }
-  */
-  //free(H); free(U1);
+  // WITHOUT MPI THIS PROCESS OWNS EVERY SPACE CELL (chunk_Nx = Nx), SO THERE ARE NO GHOST PLANES TO EXCHANGE AND Utmp IS AS LARGE AS U1:
+  computeFieldCoeffs(U);															// calculate ce, cp, intE, intE1 & intE2 for the field of U
+  RK3_Stage(0, U, U1, U1, 0, Nx);															// U1 = U + dt*H(U) (stage 0 doesn't read U1)
+  /////////////////// 1st step of RK3 done//////////////////////////////////////////////////////// 
+
+  computeFieldCoeffs(U1);															// calculate ce, cp, intE, intE1 & intE2 for the field of U1
+  RK3_Stage(1, U, U1, Utmp, 0, Nx);														// Utmp = 0.75*U + 0.25*U1 + 0.25*dt*H(U1)
+  tmp = U1; U1 = Utmp; Utmp = tmp;
+  /////////////////// 2nd step of RK3 done//////////////////////////////////////////////////////// 
+
+  computeFieldCoeffs(U1);															// calculate ce, cp, intE, intE1 & intE2 for the field of U1
+  RK3_Stage(2, U, U1, Utmp, 0, Nx);														// Utmp = U/3 + 2*U1/3 + 2*dt*H(U1)/3
+  #pragma omp parallel for private(k) shared(U, Utmp)
+  for(k=0;k<size*6;k++) U[k] = Utmp[k];
+  /////////////////// 3rd step of RK3 done//////////////////////////////////////////////////////// 
 }
 #endif
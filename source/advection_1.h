@@ -42,8 +42,20 @@ double I3(double *U, int k, int l);
 
 double I5(double *U, int k, int l);
 
+double *allocSlab(double **block);
+
+void RK3_Stage(int stage, double *U, double *U1, double *Uout, int x_from, int x_to);
+
 void computeH(double *U);
 
+#ifdef UseMPI
+int startGhostExchange(double *U, MPI_Request *requests);
+
+void gatherSlabs(double *U);
+
+void scatterSlabs(double *U);
+#endif
+
 void RK3(double *U);
 
 #endif /* ADVECTION_1_H_ */
@@ -1,8 +1,13 @@
 /* This is the source file which contains the subroutines necessary for solving the space homogeneous,
- * collision problem resulting from time-splitting, including FFT routines.
+ * collision problem resulting from time-splitting (the FFT routines it uses are in SpectralTransform.cpp).
  *
- * Functions included: S1hat, S233hat, S213hat, gHat3, gHat3_linear, generate_conv_weights,
- * generate_conv_weights_linear, fft3D, ifft3D, FS, ComputeQ, IntModes, ProjectedNodeValue, RK4
+ * Functions included: S1hat, S233hat, S213hat, computeShat, gHat3, gHat3_linear, generate_conv_weights,
+ * generate_conv_weights_linear, generate_weight_table, generate_conv_weights_rows,
+ * generate_conv_weights_linear_rows, generate_conv_coeffs, generate_int_modes, IntModes,
+ * generate_proj_modes, contractModes, transposeComplex, ProjectOntoCells, ProjectedNodeValue,
+ * convMonomials, ComputeQ_MatrixFree, ComputeQ_FFT, ComputeQ_Symmetric, ComputeQ_WithMethod, convWindow,
+ * mirrorWeights, directModePair, directQuadrature, ComputeQ_Direct, checkComputeQ, RK4_ProjectStep,
+ * ComputeQ_Batch, RK4_Batch, ComputeQ, RK4
  *
  */
 
@@ -10,10 +15,7 @@
 
 extern fftw_plan p_forward; 
 extern fftw_plan p_backward; 
-extern fftw_complex *temp;
-
-double IntM[10];																					// declare an array IntM to hold 10 double variables
-#pragma omp threadprivate(IntM)																		// start the OpenMP parallel construct to start the threads which will run in parallel, passing IntM to each thread as private variables which will have their contents deleted when the threads finish (doesn't seem to be doing anything since no {} afterwards???)
+extern fftw_plan p_forward_pad, p_backward_pad;
 
 double S1hat(double ki1,double ki2,double ki3)
 {
@@ -35,6 +37,17 @@ double S213hat(double ki1, double ki2, double ki3)
   else return -sqrt(2/PI)*ki1*ki3*(2.*R_v*r+R_v*r*cos(R_v*r)-3.*sin(R_v*r))/(R_v*pow(r,5.));
 }
 
+void computeShat(double ki1, double ki2, double ki3, double Shat[3][3])							// function to calculate the 3x3 matrix Shat(ki) appearing in the convolution weights (which only depends on omega = ki, not on xi)
+{
+	Shat[0][0]=S1hat(ki1,ki2,ki3)-S233hat(ki2,ki3,ki1);
+	Shat[1][1]=S1hat(ki1,ki2,ki3)-S233hat(ki1,ki3,ki2);
+	Shat[2][2]=S1hat(ki1,ki2,ki3)-S233hat(ki1,ki2,ki3);
+	Shat[0][1]=-S213hat(ki1,ki3,ki2);
+	Shat[0][2]=-S213hat(ki1,ki2,ki3);
+	Shat[1][2]=-S213hat(ki2,ki1,ki3);
+	Shat[1][0]=Shat[0][1]; Shat[2][0]=Shat[0][2]; Shat[2][1]=Shat[1][2];
+}
+
 double gHat3(double eta1, double eta2, double eta3, double ki1, double ki2, double ki3 ) 
 {
 	double result = 0.;
@@ -52,13 +65,7 @@ double gHat3(double eta1, double eta2, double eta3, double ki1, double ki2, doub
 	Shat[1][2]=-S212hat(-ki2,-ki3,-ki1)+S212hat(eta2-ki2,eta3-ki3,eta1-ki1);
 	Shat[1][0]=Shat[0][1]; Shat[2][0]=Shat[0][2]; Shat[2][1]=Shat[1][2]; */
 
-	Shat[0][0]=S1hat(ki1,ki2,ki3)-S233hat(ki2,ki3,ki1);
-	Shat[1][1]=S1hat(ki1,ki2,ki3)-S233hat(ki1,ki3,ki2);
-	Shat[2][2]=S1hat(ki1,ki2,ki3)-S233hat(ki1,ki2,ki3);
-	Shat[0][1]=-S213hat(ki1,ki3,ki2);
-	Shat[0][2]=-S213hat(ki1,ki2,ki3);
-	Shat[1][2]=-S213hat(ki2,ki1,ki3);
-	Shat[1][0]=Shat[0][1]; Shat[2][0]=Shat[0][2]; Shat[2][1]=Shat[1][2];
+	computeShat(ki1, ki2, ki3, Shat);
 	
 	/*darg[0][0]=ki[0];darg[0][1]=sqrt(ki[1]*ki[1]+ki[2]*ki[2]);
 	darg[1][0]=ki[1];darg[1][1]=sqrt(ki[2]*ki[2]+ki[0]*ki[0]);
@@ -85,13 +92,7 @@ double gHat3_linear(double eta1, double eta2, double eta3, double ki1, double ki
 	//double darg[3][2];
 	int i,j;
 
-	Shat[0][0]=S1hat(ki1,ki2,ki3)-S233hat(ki2,ki3,ki1);
-	Shat[1][1]=S1hat(ki1,ki2,ki3)-S233hat(ki1,ki3,ki2);
-	Shat[2][2]=S1hat(ki1,ki2,ki3)-S233hat(ki1,ki2,ki3);
-	Shat[0][1]=-S213hat(ki1,ki3,ki2);
-	Shat[0][2]=-S213hat(ki1,ki2,ki3);
-	Shat[1][2]=-S213hat(ki2,ki1,ki3);
-	Shat[1][0]=Shat[0][1]; Shat[2][0]=Shat[0][2]; Shat[2][1]=Shat[1][2];
+	computeShat(ki1, ki2, ki3, Shat);
 
 	for(i=0;i<3;i++){
 	  for(j=0;j<3;j++){
@@ -125,162 +126,156 @@ void generate_conv_weights(double **conv_weights)
 #else */
 void generate_conv_weights(double **conv_weights)
 {
-  int i, j, k, l, m, n;
-   #pragma omp parallel for private(i,j,k,l,m,n) shared(conv_weights)
-  for(i=0;i<N;i++){
-    for(j=0;j<N;j++){
-      for(k=0;k<N;k++){ 
-	for(l=0;l<N;l++){
-	  for(m=0;m<N;m++){
-	    for(n=0;n<N;n++) {
-	     conv_weights[k + N*(j + N*i)][n + N*(m + N*l)] = gHat3(eta[i], eta[j], eta[k], eta[l], eta[m], eta[n]); // in the notes, correspondingly, (i,j,k)-kxi, (l,m,n)-w	      	      
-	    }
-	  }
-	}
-      }
-    }
-  }
+  generate_conv_weights_rows(conv_weights, 0, size_ft);
 }
 
 void generate_conv_weights_linear(double **conv_weights_linear)
 {
-  int i, j, k, l, m, n;
-   #pragma omp parallel for private(i,j,k,l,m,n) shared(conv_weights_linear)
-  for(i=0;i<N;i++){
-    for(j=0;j<N;j++){
-      for(k=0;k<N;k++){ 
-	for(l=0;l<N;l++){
-	  for(m=0;m<N;m++){
-	    for(n=0;n<N;n++) {
-	     conv_weights_linear[k + N*(j + N*i)][n + N*(m + N*l)] = gHat3_linear(eta[i], eta[j], eta[k], eta[l], eta[m], eta[n]); // in the notes, correspondingly, (i,j,k)-kxi, (l,m,n)-w	      	      
-	    }
-	  }
-	}
-      }
-    }
-  }
+  generate_conv_weights_linear_rows(conv_weights_linear, 0, size_ft);
 }
-//#endif
-/*$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$*/
 
 /*
-function fft3D
---------------
-Computes the fourier transform of in, and adjusts the coefficients based on our v, eta
+function generate_weight_table
+------------------------------
+Stores the parts of the convolution weights which only depend on omega = eta(l,m,n), so that they are
+calculated N^3 times rather than N^6 times (S1hat, S233hat & S213hat need sqrt, sin, cos & pow).  For each
+omega with index w, table[p*size_ft + w] holds (for p = 0,...,9)
+	omega_1, omega_2, omega_3, a, Shat_11, Shat_22, Shat_33, Shat_12, Shat_13, Shat_23,
+where gHat3(xi, omega) = a - (xi - omega)^T Shat (xi - omega) (as in gHat3).  Each of the 10 values is
+stored contiguously over omega so that the rows of weights can be built from them with SIMD instructions.
 */
-void fft3D(fftw_complex *in, fftw_complex *out)
+void generate_weight_table(double *table)
 {
-  int i, j, k, index;
-  double sum;
-  
-  //shift the 'v' terms in the exponential to reflect our velocity domain
-  for(i=0;i<N;i++)
-    for(j=0;j<N;j++)
-      for(k=0;k<N;k++)
-	{
-
-	  index = k + N*(j + N*i);
-	  sum = ((double)i + (double)j + (double)k)*L_eta*h_v;
+	int w, l, m, n;																					// declare w (the index of omega = eta(l,m,n)) & (l,m,n) (the indices of omega in each direction)
+	double Shat[3][3], r;																			// declare Shat (the matrix Shat(omega)) & r (the magnitude of omega)
 
-	  //h_v correspond to the velocity space scaling - ensures that the FFT is properly scaled since fftw does no scaling at all
-	  temp[index][0] = scale3*h_v*h_v*h_v*wtN[i]*wtN[j]*wtN[k]*(cos(sum)*in[index][0] - sin(sum)*in[index][1]);
-	  temp[index][1] = scale3*h_v*h_v*h_v*wtN[i]*wtN[j]*wtN[k]*(cos(sum)*in[index][1] + sin(sum)*in[index][0]);
-	}
-  //computes fft
-  fftw_execute(p_forward);
-  //fftwnd_threads_one(nThreads, p_forward, temp, NULL); /*FFTW Library*/
-
-  //shifts the 'eta' terms to reflect our fourier domain
-  for(i=0;i<N;i++)
-    for(j=0;j<N;j++)
-      for(k=0;k<N;k++)
+	#pragma omp parallel for private(w,l,m,n,Shat,r) shared(table, eta)
+	for(w=0;w<size_ft;w++)
 	{
-	  index = k + N*(j + N*i);
-	  sum = L_v*(eta[i] + eta[j] + eta[k]);
-	  
-	  out[index][0] = ( cos(sum)*temp[index][0] - sin(sum)*temp[index][1]);
-	  out[index][1] = ( cos(sum)*temp[index][1] + sin(sum)*temp[index][0]);
+		n = w % N;
+		m = (w/N) % N;
+		l = w/(N*N);
+		computeShat(eta[l], eta[m], eta[n], Shat);
+		r = sqrt(eta[l]*eta[l] + eta[m]*eta[m] + eta[n]*eta[n]);
+
+		table[w] = eta[l]; table[size_ft + w] = eta[m]; table[2*size_ft + w] = eta[n];
+		table[3*size_ft + w] = (r == 0.) ? 0. : sqrt(8./PI)*(R_v*r - sin(R_v*r))/(R_v*r);			// as in gHat3, the weight at omega = 0 is just -(xi^T Shat xi)
+		table[4*size_ft + w] = Shat[0][0]; table[5*size_ft + w] = Shat[1][1]; table[6*size_ft + w] = Shat[2][2];
+		table[7*size_ft + w] = Shat[0][1]; table[8*size_ft + w] = Shat[0][2]; table[9*size_ft + w] = Shat[1][2];
 	}
-  
 }
 
-/*$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$*/
-/*
-function fft3D
---------------
-Computes the inverse fourier transform of in, and adjusts the coefficients based on our v, eta
-*/
-
-void ifft3D(fftw_complex *in, fftw_complex *out)
+void generate_conv_weights_rows(double **conv_weights, int t_start, int t_end) // calculate only the rows t_start <= t < t_end of conv_weights (so that the rows can be shared out between processes)
 {
-  int i, j, k, index;
-  double sum, numScale = scale3;//= pow((double)N, -3.0);
-
-  //shifts the 'eta' terms to reflect our fourier domain
-  for(i=0;i<N;i++)
-    for(j=0;j<N;j++)
-      for(k=0;k<N;k++)
-	{
-	  index = k + N*(j + N*i);
-	  sum = -( ( (double)i + (double)j + (double)k )*L_v*h_eta );
-	  
-	  //h_eta ensures FFT is scaled correctly, since fftw does no scaling at all
-	  temp[index][0] = h_eta*h_eta*h_eta*wtN[i]*wtN[j]*wtN[k]*(cos(sum)*in[index][0] - sin(sum)*in[index][1]);
-	  temp[index][1] = h_eta*h_eta*h_eta*wtN[i]*wtN[j]*wtN[k]*(cos(sum)*in[index][1] + sin(sum)*in[index][0]);
-	}
-  //compute IFFT
-  fftw_execute(p_backward);
-  //fftwnd_threads_one(nThreads, p_backward, temp, NULL); /*FFTW Library*/
-
-  //shifts the 'v' terms to reflect our velocity domain
-  for(i=0;i<N;i++)
-    for(j=0;j<N;j++)
-      for(k=0;k<N;k++)
-	{
-	  index = k + N*(j + N*i);
-	  sum = -( L_eta*(v[i] + v[j] + v[k])  );
-	  
-	  out[index][0] = (cos(sum)*temp[index][0] - sin(sum)*temp[index][1])*numScale;
-	  out[index][1] = (cos(sum)*temp[index][1] + sin(sum)*temp[index][0])*numScale;
-	}
-  
+  int t, w;
+  double x0, x1, x2, d0, d1, d2, result, *table;
+  double *w0, *w1, *w2, *a, *S00, *S11, *S22, *S01, *S02, *S12;
+
+  table = (double *)malloc(10*size_ft*sizeof(double));
+  generate_weight_table(table); // everything in gHat3 which only depends on omega
+  w0 = table; w1 = w0 + size_ft; w2 = w1 + size_ft; a = w2 + size_ft;
+  S00 = a + size_ft; S11 = S00 + size_ft; S22 = S11 + size_ft; S01 = S22 + size_ft; S02 = S01 + size_ft; S12 = S02 + size_ft;
+
+  #pragma omp parallel for schedule(static) private(t,w,x0,x1,x2,d0,d1,d2,result) shared(conv_weights, w0, w1, w2, a, S00, S11, S22, S01, S02, S12)
+  for(t=t_start;t<t_end;t++){
+    x0 = eta[t/(N*N)];
+    x1 = eta[(t/N) % N];
+    x2 = eta[t % N];
+    #pragma omp simd private(d0,d1,d2,result)
+    for(w=0;w<size_ft;w++){
+      d0 = x0 - w0[w]; d1 = x1 - w1[w]; d2 = x2 - w2[w];
+      // the same sum as in gHat3 (Shat[i][j]*(zeta[i]-ki[i])*(zeta[j]-ki[j]), in the same order):
+      result = S00[w]*d0*d0 + S01[w]*d0*d1 + S02[w]*d0*d2 + S01[w]*d1*d0 + S11[w]*d1*d1 + S12[w]*d1*d2 + S02[w]*d2*d0 + S12[w]*d2*d1 + S22[w]*d2*d2;
+      conv_weights[t][w] = (a[w] == 0.) ? -result : a[w] - result; // (a is only 0 at omega = 0, where gHat3 returns -result) in the notes, correspondingly, (i,j,k)-kxi, (l,m,n)-w
+    }
+  }
+  free(table);
 }
 
-void FS(fftw_complex *in, fftw_complex *out) // compute the Fourier series approximation of f (out), through fhat (in)
+void generate_conv_weights_linear_rows(double **conv_weights_linear, int t_start, int t_end) // calculate only the rows t_start <= t < t_end of conv_weights_linear
 {
-  int i, j, k, index;
-  double sum;//= pow((double)N, -3.0);
-
-  //shifts the 'eta' terms to reflect our fourier domain
-  for(i=0;i<N;i++){
-    for(j=0;j<N;j++){
-      for(k=0;k<N;k++){
-	  index = k + N*(j + N*i);
-	  sum = -( ( (double)i + (double)j + (double)k )*L_v*h_eta );
-	  
-	  //h_eta ensures FFT is scaled correctly, since fftw does no scaling at all
-	  temp[index][0] = (cos(sum)*in[index][0] - sin(sum)*in[index][1]);
-	  temp[index][1] = (cos(sum)*in[index][1] + sin(sum)*in[index][0]);
-      }
-    }
-  }
-  //compute IFFT
-  fftw_execute(p_backward);
-  //fftwnd_threads_one(nThreads, p_backward, temp, NULL); /*FFTW Library*/
-
-  //shifts the 'v' terms to reflect our velocity domain
-  for(i=0;i<N;i++){
-    for(j=0;j<N;j++){
-      for(k=0;k<N;k++){
-	  index = k + N*(j + N*i);
-	  sum = -( L_eta*(v[i] + v[j] + v[k])  );
-	  
-	  out[index][0] = (cos(sum)*temp[index][0] - sin(sum)*temp[index][1])/scaleL/scale3;
-	  out[index][1] = (cos(sum)*temp[index][1] + sin(sum)*temp[index][0])/scaleL/scale3;
-      }
+  int t, w;
+  double x0, x1, x2, d0, d1, d2, result, *table;
+  double *w0, *w1, *w2, *S00, *S11, *S22, *S01, *S02, *S12;
+
+  table = (double *)malloc(10*size_ft*sizeof(double));
+  generate_weight_table(table); // everything in gHat3_linear which only depends on omega
+  w0 = table; w1 = w0 + size_ft; w2 = w1 + size_ft;
+  S00 = w2 + 2*size_ft; S11 = S00 + size_ft; S22 = S11 + size_ft; S01 = S22 + size_ft; S02 = S01 + size_ft; S12 = S02 + size_ft;
+
+  #pragma omp parallel for schedule(static) private(t,w,x0,x1,x2,d0,d1,d2,result) shared(conv_weights_linear, w0, w1, w2, S00, S11, S22, S01, S02, S12)
+  for(t=t_start;t<t_end;t++){
+    x0 = eta[t/(N*N)];
+    x1 = eta[(t/N) % N];
+    x2 = eta[t % N];
+    #pragma omp simd private(d0,d1,d2,result)
+    for(w=0;w<size_ft;w++){
+      d0 = x0 - w0[w]; d1 = x1 - w1[w]; d2 = x2 - w2[w];
+      // the same sum as in gHat3_linear (Shat[i][j]*zeta[i]*(zeta[j]-ki[j]), in the same order, starting from 0 so that the sign of a zero weight is the same):
+      result = 0. + S00[w]*x0*d0 + S01[w]*x0*d1 + S02[w]*x0*d2 + S01[w]*x1*d0 + S11[w]*x1*d1 + S12[w]*x1*d2 + S02[w]*x2*d0 + S12[w]*x2*d1 + S22[w]*x2*d2;
+      conv_weights_linear[t][w] = -result;
     }
   }
-  
+  free(table);
+}
+//#endif
+
+/*
+function generate_conv_coeffs
+-----------------------------
+Since gHat3(xi, omega) = a(omega) - (xi - omega)^T Shat(omega) (xi - omega), each convolution weight is a
+quadratic polynomial in xi whose coefficients only depend on omega, namely
+	gHat3(xi, omega) = c0 + b.xi - xi^T Shat xi,	with c0 = a - omega^T Shat omega & b = 2 Shat omega,
+and gHat3_linear(xi, omega) = b.xi/2 - xi^T Shat xi uses the same coefficients.  This stores the 10 values
+(c0, b_1, b_2, b_3, Shat_11, Shat_22, Shat_33, Shat_12, Shat_13, Shat_23) for each omega = eta(l,m,n) in
+conv_coeffs[10*(n + N*(m + N*l))], already multiplied by the quadrature weight h_eta^3*wtN[l]*wtN[m]*wtN[n],
+so that ComputeQ_MatrixFree can rebuild each weight when it is needed from O(N^3) storage instead of
+reading it from the N^3 x N^3 table conv_weights.
+*/
+void generate_conv_coeffs(double *conv_coeffs)
+{
+	int t, l, m, n, p, q;																			// declare t (the index of omega = eta(l,m,n)), (l,m,n) (the indices of omega in each direction) & p, q (counters for the entries of Shat)
+	double ki[3], Shat[3][3], Sw[3], r, a, wSw, quad_wt;											// declare ki (the components of omega), Shat (the matrix Shat(omega)), Sw (the vector Shat*omega), r (the magnitude of omega), a (the part of the weight which does not involve Shat), wSw (the value of omega^T Shat omega) & quad_wt (the quadrature weight for omega)
+	double prefactor = h_eta*h_eta*h_eta;															// declare prefactor (the value of h_eta^3, as no scale3 in Fourier space) and set its value
+	double *c;																						// declare a pointer to c (the coefficients for the current omega)
+
+	#pragma omp parallel for private(t,l,m,n,p,q,ki,Shat,Sw,r,a,wSw,quad_wt,c) shared(conv_coeffs, eta, wtN)
+	for(t=0;t<size_ft;t++)
+	{
+		n = t % N;																					// the index of omega in the third direction
+		m = (t/N) % N;																				// the index of omega in the second direction
+		l = t/(N*N);																				// the index of omega in the first direction
+		ki[0] = eta[l]; ki[1] = eta[m]; ki[2] = eta[n];
+
+		computeShat(ki[0], ki[1], ki[2], Shat);														// calculate the matrix Shat(omega)
+		r = sqrt(ki[0]*ki[0] + ki[1]*ki[1] + ki[2]*ki[2]);
+		if(r == 0.)
+		{
+			a = 0.;																					// as in gHat3, the weight at omega = 0 is just -(xi^T Shat xi)
+		}
+		else
+		{
+			a = sqrt(8./PI)*(R_v*r - sin(R_v*r))/(R_v*r);
+		}
+
+		wSw = 0.;
+		for(p=0;p<3;p++)
+		{
+			Sw[p] = 0.;
+			for(q=0;q<3;q++)
+			{
+				Sw[p] += Shat[p][q]*ki[q];															// calculate the pth component of Shat*omega
+			}
+			wSw += ki[p]*Sw[p];																		// add its contribution to omega^T Shat omega
+		}
+
+		quad_wt = prefactor*wtN[l]*wtN[m]*wtN[n];													// the weight of omega in the quadrature for qHat
+		c = &conv_coeffs[10*t];
+		c[0] = quad_wt*(a - wSw);																	// c0
+		c[1] = quad_wt*2.*Sw[0]; c[2] = quad_wt*2.*Sw[1]; c[3] = quad_wt*2.*Sw[2];					// b = 2 Shat omega
+		c[4] = quad_wt*Shat[0][0]; c[5] = quad_wt*Shat[1][1]; c[6] = quad_wt*Shat[2][2];			// the diagonal of Shat
+		c[7] = quad_wt*Shat[0][1]; c[8] = quad_wt*Shat[0][2]; c[9] = quad_wt*Shat[1][2];			// the off-diagonal entries of Shat
+	}
 }
 
 /*$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$*/
@@ -303,11 +298,7 @@ void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights)
   //fftIn = (fftw_complex *)fftw_malloc(N*N*N*sizeof(fftw_complex));
   //fftOut = (fftw_complex *)fftw_malloc(N*N*N*sizeof(fftw_complex));  
 
-  for(i=0;i<size_ft;i++){
-    fftIn[i][0] = f[i];
-    fftIn[i][1] = 0.;
-  }
-  fft3D(fftIn, fftOut);
+  fft3D(f, fftOut);
   
   #pragma omp parallel for schedule(dynamic) private(j,k,l,m,n,x,y,z,start_i,start_j,start_k,end_i,end_j,end_k,tempD, tmp0, tmp1) shared(qHat, conv_weights)
   for(t=chunksize_ft*myrank_mpi;t<chunksize_ft*(myrank_mpi+1);t++){   
@@ -369,167 +360,187 @@ void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights)
 #endif
 
 
-void IntModes(int k1, int k2,  int k3, int j1, int j2, int j3, double *result) // \int_Ij exp(i\xi_k \cdot v) \phi_l(v) dv; l=0..4: 1, (v1-w_j1)/dv, (v2-w_j2)/dv, (v3-w_j3)/dv, square sum of last three components
+/*
+function generate_int_modes
+---------------------------
+Each integral in IntModes, \int_Ij exp(i\xi_k \cdot v) \phi_l(v) dv, is a product over the three directions
+of 1-D integrals over the velocity cell j_d of exp(i eta[k_d] v_d) times 1, (v_d - w_j_d)/dv or
+((v_d - w_j_d)/dv)^2, which only depend on the pair (k_d, j_d).  This stores these three 1-D integrals
+(real & imaginary parts) for every k < N & j < Nv in int_modes[2*(j + Nv*(k + N*p))], for the moment p = 0, 1, 2,
+so that IntModes only has to multiply them together (with no sin or cos left in the time loop).
+*/
+void generate_int_modes(double *int_modes)
 {
-  double tmp_re, tmp_im, tmp1_re, tmp1_im, tmp2_re, tmp2_im, tmp3_re, tmp3_im, tem1_re, tem1_im, tem2_re, tem2_im, tem3_re, tem3_im, tp1_re, tp1_im, tp2_re, tp2_im, tp3_re, tp3_im, a_re, a_im;
-
-  double v1, v2, v3;																	// define v1, v2 & v3 (where v_k is the center of the current velocity cell in the kth direction)
-  double v1_l, v1_r, v2_l, v2_r, v3_l, v3_r;											// define v1_l, v1_r, v2_l, v2_r, v3_l & v3_r (where vk_l & vk_r are the values of v_(j_k) at the left and right edges of the velocity cell j in the kth direction)
-  v1 = Gridv((double)j1);																		// calculate v1 by the formula -Lv+(j1+0.5)*dv
-  v2 = Gridv((double)j2);																		// calculate v2 by the formula -Lv+(j2+0.5)*dv
-  v3 = Gridv((double)j3);																		// calculate v3 by the formula -Lv+(j3+0.5)*dv
-  v1_l = Gridv(j1-0.5);																	// calculate v1_l by the formula -Lv+j1*dv
-  v1_r = Gridv(j1+0.5);																	// calculate v1_r by the formula -Lv+(j1+1)*dv
-  v2_l = Gridv(j2-0.5);																	// calculate v2_l by the formula -Lv+j2*dv
-  v2_r = Gridv(j2+0.5);																	// calculate v2_r by the formula -Lv+(j2+1)*dv
-  v3_l = Gridv(j3-0.5);																	// calculate v3_l by the formula -Lv+j3*dv
-  v3_r = Gridv(j3+0.5);																	// calculate v3_r by the formula -Lv+(j3+1)*dv
-
-  if(eta[k1] != 0.){
-    tmp1_re = (sin(eta[k1]*v1_r) - sin(eta[k1]*v1_l))/eta[k1];
-    tmp1_im = (cos(eta[k1]*v1_l) - cos(eta[k1]*v1_r))/eta[k1];
-  }
-  else 
-  {
-    tmp1_re = dv;
-    tmp1_im = 0.;
-  }
-  
-  if(eta[k2] != 0.){
-    tmp2_re = (sin(eta[k2]*v2_r) - sin(eta[k2]*v2_l))/eta[k2];
-    tmp2_im = (cos(eta[k2]*v2_l) - cos(eta[k2]*v2_r))/eta[k2];
-  }
-  else 
-  {
-    tmp2_re = dv;
-    tmp2_im = 0.;
-  }
-  
-  if(eta[k3] != 0.){
-    tmp3_re = (sin(eta[k3]*v3_r) - sin(eta[k3]*v3_l))/eta[k3];
-    tmp3_im = (cos(eta[k3]*v3_l) - cos(eta[k3]*v3_r))/eta[k3];
-  }
-  else 
-  {
-    tmp3_re = dv;
-    tmp3_im = 0.;
-  }
-  
-  tem1_re=tmp1_re; tem2_re=tmp2_re;  tem3_re=tmp3_re;  
-  tem1_im=tmp1_im; tem2_im=tmp2_im;  tem3_im=tmp3_im;
-          
-  tmp_re = tmp3_re*(tmp1_re*tmp2_re - tmp1_im*tmp2_im) - tmp3_im*(tmp1_re*tmp2_im + tmp2_re*tmp1_im);
-  tmp_im = tmp3_re*(tmp1_re*tmp2_im + tmp2_re*tmp1_im) + tmp3_im*(tmp1_re*tmp2_re - tmp1_im*tmp2_im);
-  result[0]=tmp_re; result[1]=tmp_im;
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-  
-  if(eta[k1] != 0.){
-    tmp1_re = ((v1_r*sin(eta[k1]*v1_r) - v1_l*sin(eta[k1]*v1_l))/eta[k1] + (cos(eta[k1]*v1_r) - cos(eta[k1]*v1_l))/eta[k1]/eta[k1] -v1*tem1_re)/dv;
-    tmp1_im = ((sin(eta[k1]*v1_r) - sin(eta[k1]*v1_l))/eta[k1]/eta[k1] + (v1_l*cos(eta[k1]*v1_l) - v1_r*cos(eta[k1]*v1_r))/eta[k1] -v1*tem1_im)/dv;
-  }
-  else
-  {
-    tmp1_re = 0.; 
-    tmp1_im = 0.;
-  }         
-  
-  tmp_re = tem3_re*(tmp1_re*tem2_re - tmp1_im*tem2_im) - tem3_im*(tmp1_re*tem2_im + tem2_re*tmp1_im);
-  tmp_im = tem3_re*(tmp1_re*tem2_im + tem2_re*tmp1_im) + tem3_im*(tmp1_re*tem2_re - tmp1_im*tem2_im);
-  result[1*2]=tmp_re; result[1*2+1]=tmp_im;
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
+	int k, j;																						// declare k (the index of eta) & j (the index of the velocity cell)
+	double e, vc, vl, vr, re0, im0, a_re, a_im, *I0, *I1, *I2;										// declare e (the value of eta[k]), vc, vl & vr (the center & edges of the velocity cell j), re0 & im0 (the integral of exp(i e v) over the cell), a_re & a_im (the integral of v*exp(i e v) over the cell) and pointers to I0, I1 & I2 (the entries for the three moments)
 
-	  
-  if(eta[k2] != 0.){
-    tmp2_re = ((v2_r*sin(eta[k2]*v2_r) - v2_l*sin(eta[k2]*v2_l))/eta[k2] + (cos(eta[k2]*v2_r) - cos(eta[k2]*v2_l))/eta[k2]/eta[k2] -v2*tem2_re)/dv;
-    tmp2_im = ((sin(eta[k2]*v2_r) - sin(eta[k2]*v2_l))/eta[k2]/eta[k2] + (v2_l*cos(eta[k2]*v2_l) - v2_r*cos(eta[k2]*v2_r))/eta[k2] -v2*tem2_im)/dv;
-  }
-  else
-  {
-    tmp2_re = 0; 
-    tmp2_im = 0.;
-  }
+	#pragma omp parallel for private(k,j,e,vc,vl,vr,re0,im0,a_re,a_im,I0,I1,I2) shared(int_modes, eta)
+	for(k=0;k<N;k++)
+	{
+		for(j=0;j<Nv;j++)
+		{
+			e = eta[k];
+			vc = Gridv((double)j);																	// calculate vc by the formula -Lv+(j+0.5)*dv
+			vl = Gridv(j-0.5);																		// calculate vl by the formula -Lv+j*dv
+			vr = Gridv(j+0.5);																		// calculate vr by the formula -Lv+(j+1)*dv
+			I0 = &int_modes[2*(j + Nv*(k + N*0))];
+			I1 = &int_modes[2*(j + Nv*(k + N*1))];
+			I2 = &int_modes[2*(j + Nv*(k + N*2))];
+
+			if(e != 0.)
+			{
+				re0 = (sin(e*vr) - sin(e*vl))/e;
+				im0 = (cos(e*vl) - cos(e*vr))/e;
+				a_re = (vr*sin(e*vr) - vl*sin(e*vl))/e + (cos(e*vr) - cos(e*vl))/e/e;				// real part of \int exp(i e v) v dv
+				a_im = (sin(e*vr) - sin(e*vl))/e/e + (vl*cos(e*vl) - vr*cos(e*vr))/e;
+
+				I0[0] = re0; I0[1] = im0;
+				I1[0] = (a_re - vc*re0)/dv;
+				I1[1] = (a_im - vc*im0)/dv;
+				I2[0] = ((vr*vr*sin(e*vr) - vl*vl*sin(e*vl) - 2*a_im)/e - 2*vc*a_re + vc*vc*re0)/dv/dv;
+				I2[1] = ((vl*vl*cos(e*vl) - vr*vr*cos(e*vr) + 2*a_re)/e - 2*vc*a_im + vc*vc*im0)/dv/dv;
+			}
+			else
+			{
+				I0[0] = dv; I0[1] = 0.;
+				I1[0] = 0.; I1[1] = 0.;
+				I2[0] = dv/12.; I2[1] = 0.;
+			}
+		}
+	}
+}
 
-  tmp_re = tem3_re*(tem1_re*tmp2_re - tem1_im*tmp2_im) - tmp3_im*(tem1_re*tmp2_im + tmp2_re*tem1_im);
-  tmp_im = tem3_re*(tem1_re*tmp2_im + tmp2_re*tem1_im) + tmp3_im*(tem1_re*tmp2_re - tem1_im*tmp2_im);
-  result[2*2]=tmp_re; result[2*2+1]=tmp_im;
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-  
-  if(eta[k3] != 0.){
-    tmp3_re = ((v3_r*sin(eta[k3]*v3_r) - v3_l*sin(eta[k3]*v3_l))/eta[k3] + (cos(eta[k3]*v3_r) - cos(eta[k3]*v3_l))/eta[k3]/eta[k3] -v3*tem3_re)/dv;;
-    tmp3_im = ((sin(eta[k3]*v3_r) - sin(eta[k3]*v3_l))/eta[k3]/eta[k3] + (v3_l*cos(eta[k3]*v3_l) - v3_r*cos(eta[k3]*v3_r))/eta[k3] -v3*tem3_im)/dv;;
-  }
-  else
-  {
-    tmp3_re = 0.;
-    tmp3_im = 0.;
-  }
-	  
-  tmp_re = tmp3_re*(tem1_re*tem2_re - tem1_im*tem2_im) - tmp3_im*(tem1_re*tem2_im + tem2_re*tem1_im);
-  tmp_im = tmp3_re*(tem1_re*tem2_im + tem2_re*tem1_im) + tmp3_im*(tem1_re*tem2_re - tem1_im*tem2_im);
-  result[3*2]=tmp_re; result[3*2+1]=tmp_im;
-  /////////////////////////////////////////////////////////////////////////////////////////////////////
-  //BUG: wrote one cos as sin in the following tmp1_im, tmp2_im, tmp3_im !!
-  if(eta[k1] != 0.){
-    a_re = (v1_r*sin(eta[k1]*v1_r) - v1_l*sin(eta[k1]*v1_l))/eta[k1] + (cos(eta[k1]*v1_r) - cos(eta[k1]*v1_l))/eta[k1]/eta[k1]; // real part of \int exp(i\xi1.v1) v1 dv1
-    a_im = (sin(eta[k1]*v1_r) - sin(eta[k1]*v1_l))/eta[k1]/eta[k1] + (v1_l*cos(eta[k1]*v1_l) - v1_r*cos(eta[k1]*v1_r))/eta[k1];
-    
-    tmp1_re = ((v1_r*v1_r*sin(eta[k1]*v1_r) - v1_l*v1_l*sin(eta[k1]*v1_l) - 2*a_im)/eta[k1] - 2*v1*a_re + v1*v1*tem1_re)/dv/dv;
-    tmp1_im = ((v1_l*v1_l*cos(eta[k1]*v1_l) - v1_r*v1_r*cos(eta[k1]*v1_r) + 2*a_re)/eta[k1] - 2*v1*a_im + v1*v1*tem1_im)/dv/dv;
-  }
-  else
-  {
-    tmp1_re = dv/12.;
-    tmp1_im = 0.;
-  }	  
-  
-  tp1_re = tem3_re*(tmp1_re*tem2_re - tmp1_im*tem2_im) - tem3_im*(tmp1_re*tem2_im + tem2_re*tmp1_im);
-  tp1_im = tem3_re*(tmp1_re*tem2_im + tem2_re*tmp1_im) + tem3_im*(tmp1_re*tem2_re - tmp1_im*tem2_im);
-  ////////////////////////////////////////////////
-
-  if(eta[k2] != 0.){
-    a_re = (v2_r*sin(eta[k2]*v2_r) - v2_l*sin(eta[k2]*v2_l))/eta[k2] + (cos(eta[k2]*v2_r) - cos(eta[k2]*v2_l))/eta[k2]/eta[k2];
-    a_im = (sin(eta[k2]*v2_r) - sin(eta[k2]*v2_l))/eta[k2]/eta[k2] + (v2_l*cos(eta[k2]*v2_l) - v2_r*cos(eta[k2]*v2_r))/eta[k2];
-    
-    tmp2_re = ((v2_r*v2_r*sin(eta[k2]*v2_r) - v2_l*v2_l*sin(eta[k2]*v2_l) - 2*a_im)/eta[k2] - 2*v2*a_re + v2*v2*tem2_re)/dv/dv;
-    tmp2_im = ((v2_l*v2_l*cos(eta[k2]*v2_l) - v2_r*v2_r*cos(eta[k2]*v2_r) + 2*a_re)/eta[k2] - 2*v2*a_im + v2*v2*tem2_im)/dv/dv;
-  }
-  else
-  {
-    tmp2_re = dv/12.;
-    tmp2_im = 0.;
-  }         
-  
-  tp2_re = tem3_re*(tem1_re*tmp2_re - tem1_im*tmp2_im) - tem3_im*(tem1_re*tmp2_im + tmp2_re*tem1_im);
-  tp2_im = tem3_re*(tem1_re*tmp2_im + tmp2_re*tem1_im) + tem3_im*(tem1_re*tmp2_re - tem1_im*tmp2_im);
-  ////////////////////////////////////////////////  
-	  
-  if(eta[k3] != 0.){
-    a_re = (v3_r*sin(eta[k3]*v3_r) - v3_l*sin(eta[k3]*v3_l))/eta[k3] + (cos(eta[k3]*v3_r) - cos(eta[k3]*v3_l))/eta[k3]/eta[k3];
-    a_im = (sin(eta[k3]*v3_r) - sin(eta[k3]*v3_l))/eta[k3]/eta[k3] + (v3_l*cos(eta[k3]*v3_l) - v3_r*cos(eta[k3]*v3_r))/eta[k3];
-    
-    tmp3_re = ((v3_r*v3_r*sin(eta[k3]*v3_r) - v3_l*v3_l*sin(eta[k3]*v3_l) - 2*a_im)/eta[k3] - 2*v3*a_re + v3*v3*tem3_re)/dv/dv;
-    tmp3_im = ((v3_l*v3_l*cos(eta[k3]*v3_l) - v3_r*v3_r*cos(eta[k3]*v3_r) + 2*a_re)/eta[k3] - 2*v3*a_im + v3*v3*tem3_im)/dv/dv;
-  }
-  else
-  {
-    tmp3_re = dv/12.;
-    tmp3_im = 0.;
-  }    
-  
-  tp3_re = tmp3_re*(tem1_re*tem2_re - tem1_im*tem2_im) - tmp3_im*(tem1_re*tem2_im + tem2_re*tem1_im);
-  tp3_im = tmp3_re*(tem1_re*tem2_im + tem2_re*tem1_im) + tmp3_im*(tem1_re*tem2_re - tem1_im*tem2_im);
-  ////////////////////////////////////////////////	  
-  tmp_re = tp1_re + tp2_re + tp3_re;
-  tmp_im = tp1_im + tp2_im + tp3_im;
-  result[4*2]=tmp_re; result[4*2+1]=tmp_im;
+void IntModes(int k1, int k2,  int k3, int j1, int j2, int j3, double *result) // \int_Ij exp(i\xi_k \cdot v) \phi_l(v) dv; l=0..4: 1, (v1-w_j1)/dv, (v2-w_j2)/dv, (v3-w_j3)/dv, square sum of last three components (from the 1-D integrals in int_modes, see generate_int_modes)
+{
+  double tmp_re, tmp_im, tp1_re, tp1_im, tp2_re, tp2_im, tp3_re, tp3_im;
+  const double *A1 = &int_modes[2*(j1 + Nv*k1)], *A2 = &int_modes[2*(j2 + Nv*k2)], *A3 = &int_modes[2*(j3 + Nv*k3)];	// the 1-D integrals of the moment 0 in each direction (those of the moment p are p*N*Nv*2 entries further on)
+  const double *B1 = A1 + 2*N*Nv, *B2 = A2 + 2*N*Nv, *B3 = A3 + 2*N*Nv;							// ...of the moment 1
+  const double *C1 = A1 + 4*N*Nv, *C2 = A2 + 4*N*Nv, *C3 = A3 + 4*N*Nv;							// ...and of the moment 2
+
+  // EACH MODE IS (factor in v3)*((factor in v1)*(factor in v2)), AS A COMPLEX PRODUCT:
+  tmp_re = A1[0]*A2[0] - A1[1]*A2[1]; tmp_im = A1[0]*A2[1] + A2[0]*A1[1];
+  result[0] = A3[0]*tmp_re - A3[1]*tmp_im; result[1] = A3[0]*tmp_im + A3[1]*tmp_re;
+  result[3*2] = B3[0]*tmp_re - B3[1]*tmp_im; result[3*2+1] = B3[0]*tmp_im + B3[1]*tmp_re;
+  tp3_re = C3[0]*tmp_re - C3[1]*tmp_im; tp3_im = C3[0]*tmp_im + C3[1]*tmp_re;
+
+  tmp_re = B1[0]*A2[0] - B1[1]*A2[1]; tmp_im = B1[0]*A2[1] + A2[0]*B1[1];
+  result[1*2] = A3[0]*tmp_re - A3[1]*tmp_im; result[1*2+1] = A3[0]*tmp_im + A3[1]*tmp_re;
+
+  tmp_re = A1[0]*B2[0] - A1[1]*B2[1]; tmp_im = A1[0]*B2[1] + B2[0]*A1[1];
+  result[2*2] = A3[0]*tmp_re - A3[1]*tmp_im; result[2*2+1] = A3[0]*tmp_im + A3[1]*tmp_re;
+
+  // THE SQUARE SUM IS THE SUM OF THE QUADRATIC MOMENT IN EACH DIRECTION:
+  tmp_re = C1[0]*A2[0] - C1[1]*A2[1]; tmp_im = C1[0]*A2[1] + A2[0]*C1[1];
+  tp1_re = A3[0]*tmp_re - A3[1]*tmp_im; tp1_im = A3[0]*tmp_im + A3[1]*tmp_re;
+  tmp_re = A1[0]*C2[0] - A1[1]*C2[1]; tmp_im = A1[0]*C2[1] + C2[0]*A1[1];
+  tp2_re = A3[0]*tmp_re - A3[1]*tmp_im; tp2_im = A3[0]*tmp_im + A3[1]*tmp_re;
+  result[4*2] = tp1_re + tp2_re + tp3_re; result[4*2+1] = tp1_im + tp2_im + tp3_im;
+}
+
+/*
+function generate_proj_modes
+----------------------------
+Stores the 1-D integrals of int_modes as the real 2N x 6Nv matrix proj_modes, so that multiplying a row of N
+complex numbers c[k] (stored as 2N doubles, real & imaginary parts one after another as in fftw_complex) by
+proj_modes gives the 3*Nv complex numbers \sum_k c[k]*int_modes_p[k][j] for the moment p = 0, 1, 2 & cell j,
+in the same layout (the complex product written out with real numbers).  Taking only the first 2*Nv*n columns
+(proj_modes has a leading dimension of 6*Nv) gives the moments p < n only.
+*/
+void generate_proj_modes(double *int_modes, double *proj_modes)
+{
+	int k, j, p;																					// declare k (the index of eta), j (the index of the velocity cell) & p (the moment)
+	double *I, *row_re, *row_im;																	// declare pointers to I (the entry of int_modes) and row_re & row_im (the rows of proj_modes multiplying the real & imaginary parts of c[k])
+
+	for(k=0;k<N;k++)
+	{
+		row_re = &proj_modes[(2*k)*6*Nv];
+		row_im = &proj_modes[(2*k+1)*6*Nv];
+		for(p=0;p<3;p++)
+		{
+			for(j=0;j<Nv;j++)
+			{
+				I = &int_modes[2*(j + Nv*(k + N*p))];
+				row_re[2*(j + Nv*p)] = I[0]; row_re[2*(j + Nv*p)+1] = I[1];					// c_re*I contributes c_re*I_re to the real part & c_re*I_im to the imaginary part
+				row_im[2*(j + Nv*p)] = -I[1]; row_im[2*(j + Nv*p)+1] = I[0];					// i*c_im*I contributes -c_im*I_im to the real part & c_im*I_re to the imaginary part
+			}
+		}
+	}
+}
+
+static void contractModes(int rows, double *in, int n_moments, double *out)					// function to replace the last index of the rows complex rows of N numbers in in by the index (p, j) of the moments p < n_moments & cells j, storing the result in out (rows rows of n_moments*Nv complex numbers)
+{
+	cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, rows, 2*Nv*n_moments, 2*N, 1., in, 2*N, proj_modes, 6*Nv, 0., out, 2*Nv*n_moments);
+}
+
+static void transposeComplex(int rows, int cols, double *in, double *out)					// function to store the transpose of the rows x cols complex matrix in in out
+{
+	int r, c;
+	#pragma omp parallel for private(r,c) shared(rows, cols, in, out)
+	for(c=0;c<cols;c++){
+		for(r=0;r<rows;r++){
+			out[2*(c*rows + r)] = in[2*(r*cols + c)];
+			out[2*(c*rows + r)+1] = in[2*(r*cols + c)+1];
+		}
+	}
+}
 
+/*
+function ProjectOntoCells
+-------------------------
+Calculates the real parts of \sum_{i,j,k} IntM_m(i,j,k,j1,j2,j3) G[k + N*(j + N*i)] for each velocity cell
+kt = j3 + Nv*(j2 + Nv*j1) and each of the five integrals m of IntModes, and stores them in cells[5*kt + m].
+Each integral is a product of 1-D integrals in v1, v2 & v3 (see generate_int_modes), so rather than summing
+over all N^3 modes for each of the Nv^3 cells the sums are done one direction at a time (sum factorisation):
+first over k for each (i, j), then over j for each (i, j3) and then over i for each (j2, j3), as products
+with proj_modes by dgemm, which takes O(N^3 Nv + N^2 Nv^2 + N Nv^3) work rather than O(N^3 Nv^3).  Only
+the products of moments needed by IntModes are formed (at most one direction with a moment other than 0),
+and the partial sums are transposed in between so that the index summed over next is always the last one.
+The partial sums are kept in ctx->proj_a & ctx->proj_b.
+*/
+void ProjectOntoCells(CollisionContext *ctx, fftw_complex *G, double *cells)
+{
+  int kt, j1, j2, j3, r;
+  double *a = ctx->proj_a, *b = ctx->proj_b, *A, *B;
+  int blk = 2*N*Nv*Nv;																			// the number of doubles in each block of the sums over j (N*Nv*Nv complex numbers)
+
+  // SUM OVER k FOR EACH (i, j), THEN MOVE (p3, j3) TO THE FRONT:
+  contractModes(N*N, (double *)G, 3, a);														// a[(i, j)][(p3, j3)]
+  transposeComplex(N*N, 3*Nv, a, b);															// b[(p3, j3)][(i, j)]
+
+  // SUM OVER j FOR EACH (p3, j3, i) (WITH EVERY MOMENT p2 WHEN p3 = 0 AND ONLY p2 = 0 OTHERWISE), THEN MOVE (p2, j2) TO THE FRONT:
+  contractModes(Nv*N, b, 3, a);																	// a[(j3, i)][(p2, j2)] for p3 = 0
+  contractModes(2*Nv*N, b + 2*N*N*Nv, 1, a + 3*blk);											// a[(p3, j3, i)][j2] for p3 = 1, 2 & p2 = 0
+  transposeComplex(Nv*N, 3*Nv, a, b);															// b[s][j2][(j3, i)] for s = p2 = 0, 1, 2 (& p3 = 0)
+  transposeComplex(Nv*N, Nv, a + 3*blk, b + 3*blk);												// ...for s = 3 (p3 = 1)
+  transposeComplex(Nv*N, Nv, a + 4*blk, b + 4*blk);												// ...and s = 4 (p3 = 2)
+
+  // SUM OVER i FOR EACH (s, j2, j3) (WITH EVERY MOMENT p1 WHEN s = 0 AND ONLY p1 = 0 OTHERWISE):
+  contractModes(Nv*Nv, b, 3, a);																// a[(j2, j3)][(p1, j1)] for s = 0
+  contractModes(4*Nv*Nv, b + blk, 1, a + 6*Nv*Nv*Nv);											// a[(s, j2, j3)][j1] for s = 1, ..., 4 & p1 = 0
+
+  B = a + 6*Nv*Nv*Nv;
+  #pragma omp parallel for private(kt, j1, j2, j3, r, A) shared(a, B, cells)
+  for(kt=0;kt<size_v;kt++){
+    j3 = kt % Nv; j2 = ((kt-j3)/Nv) % Nv; j1 = (kt - j3 - Nv*j2)/(Nv*Nv);
+    r = j3 + Nv*j2;
+    A = a + 6*Nv*r;
+    cells[5*kt] = A[2*j1];																		// 1
+    cells[5*kt+1] = A[2*(Nv + j1)];																// (v1-w_j1)/dv
+    cells[5*kt+2] = B[2*(j1 + Nv*r)];															// (v2-w_j2)/dv
+    cells[5*kt+3] = B[2*(j1 + Nv*(r + 2*Nv*Nv))];												// (v3-w_j3)/dv
+    cells[5*kt+4] = A[2*(2*Nv + j1)] + B[2*(j1 + Nv*(r + Nv*Nv))] + B[2*(j1 + Nv*(r + 3*Nv*Nv))];	// the square sum
+  }
 }
 
-void ProjectedNodeValue(fftw_complex *qHat, double *Q_incremental) // incremental of node values, projected from qHat to DG mesh
+void ProjectedNodeValue(CollisionContext *ctx, fftw_complex *qHat, double *Q_incremental) // incremental of node values, projected from qHat to DG mesh
 {
-    int m1,m2,m3,i,j,k,j1,j2,j3, kk,k_v,k_ft, k_eta;
-    double tp0, tp2, tp3, tp4, tp5, Q_re, Q_im, u0, u2, u3, u4, u5;
-    #pragma omp parallel for private(k_eta, k_ft, k_v, kk, j1,j2,j3,i,j,k,m1,m2,m3,tp0, tp2, tp3, tp4, tp5, Q_re, Q_im, u2, u3, u4, u5) shared(qHat,Q_incremental)
+    int m1,m2,m3,j1,j2,j3,k_v,k_ft;
+    double tp0, tp2, tp3, tp4, tp5, u0, u2, u3, u4, u5;
+    double *cells = ctx->proj_cells;
+
+    ProjectOntoCells(ctx, qHat, cells); // the integrals of qHat against the DG basis functions of every cell, computed once rather than for each node in the cell
+
+    #pragma omp parallel for private(k_ft, k_v, j1,j2,j3,m1,m2,m3,tp0, tp2, tp3, tp4, tp5, u0, u2, u3, u4, u5) shared(cells,Q_incremental)
     for(k_ft=0;k_ft<size_ft;k_ft++){
 	m3 = k_ft % N; m2 = ((k_ft-m3)/N) % N; m1 = (k_ft - m3 - N*m2)/(N*N);
 	j1 = m1*h_v/dv; if(j1==Nv)j1=Nv-1;
@@ -537,26 +548,7 @@ void ProjectedNodeValue(fftw_complex *qHat, double *Q_incremental) // incrementa
 	j3 = m3*h_v/dv; if(j3==Nv)j3=Nv-1; // determine in which element (j1,j2,j3) should this Fourier node (i,j,k) falls
 	
 	k_v = j1*Nv*Nv + j2*Nv + j3;
-	tp0=0.; tp2=0.; tp3=0.; tp4=0.; tp5=0.;
-	for(i=0;i<N;i++){
-	  for(j=0;j<N;j++){
-	    for(k=0;k<N;k++){
-	      k_eta = k + N*(j + N*i);
-		  //kk = k_v*size_ft+k_eta;
-		  IntModes(i,j,k,j1,j2,j3,IntM); //the global IntM must be declared as threadprivate
-		  
-		  Q_re = nu*qHat[k_eta][0];
-	      Q_im = nu*qHat[k_eta][1];
-		  //tem = scale3*wtN[i]*wtN[j]*wtN[k]*h_eta*h_eta*h_eta;
-		 tp0 += IntM[0]*Q_re - IntM[1]*Q_im;
-		  tp2 += IntM[1*2]*Q_re - IntM[1*2+1]*Q_im;
-		  tp3 += IntM[2*2]*Q_re - IntM[2*2+1]*Q_im;
-		  tp4 += IntM[3*2]*Q_re - IntM[3*2+1]*Q_im;
-		  tp5 += IntM[4*2]*Q_re - IntM[4*2+1]*Q_im;
-		  
-	    }
-	  }
-	}	      
+	tp0 = nu*cells[5*k_v]; tp2 = nu*cells[5*k_v+1]; tp3 = nu*cells[5*k_v+2]; tp4 = nu*cells[5*k_v+3]; tp5 = nu*cells[5*k_v+4];
 
 	u0 = (19*tp0/4. - 15*tp5)/scalev/scaleL/scale3;
 	u5 = (60*tp5 - 15*tp0)/scalev/scaleL/scale3;
@@ -566,731 +558,853 @@ void ProjectedNodeValue(fftw_complex *qHat, double *Q_incremental) // incrementa
     }
 }	
 
-#ifdef UseMPI
-
-#ifdef FullandLinear
-void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear)
+void convMonomials(int i, int j, int k, double *mono)											// function to store the 10 monomials in xi = ki(i,j,k) which multiply the coefficients stored by generate_conv_coeffs in mono
 {
-  int i, j, k, l, m, n, x, y, z;
-  int start_i, start_j, start_k, end_i, end_j, end_k;
-  //fftw_complex *fftIn, *fftOut;
-  double tempD, tempD1, tmp0, tmp1, tmp01, tmp11;
-  double prefactor = h_eta*h_eta*h_eta; // we dont have scale3 here.
+	mono[0] = 1.;
+	mono[1] = eta[i]; mono[2] = eta[j]; mono[3] = eta[k];
+	mono[4] = -eta[i]*eta[i]; mono[5] = -eta[j]*eta[j]; mono[6] = -eta[k]*eta[k];
+	mono[7] = -2.*eta[i]*eta[j]; mono[8] = -2.*eta[i]*eta[k]; mono[9] = -2.*eta[j]*eta[k];
+}
 
-  //fftIn = (fftw_complex *)fftw_malloc(N*N*N*sizeof(fftw_complex));
-  //fftOut = (fftw_complex *)fftw_malloc(N*N*N*sizeof(fftw_complex));
-  
-  for(i=0;i<size_ft;i++){
-    fftIn[i][0] = f[i];
-    fftIn[i][1] = 0.;
-  }
+/*
+function ComputeQ_MatrixFree
+----------------------------
+Computes the same quadrature for qHat as ComputeQ, given the FFT fHat of f, but with each convolution
+weight rebuilt inline from the 10 coefficients per omega stored in conv_coeffs (see generate_conv_coeffs)
+rather than read from conv_weights.  For each xi the 10 monomials (1, xi, -xi_p xi_q) are formed once, so
+that each weight is then a dot product of length 10 with coefficients that stay in cache.  If qHat_linear
+is not NULL, the linear two species part is also calculated (and added to qHat, as in the direct method).
+*/
+void ComputeQ_MatrixFree(fftw_complex *fHat, fftw_complex *qHat, fftw_complex *qHat_linear)
+{
+	int t, i, j, k, l, m, n, x, y, z, w, xw;														// declare t (the index of xi = ki(i,j,k)), (i,j,k) (the indices of xi), (l,m,n) (the indices of omega = eta(l,m,n)), (x,y,z) (the indices of eta(x,y,z) = xi - omega), w (the index of omega) & xw (the index of xi - omega)
+	int start_i, start_j, start_k, end_i, end_j, end_k;											// declare the bounds of the windows for the convolution, exactly as in ComputeQ
+	double mono[10], *c, G, G_lin, tmp0, tmp1, tmp01, tmp11;										// declare mono (the monomials in xi multiplying each coefficient), c (the coefficients for the current omega), G (the convolution weight times the quadrature weight), G_lin (the same for the linear weight), tmp0 & tmp1 (the real & imaginary parts of qHat) and tmp01 & tmp11 (the real & imaginary parts of qHat_linear)
 
-  fft3D(fftIn, fftOut);
-  
-  //printf("fft done\n");
-  #pragma omp parallel for private(j,k,l,m,n,x,y,z,start_i,start_j,start_k,end_i,end_j,end_k,tempD, tempD1,tmp0, tmp1) shared(qHat, qHat_linear, fftOut, conv_weights, conv_weights_linear)
-  for(i=0;i<N;i++) {
-    for(j=0;j<N;j++){
-      for(k=0;k<N;k++)
+	#pragma omp parallel for schedule(dynamic) private(t,i,j,k,l,m,n,x,y,z,w,xw,start_i,start_j,start_k,end_i,end_j,end_k,mono,c,G,G_lin,tmp0,tmp1,tmp01,tmp11) shared(fHat, qHat, qHat_linear, conv_coeffs)
+	for(t=0;t<size_ft;t++)
 	{
-	  //figure out the windows for the convolutions (i.e. where xi(l) and eta(i)-xi(l) are in the domain)
-	  if( i < N/2 ) {
-	    start_i = 0;
-	    end_i = i + N/2 + 1; 
-	  }
-	  else {
-	    start_i = i - N/2 + 1;
-	    end_i = N;
-	  }
-	  
-	  if( j < N/2 ) {
-	    start_j = 0;
-	    end_j = j + N/2 + 1; 
-	  }
-	  else {
-	    start_j = j - N/2 + 1;
-	    end_j = N;
-	  }
-	  
-	  if( k < N/2 ) {
-	    start_k = 0;
-	    end_k = k + N/2 + 1; 
-	  }
-	  else {
-	    start_k = k - N/2 + 1;
-	    end_k = N;
-	  }
-	  tmp0=0.; tmp1=0.; tmp01=0.; tmp11=0.;
-	  for(l=start_i;l<end_i;l++) {
-	    for(m=start_j;m<end_j;m++) {
-	      for(n=start_k;n<end_k;n++)
+		k = t % N;
+		j = (t/N) % N;
+		i = t/(N*N);
+
+		// the windows for the convolution (i.e. where eta(l,m,n) and ki(i,j,k)-eta(l,m,n) are both in the domain):
+		if(i < N/2) { start_i = 0; end_i = i + N/2 + 1; } else { start_i = i - N/2 + 1; end_i = N; }
+		if(j < N/2) { start_j = 0; end_j = j + N/2 + 1; } else { start_j = j - N/2 + 1; end_j = N; }
+		if(k < N/2) { start_k = 0; end_k = k + N/2 + 1; } else { start_k = k - N/2 + 1; end_k = N; }
+
+		convMonomials(i, j, k, mono);																// the monomials in xi = ki(i,j,k) which multiply each of the coefficients
+
+		tmp0 = 0.; tmp1 = 0.; tmp01 = 0.; tmp11 = 0.;
+		for(l=start_i;l<end_i;l++)
 		{
-		
-		  x = i + N/2 - l;
-		  y = j + N/2 - m;
-		  z = k + N/2 - n;
-		  //printf("%d, %d, %d; %d, %d, %d\n",i,j,k,l,m,n);
-		 // printf("tempD=%g\n",conv_weights[k + N*(j+ N*i)][n + N*(m + N*l)]);
-		  //get convolution weight		   
-		  tempD = conv_weights[k + N*(j+ N*i)][n + N*(m + N*l)];
-		  tempD1 = conv_weights_linear[k + N*(j+ N*i)][n + N*(m + N*l)];		  
-		//  printf(" tempD=%g, prefactor=%g, fftOut=[%g,%g] at %d, %d, %d; %d, %d, %d; %d, %d, %d\n",tempD, prefactor, fftOut[z + N*(y + N*x)][0], fftOut[z + N*(y + N*x)][1],i,j,k,l,m,n, x,y,z);
-		  tmp0 += prefactor*wtN[l]*wtN[m]*wtN[n]*(tempD*(fftOut[n + N*(m + N*l)][0]*fftOut[z + N*(y + N*x)][0] - fftOut[n + N*(m + N*l)][1]*fftOut[z + N*(y + N*x)][1]) + scale3*tempD1*fftOut[z + N*(y + N*x)][0]);
-		  tmp1 += prefactor*wtN[l]*wtN[m]*wtN[n]*(tempD*(fftOut[n + N*(m + N*l)][0]*fftOut[z + N*(y + N*x)][1] + fftOut[n + N*(m + N*l)][1]*fftOut[z + N*(y + N*x)][0]) + scale3*tempD1*fftOut[z + N*(y + N*x)][1]);
-		  
-		  tmp01 += prefactor*wtN[l]*wtN[m]*wtN[n]*scale3*tempD1*fftOut[z + N*(y + N*x)][0];
-		  tmp11 += prefactor*wtN[l]*wtN[m]*wtN[n]*scale3*tempD1*fftOut[z + N*(y + N*x)][1];
-		 
+			for(m=start_j;m<end_j;m++)
+			{
+				for(n=start_k;n<end_k;n++)
+				{
+					x = i + N/2 - l;
+					y = j + N/2 - m;
+					z = k + N/2 - n;
+					w = n + N*(m + N*l);
+					xw = z + N*(y + N*x);
+					c = &conv_coeffs[10*w];
+
+					G_lin = c[4]*mono[4] + c[5]*mono[5] + c[6]*mono[6] + c[7]*mono[7] + c[8]*mono[8] + c[9]*mono[9];	// the part of the weight quadratic in xi (shared by both weights)
+					G = c[0] + c[1]*mono[1] + c[2]*mono[2] + c[3]*mono[3] + G_lin;						// gHat3(xi, omega) times the quadrature weight
+					tmp0 += G*(fHat[w][0]*fHat[xw][0] - fHat[w][1]*fHat[xw][1]);
+					tmp1 += G*(fHat[w][0]*fHat[xw][1] + fHat[w][1]*fHat[xw][0]);
+
+					if(qHat_linear != NULL)
+					{
+						G_lin += 0.5*(c[1]*mono[1] + c[2]*mono[2] + c[3]*mono[3]);						// gHat3_linear(xi, omega) times the quadrature weight
+						tmp01 += scale3*G_lin*fHat[xw][0];
+						tmp11 += scale3*G_lin*fHat[xw][1];
+					}
+				}
+			}
+		}
+		qHat[t][0] = tmp0 + tmp01;
+		qHat[t][1] = tmp1 + tmp11;
+		if(qHat_linear != NULL)
+		{
+			qHat_linear[t][0] = tmp01;
+			qHat_linear[t][1] = tmp11;
 		}
-	    }
-	  }
-	// printf("%d, %d, %d done\n", i,j,k);
-	 qHat[k + N*(j + N*i)][0] = tmp0;  
-	 qHat[k + N*(j + N*i)][1] = tmp1;
-	 qHat_linear[k + N*(j + N*i)][0] = tmp01;  
-	 qHat_linear[k + N*(j + N*i)][1] = tmp11;
 	}
-    }
-  }
-
 }
 
-void RK4(double *f, int l, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear, double *U, double *dU) //4-th RK. yn=yn+(3*k1+k2+k3+k4)/6 
+/*
+function ComputeQ_FFT
+---------------------
+Computes the same quadrature for qHat as ComputeQ, given the FFT fHat of f, using FFTs.  Since each weight
+is sum_p c_p(omega)*mono_p(xi) (see generate_conv_coeffs & convMonomials) and the window of the quadrature
+is exactly where both eta(l,m,n) & ki(i,j,k) - eta(l,m,n) are on the grid, qHat is
+	qHat(i,j,k) = sum_p mono_p(ki(i,j,k)) * (A_p * fHat)(i+N/2, j+N/2, k+N/2),		with A_p = c_p*fHat,
+where * is the linear convolution of the two N^3 arrays.  Each of these 10 convolutions is calculated
+exactly by padding the arrays with zeros to (2N)^3, so that the cost is O(N^3 log N) rather than O(N^6).
+If qHat_linear is not NULL, the 9 convolutions of the linear weights (A_p = scale3*c_p, halved for the
+terms linear in xi) with fHat are also calculated and added to qHat, as in the direct method.  The padded
+arrays are those of the CollisionContext ctx.
+*/
+void ComputeQ_FFT(CollisionContext *ctx, fftw_complex *fHat, fftw_complex *qHat, fftw_complex *qHat_linear)
 {
-int i,j,k, j1, j2, j3, k_v, k_eta, kk, l_local;  
-  double Q_re, Q_im, tp0, tp2, tp3,tp4,tp5, tmp0=0., tmp2=0., tmp3=0., tmp4=0.,tmp5=0., tem;
+	int t, s, i, j, k, p, term, n_terms, linear;													// declare t (the index of a point on the N^3 grid), s (the index of a point on the padded (2N)^3 grid), (i,j,k) (the indices of t), p (the index of the coefficient & monomial), term (a counter for the convolutions), n_terms (the number of convolutions needed) & linear (whether the current convolution is for the linear weights)
+	int N2 = 2*N, size_pad = N2*N2*N2;																// declare N2 (the number of points in each direction of the padded grid) & size_pad (the total number of points on the padded grid)
+	double mono[10], c, lin_wt, re, im;																// declare mono (the monomials in xi), c (the current coefficient), lin_wt (the factor for the linear weights) and re & im (the real & imaginary parts of the current product)
+	double norm = 1./size_pad;																		// declare norm (the normalisation of the inverse FFT, which fftw3 leaves out) and set its value
+	fftw_complex *fHat_pad = ctx->fHat_pad, *conv_pad = ctx->conv_pad;								// declare fHat_pad & conv_pad (the padded FFT of f & the padded array being convolved with it, from ctx)
+
+	// PAD fHat WITH ZEROS AND TAKE ITS FFT (WHICH IS THE SAME FOR EVERY CONVOLUTION):
+	#pragma omp parallel for private(s) shared(fHat_pad)
+	for(s=0;s<size_pad;s++)
+	{
+		fHat_pad[s][0] = 0.; fHat_pad[s][1] = 0.;
+	}
+	#pragma omp parallel for private(t,s,i,j,k) shared(fHat, fHat_pad)
+	for(t=0;t<size_ft;t++)
+	{
+		k = t % N; j = (t/N) % N; i = t/(N*N);
+		s = k + N2*(j + N2*i);
+		fHat_pad[s][0] = fHat[t][0]; fHat_pad[s][1] = fHat[t][1];
+	}
+	fftw_execute_dft(p_forward_pad, fHat_pad, fHat_pad);
 
-  l_local = l%chunk_Nx;
-  
-  #pragma omp parallel for private(i) shared(qHat, qHat_linear)
-  for(i=0;i<size_ft;i++){
-    qHat[i][0] += qHat_linear[i][0];
-	qHat[i][1] += qHat_linear[i][1];
-  }
-  FS(qHat, fftOut); 
+	#pragma omp parallel for private(t) shared(qHat, qHat_linear)
+	for(t=0;t<size_ft;t++)
+	{
+		qHat[t][0] = 0.; qHat[t][1] = 0.;
+		if(qHat_linear != NULL)
+		{
+			qHat_linear[t][0] = 0.; qHat_linear[t][1] = 0.;
+		}
+	}
 
-  #pragma omp parallel for private(i) shared(Q,fftOut,f1,f)
-  for(i=0;i<size_ft;i++){    
-    Q[i] = fftOut[i][0];
-    f1[i] = f[i] + dt*Q[i]*nu; //BUG: this evolution (only on node values) is not consistent with our conservation routine, which preserves the exact moments of the {1,v,|v|^{2}} approximations
-  }
+	n_terms = (qHat_linear != NULL) ? 19 : 10;														// the 10 convolutions for the full weights, followed by 9 for the linear weights (which have no constant term) if needed
+	for(term=0;term<n_terms;term++)
+	{
+		linear = (term >= 10);
+		p = linear ? term - 9 : term;
+		lin_wt = (p < 4) ? 0.5*scale3 : scale3;														// gHat3_linear only has half of the terms linear in xi from gHat3
 
-  ComputeQ(f1, Q1_fft, conv_weights, Q1_fft_linear, conv_weights_linear);
-  conserveAllMoments(Q1_fft, Q1_fft_linear);   	//conserves k2	
-  
-  #pragma omp parallel for private(i) shared(Q1_fft, Q1_fft_linear)
-  for(i=0;i<size_ft;i++){
-    Q1_fft[i][0] += Q1_fft_linear[i][0];
-	Q1_fft[i][1] += Q1_fft_linear[i][1];
-  }
-  
-  FS(Q1_fft, fftOut);
+		// SET conv_pad TO THE PADDED A_p:
+		#pragma omp parallel for private(s) shared(conv_pad)
+		for(s=0;s<size_pad;s++)
+		{
+			conv_pad[s][0] = 0.; conv_pad[s][1] = 0.;
+		}
+		#pragma omp parallel for private(t,s,i,j,k,c) shared(fHat, conv_pad, conv_coeffs)
+		for(t=0;t<size_ft;t++)
+		{
+			k = t % N; j = (t/N) % N; i = t/(N*N);
+			s = k + N2*(j + N2*i);
+			c = conv_coeffs[10*t + p];
+			if(linear)
+			{
+				conv_pad[s][0] = lin_wt*c;
+			}
+			else
+			{
+				conv_pad[s][0] = c*fHat[t][0]; conv_pad[s][1] = c*fHat[t][1];
+			}
+		}
 
-  #pragma omp parallel for private(i) shared(Q,Q1,fftOut,f1,f)
-  for(i=0;i<size_ft;i++){ 	
-    Q1[i] = fftOut[i][0];	   
-    f1[i] = f[i] +  0.5*dt*Q[i]*nu + 0.5*dt*Q1[i]*nu;
-  }
- 
-  ComputeQ(f1, Q2_fft, conv_weights, Q2_fft_linear, conv_weights_linear);
-  conserveAllMoments(Q2_fft, Q2_fft_linear);   //conserves k3
+		// CONVOLVE A_p WITH fHat BY MULTIPLYING THEIR FFTS:
+		fftw_execute_dft(p_forward_pad, conv_pad, conv_pad);
+		#pragma omp parallel for private(s,re,im) shared(conv_pad, fHat_pad)
+		for(s=0;s<size_pad;s++)
+		{
+			re = conv_pad[s][0]*fHat_pad[s][0] - conv_pad[s][1]*fHat_pad[s][1];
+			im = conv_pad[s][0]*fHat_pad[s][1] + conv_pad[s][1]*fHat_pad[s][0];
+			conv_pad[s][0] = re; conv_pad[s][1] = im;
+		}
+		fftw_execute_dft(p_backward_pad, conv_pad, conv_pad);
 
-  #pragma omp parallel for private(i) shared(Q2_fft, Q2_fft_linear)
-  for(i=0;i<size_ft;i++){
-    Q2_fft[i][0] += Q2_fft_linear[i][0];
-	Q2_fft[i][1] += Q2_fft_linear[i][1];
-  }
-  FS(Q2_fft, fftOut);
-  //ifft3D(Q2_fft, fftOut);
-  #pragma omp parallel for private(i) shared(Q,Q1,fftOut,f1,f)
-  for(i=0;i<size_ft;i++){	
-    Q1[i] = fftOut[i][0];	 
-    f1[i] = f[i] + 0.5*dt*Q[i]*nu + 0.5*dt*Q1[i]*nu;
-  }
+		// ADD mono_p(xi) TIMES THE CONVOLUTION AT xi TO qHat:
+		#pragma omp parallel for private(t,s,i,j,k,mono,re,im) shared(qHat, qHat_linear, conv_pad)
+		for(t=0;t<size_ft;t++)
+		{
+			k = t % N; j = (t/N) % N; i = t/(N*N);
+			s = (k + N/2) + N2*((j + N/2) + N2*(i + N/2));											// the index of eta(l,m,n) + eta(x,y,z) for x = i + N/2 - l, etc.
+			convMonomials(i, j, k, mono);
+			re = norm*mono[p]*conv_pad[s][0];
+			im = norm*mono[p]*conv_pad[s][1];
+			qHat[t][0] += re; qHat[t][1] += im;
+			if(linear)
+			{
+				qHat_linear[t][0] += re; qHat_linear[t][1] += im;
+			}
+		}
+	}
+}
 
-  ComputeQ(f1, Q3_fft, conv_weights, Q3_fft_linear, conv_weights_linear);
-  conserveAllMoments(Q3_fft, Q3_fft_linear);                //conserves k4
+/*
+function ComputeQ_Symmetric
+---------------------------
+Computes the same quadrature for qHat as ComputeQ, given the FFT fHat of f, but with each convolution
+weight read from the table compressed by the symmetries of the weights in conv_weights_sym (see
+WeightSymmetry.cpp) rather than from conv_weights.  For each xi, the row of its orbit and the images of
+omega under the symmetry taking xi to its representative give the weight, so only about size_ft/48 rows
+are stored.  If qHat_linear is not NULL, the linear two species part is also calculated (and added to
+qHat, as in the direct method) from the compressed linear weights.
+*/
+void ComputeQ_Symmetric(fftw_complex *fHat, fftw_complex *qHat, fftw_complex *qHat_linear)
+{
+	int t, i, j, k, l, m, n, x, y, z, w, xw;														// declare t (the index of xi = ki(i,j,k)), (i,j,k) (the indices of xi), (l,m,n) (the indices of omega = eta(l,m,n)), (x,y,z) (the indices of eta(x,y,z) = xi - omega), w (the index of omega) & xw (the index of xi - omega)
+	int start_i, start_j, start_k, end_i, end_j, end_k;											// declare the bounds of the windows for the convolution, exactly as in ComputeQ
+	int *omega_map;																					// declare omega_map (the images of each omega under the symmetry for the current xi)
+	double *row, *row_linear, pw, G, G_lin, tmp0, tmp1, tmp01, tmp11;								// declare row & row_linear (the compressed weights for the orbit of the current xi), pw (the quadrature weight), G & G_lin (the convolution weights times the quadrature weight), tmp0 & tmp1 (the real & imaginary parts of qHat) and tmp01 & tmp11 (the real & imaginary parts of qHat_linear)
+	double prefactor = h_eta*h_eta*h_eta;															// declare prefactor (the value of h_eta^3, as no scale3 in Fourier space) and set its value
+
+	#pragma omp parallel for schedule(dynamic) private(t,i,j,k,l,m,n,x,y,z,w,xw,start_i,start_j,start_k,end_i,end_j,end_k,omega_map,row,row_linear,pw,G,G_lin,tmp0,tmp1,tmp01,tmp11) shared(fHat, qHat, qHat_linear, conv_weights_sym)
+	for(t=0;t<size_ft;t++)
+	{
+		k = t % N;
+		j = (t/N) % N;
+		i = t/(N*N);
 
-  #pragma omp parallel for private(i) shared(Q3_fft, Q3_fft_linear)
-  for(i=0;i<size_ft;i++){
-    Q3_fft[i][0] += Q3_fft_linear[i][0];
-	Q3_fft[i][1] += Q3_fft_linear[i][1];
-  }
-  #pragma omp parallel for schedule(dynamic) private(j1,j2,j3,i,j,k,k_v,k_eta,Q_re, Q_im, tp0, tp2,tp3,tp4, tp5) shared(l,l_local,qHat,U, dU) //reduction(+: tmp0, tmp2, tmp3, tmp4, tmp5)
-  for(int kt=0;kt<size_v;kt++){
-    j3 = kt % Nv; j2 = ((kt-j3)/Nv) % Nv; j1 = (kt - j3 - Nv*j2)/(Nv*Nv);
-    tp0=0.; tp2=0.; tp3=0.; tp4=0.; tp5=0.;
-    for(i=0;i<N;i++){
-      for(j=0;j<N;j++){
-		for(k=0;k<N;k++){
-		  k_eta = k + N*(j + N*i);
+		// the windows for the convolution (i.e. where eta(l,m,n) and ki(i,j,k)-eta(l,m,n) are both in the domain):
+		if(i < N/2) { start_i = 0; end_i = i + N/2 + 1; } else { start_i = i - N/2 + 1; end_i = N; }
+		if(j < N/2) { start_j = 0; end_j = j + N/2 + 1; } else { start_j = j - N/2 + 1; end_j = N; }
+		if(k < N/2) { start_k = 0; end_k = k + N/2 + 1; } else { start_k = k - N/2 + 1; end_k = N; }
 
-		  IntModes(i,j,k,j1,j2,j3,IntM); //the global IntM must be declared as threadprivate; BUG: forgot to uncomment this and thus IntM=0 !!
-		  
-		  Q_re = nu*(0.5*qHat[k_eta][0] + (Q1_fft[k_eta][0]+Q2_fft[k_eta][0]+Q3_fft[k_eta][0])/6.);
-		  Q_im = nu*(0.5*qHat[k_eta][1] + (Q1_fft[k_eta][1]+Q2_fft[k_eta][1]+Q3_fft[k_eta][1])/6.);
-		  
-		  //tem = scale3*wtN[i]*wtN[j]*wtN[k]*h_eta*h_eta*h_eta;
-		  tp0 += IntM[0]*Q_re - IntM[1]*Q_im;
-		  tp2 += IntM[1*2]*Q_re - IntM[1*2+1]*Q_im;
-		  tp3 += IntM[2*2]*Q_re - IntM[2*2+1]*Q_im;
-		  tp4 += IntM[3*2]*Q_re - IntM[3*2+1]*Q_im;
-		  tp5 += IntM[4*2]*Q_re - IntM[4*2+1]*Q_im;
+		omega_map = &conv_weights_sym.omega[conv_weights_sym.op[t]*size_ft];						// where each omega is taken by the symmetry taking xi to the representative of its orbit
+		row = &conv_weights_sym.weights[(size_t)conv_weights_sym.row[t]*conv_weights_sym.size_ext];
+		row_linear = (qHat_linear != NULL) ? &conv_weights_sym.weights_linear[(size_t)conv_weights_sym.row[t]*conv_weights_sym.size_ext] : NULL;
+
+		tmp0 = 0.; tmp1 = 0.; tmp01 = 0.; tmp11 = 0.;
+		for(l=start_i;l<end_i;l++)
+		{
+			for(m=start_j;m<end_j;m++)
+			{
+				for(n=start_k;n<end_k;n++)
+				{
+					x = i + N/2 - l;
+					y = j + N/2 - m;
+					z = k + N/2 - n;
+					w = n + N*(m + N*l);
+					xw = z + N*(y + N*x);
+					pw = prefactor*wtN[l]*wtN[m]*wtN[n];
+
+					G = pw*row[omega_map[w]];															// gHat3(xi, omega) = gHat3(g xi, g omega) times the quadrature weight
+					tmp0 += G*(fHat[w][0]*fHat[xw][0] - fHat[w][1]*fHat[xw][1]);
+					tmp1 += G*(fHat[w][0]*fHat[xw][1] + fHat[w][1]*fHat[xw][0]);
+
+					if(qHat_linear != NULL)
+					{
+						G_lin = pw*row_linear[omega_map[w]];											// gHat3_linear(xi, omega) times the quadrature weight
+						tmp01 += scale3*G_lin*fHat[xw][0];
+						tmp11 += scale3*G_lin*fHat[xw][1];
+					}
+				}
+			}
 		}
-      }
-    }	     
-    //tmp0 += tp0; tmp2 += dv*tp2 + Gridv((double)j1)*tp0; tmp3 += dv*tp3 +Gridv((double)j2)*tp0 ;tmp4 += dv*tp4 + Gridv((double)j3)*tp0;  //tmp5 += (Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3))*tp0 +dv*dv*tp5+2*dv*(Gridv((double)j1)*tp2 + Gridv((double)j2)*tp3 +Gridv((double)j3)*tp4);     
-	//tmp5 += dv*dv*tp5 -  (Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3))*tp0 + 2*(Gridv((double)j1)*(dv*tp2 + Gridv((double)j1)*tp0) + Gridv((double)j2)*(dv*tp3 + Gridv((double)j2)*tp0) + Gridv((double)j3)*(dv*tp4 + Gridv((double)j3)*tp0));
-	  
-    k_v = l*size_v + kt;      
-    tp0 = U[k_v*6+0] + U[k_v*6+5]/4. + dt*tp0/scalev/scaleL/scale3;
-    tp2 = U[k_v*6+2] + dt*tp2*12./scalev/scaleL/scale3;
-    tp3 = U[k_v*6+3] + dt*tp3*12./scalev/scaleL/scale3;
-    tp4 = U[k_v*6+4] + dt*tp4*12./scalev/scaleL/scale3;
-    tp5 = U[k_v*6+0]/4. + U[k_v*6+5]*19./240. + dt*tp5/scalev/scaleL/scale3;
-
-    dU[(l_local*size_v + kt)*5] = 19*tp0/4. - 15*tp5;
-    dU[(l_local*size_v + kt)*5+4] = 60*tp5 - 15*tp0;
-    dU[(l_local*size_v + kt)*5+1] = tp2;
-    dU[(l_local*size_v + kt)*5+2] = tp3;
-    dU[(l_local*size_v + kt)*5+3] = tp4;   
-  }
+		qHat[t][0] = tmp0 + tmp01;
+		qHat[t][1] = tmp1 + tmp11;
+		if(qHat_linear != NULL)
+		{
+			qHat_linear[t][0] = tmp01;
+			qHat_linear[t][1] = tmp11;
+		}
+	}
 }
-#else
-void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights)
+
+/*
+function ComputeQ_WithMethod
+----------------------------
+Calculates qHat (and qHat_linear, if it is not NULL) from the FFT fHat of f with the method stored in
+QMethod, for all of the methods which don't read conv_weights (i.e. all except QDirect, which is
+calculated inside ComputeQ & ComputeQ_Batch), using the work arrays in ctx.
+*/
+void ComputeQ_WithMethod(CollisionContext *ctx, fftw_complex *fHat, fftw_complex *qHat, fftw_complex *qHat_linear)
 {
-	int i, j, k, l, m, n, x, y, z;												// declare (i,j,k) (the indices for a given value of given ki = ki_(i,j,k)), (l,m,n) (counters for the quadrature to calculate the integral w.r.t. eta in the evaluation of qHat and so also represent the indices of a given eta = eta_(l,m,n)) & (x,y,z) (the indices for the value of a subtraction in the calculation, namely eta_(x,y,z) = ki_(i,j,k) - eta_(l,m,n))
-	int start_i, start_j, start_k, end_i, end_j, end_k;							// declare start_i, start_j & start_k (the indices for the values of the lower bounds of integration in computation of the convolution, corresponding to the lowest point where both functions are non-zero, in each velocity direction) and end_i, end_j & end_k (the indices for the values of the upper bounds of integration in computation of the convolution, corresponding to the highest point where both functions are non-zero, in each velocity direction)
-	double tempD, tmp0, tmp1;													// declare tempD (the value of the convolution weight at a given ki & eta), tmp0 (which will become the real part of qHat) & tmp1 (which will become the imaginary part of qHat)
-	double prefactor = h_eta*h_eta*h_eta; 										// declare prefactor (the value of h_eta^3, as no scale3 in Fourier space) and set its value
-  
-	for(i=0;i<size_ft;i++)														// initialise the input of the FFT
+	switch(QMethod)
 	{
-		fftIn[i][0] = f[i];														// set the real part to the sampling of the solution stored in f
-		fftIn[i][1] = 0.;														// set the imaginary part to zero
+		case QFFT:			ComputeQ_FFT(ctx, fHat, qHat, qHat_linear);		break;			// calculate the convolutions with FFTs
+		case QSymmetric:	ComputeQ_Symmetric(fHat, qHat, qHat_linear);	break;			// read the weights from the compressed table
+		default:			ComputeQ_MatrixFree(fHat, qHat, qHat_linear);	break;			// rebuild the weights from conv_coeffs
 	}
+}
 
-	fft3D(fftIn, fftOut);														// perform the FFT of fftIn and store the result in fftOut
-  
-	//printf("fft done\n");
-	#pragma omp parallel for schedule(dynamic) private(i,j,k,l,m,n,x,y,z,start_i,start_j,start_k,end_i,end_j,end_k,tempD) shared(qHat, fftOut, conv_weights) reduction(+:tmp0, tmp1)
-	for(i=0;i<N;i++) 															// loop through all points in the ki_1
+void convWindow(int i, int *start, int *end)													// function to store the window of the convolution for the index i of xi in one direction (i.e. where eta(l) and ki(i)-eta(l) are both in the domain, for start <= l < end)
+{
+	if(i < N/2) { *start = 0; *end = i + N/2 + 1; } else { *start = i - N/2 + 1; *end = N; }
+}
+
+void mirrorWeights(int i, double *wt_mirror, int *unpaired)										// function to store, for the index i of xi in one direction, the trapezoidal weight wt_mirror[l] which the term l of the convolution for xi carries in the convolution for -xi (with index N-i, where it appears as the term N-l) or 0 if it doesn't appear there, and unpaired[l] = 1 for the terms l of the convolution for -xi which have no partner in the convolution for xi
+{
+	int l, start, end, start_m, end_m;																// declare l (a counter for the terms), start & end (the window for i) and start_m & end_m (the window for N-i)
+
+	convWindow(i, &start, &end);
+	convWindow(N-i, &start_m, &end_m);
+	for(l=0;l<N;l++)
+	{
+		wt_mirror[l] = 0.;
+		unpaired[l] = 0;
+	}
+	for(l=start;l<end;l++)
+	{
+		if(l >= 1 && N-l >= start_m && N-l < end_m)
+		{
+			wt_mirror[l] = wtN[N-l];																// the trapezoidal weights are not symmetric (wtN[1] = 1 but wtN[N-1] = 0.5), so the weight is taken from the mirrored term
+		}
+	}
+	for(l=start_m;l<end_m;l++)
+	{
+		if(l == 0 || N-l < start || N-l >= end)
+		{
+			unpaired[l] = 1;																		// eta(0) = -L_eta has no reflection on the grid, and neither does the term with ki(N-i)-eta(l) = eta(0)
+		}
+	}
+}
+
+/*
+function directModePair
+-----------------------
+Computes the direct quadrature for the mode t of xi = ki(i,j,k) (and, if it has a partner, for the mode of -xi
+with indices N-i, N-j, N-k) for each of the n_cells FFTs fHat[b], storing the results in qHat[b] (and in
+qHat_linear[b] if Linear is 1, when the linear two species part is also added to qHat[b]).  The loop over
+the cells is inside the loop over the terms of the convolution, so that each weight in conv_weights (and
+conv_weights_linear) is loaded once for the whole batch.  Since f is real, fHat(-xi) = conj(fHat(xi)), and
+the weights satisfy gHat3(-xi, -omega) = gHat3(xi, omega), so each term of the convolution for xi is the
+complex conjugate of a term of the convolution for -xi: the two modes are calculated together, the mirrored
+terms carrying their own trapezoidal weights (see mirrorWeights), and the terms for -xi with no partner (only
+O(N^2) of them) are added separately.  The work arrays are wm_i (3N doubles), unp_i (4N ints) & acc (8*n_cells
+doubles), which are private to the calling thread.  Linear is a template parameter so that the test for the
+linear part is made once, outside of all of the loops.
+*/
+template <int Linear>
+static void directModePair(int t, int n_cells, fftw_complex **fHat, fftw_complex **qHat, double **conv_weights, fftw_complex **qHat_linear, double **conv_weights_linear, double *wm_i, int *unp_i, double *acc)
+{
+	int tm, i, j, k, l, m, n, x, y, z, w, xw, paired, n_list, p, b;								// declare tm (the index of -xi), (i,j,k) (the indices of xi), (l,m,n) (the indices of omega = eta(l,m,n)), (x,y,z) (the indices of eta(x,y,z) = xi - omega), w (the index of omega), xw (the index of xi - omega), paired (whether xi is calculated with -xi), n_list (the number of unpaired terms in the third direction), p (a counter for them) & b (the index of the cell)
+	int start_i, start_j, start_k, end_i, end_j, end_k;											// declare the bounds of the windows for the convolution, exactly as in ComputeQ
+	int *unp_j = unp_i + N, *unp_k = unp_j + N, *list_k = unp_k + N;								// declare unp_i, unp_j & unp_k (the unpaired terms for -xi in each direction) & list_k (the indices of the unpaired terms in the third direction)
+	double *wm_j = wm_i + N, *wm_k = wm_j + N;														// declare wm_i, wm_j & wm_k (the trapezoidal weights of each term in the convolution for -xi, in each direction)
+	double G, G_lin, pw, pwm, re, im, *a;															// declare G & G_lin (the convolution weights), pw & pwm (the quadrature weights of a term for xi & -xi), re & im (the product of fHat(omega) & fHat(xi - omega)) & a (the sums of the cell b: a[0] & a[1] for qHat and a[2] & a[3] for qHat_linear at xi, a[4] to a[7] the same at -xi)
+	double prefactor = h_eta*h_eta*h_eta;															// declare prefactor (the value of h_eta^3, as no scale3 in Fourier space) and set its value
+
+	k = t % N;
+	j = (t/N) % N;
+	i = t/(N*N);
+	tm = (N-k)%N + N*((N-j)%N + N*((N-i)%N));
+	paired = (i > 0 && j > 0 && k > 0 && tm != t);
+
+	convWindow(i, &start_i, &end_i);
+	convWindow(j, &start_j, &end_j);
+	convWindow(k, &start_k, &end_k);
+	if(paired)
+	{
+		mirrorWeights(i, wm_i, unp_i);
+		mirrorWeights(j, wm_j, unp_j);
+		mirrorWeights(k, wm_k, unp_k);
+	}
+	else
+	{
+		for(l=0;l<N;l++)
+		{
+			wm_i[l] = 0.; wm_j[l] = 0.; wm_k[l] = 0.;												// no terms are shared with another mode
+		}
+	}
+
+	for(b=0;b<8*n_cells;b++)
 	{
-		for(j=0;j<N;j++)														// loop through all points in the ki_2
+		acc[b] = 0.;
+	}
+	for(l=start_i;l<end_i;l++)
+	{
+		for(m=start_j;m<end_j;m++)
 		{
-			for(k=0;k<N;k++)													// loop through all points in the ki_3
+			for(n=start_k;n<end_k;n++)
 			{
-				//figure out the windows for the convolutions (i.e. where eta(l,m,n) and ki(i,j,k)-eta(l,m,n) are in the domain)
-				if( i < N/2 ) 													// if ki_1(i) < 0 then the values of l for which f(ki_1(i)-eta_1(l))*f(eta_1(l)) give a non-zero product range need -Lv < eta_1 <= ki_1 + Lv/2, due to the support of f being -Lv to Lv
-				{
-					start_i = 0;												// set start_i to 0 to represent -Lv as the lower bound of integration
-					end_i = i + N/2 + 1;										// set end_i to i + N/2 + 1 to represent eta_1(i+N/2+1/2) as the upper bound of integration (with +1 there so that all cells less than index end_i are integrated over)
-				}
-				else 															// if ki_1(i) >= 0 then the values of l for which f(ki_1(i)-eta_1(l))*f(eta_1(l)) give a non-zero product range need ki_1 - Lv/2 < eta_1 <= Lv, due to the support of f being -Lv to Lv
-				{
-					start_i = i - N/2 + 1;										// set start_i to i - N/2 + 1 to represent eta_1(i) - Lv as the lower bound of integration (with +1 since ki_1[i-N/2] - eta_1[i] actually overlaps with eta_1[-1/2] = -Lv, where f(-Lv)=0, so start at the next index)
-					end_i = N;													// set end_i to N to represent Lv as the upper bound of integration (i.e. integrate over all cells with index less than N)
-				}
-	  
-				if( j < N/2 )													// if ki_2(j) < 0 then the values of m for which f(ki_2(j)-eta_2(m))*f(eta_2(m)) give a non-zero product range need -Lv < eta_2 <= ki_2 + Lv/2, due to the support of f being -Lv to Lv
-				{
-					start_j = 0;												// set start_j to 0 to represent -Lv as the lower bound of integration
-					end_j = j + N/2 + 1;										// set end_j to j + N/2 + 1 to represent eta_2(j+N/2+1/2) as the upper bound of integration (with +1 there so that all cells less than index end_i are integrated over)
-				}
-				else															// if ki_2(j) >= 0 then the values of m for which f(ki_2(j)-eta_2(m))*f(eta_2(m)) give a non-zero product range need ki_2 - Lv/2 < eta_2 <= Lv, due to the support of f being -Lv to Lv
+				x = i + N/2 - l;
+				y = j + N/2 - m;
+				z = k + N/2 - n;
+				w = n + N*(m + N*l);
+				xw = z + N*(y + N*x);
+				pw = prefactor*wtN[l]*wtN[m]*wtN[n];
+				pwm = prefactor*wm_i[l]*wm_j[m]*wm_k[n];
+
+				G = conv_weights[t][w];																// loaded once for all of the cells in the batch
+				if(Linear) G_lin = scale3*conv_weights_linear[t][w];
+				for(b=0;b<n_cells;b++)
 				{
-					start_j = j - N/2 + 1;										// set start_j to j - N/2 + 1 to represent eta_2(j) - Lv as the lower bound of integration (with +1 since ki_2[j-N/2] - eta_2[j] actually overlaps with eta_2[-1/2] = -Lv, where f(-Lv)=0, so start at the next index)
-					end_j = N;													// set end_j to N to represent Lv as the upper bound of integration (i.e. integrate over all cells with index less than N)
-				}
-	  
-				if( k < N/2 )													// if ki_3(k) < 0 then the values of n for which f(ki_3(k)-eta_3(n))*f(eta_3(n)) give a non-zero product range need -Lv < eta_3 <= ki_3 + Lv/2, due to the support of f being -Lv to Lv
-				{
-					start_k = 0;												// set start_k to 0 to represent -Lv as the lower bound of integration
-					end_k = k + N/2 + 1;										// set end_k to k + N/2 + 1 to represent eta_3(k+N/2+1/2) as the upper bound of integration (with +1 there so that all cells less than index end_i are integrated over)
-				}
-				else															// if ki_3(k) >= 0 then the values of n for which f(ki_3(k)-eta_3(n))*f(eta_3(n)) give a non-zero product range need ki_3 - Lv/2 < eta_3 <= Lv, due to the support of f being -Lv to Lv
-				{
-					start_k = k - N/2 + 1;										// set start_k to k - N/2 + 1 to represent eta_3(k) - Lv as the lower bound of integration (with +1 since ki_3[k-N/2] - eta_3[k] actually overlaps with eta_3[-1/2] = -Lv, where f(-Lv)=0, so start at the next index)
-					end_k = N;													// set end_k to N to represent Lv as the upper bound of integration (i.e. integrate over all cells with index less than N)
+					a = &acc[8*b];
+					re = fHat[b][w][0]*fHat[b][xw][0] - fHat[b][w][1]*fHat[b][xw][1];
+					im = fHat[b][w][0]*fHat[b][xw][1] + fHat[b][w][1]*fHat[b][xw][0];
+					a[0] += pw*G*re;
+					a[1] += pw*G*im;
+					a[4] += pwm*G*re;
+					a[5] += pwm*G*im;
+					if(Linear)
+					{
+						a[2] += pw*G_lin*fHat[b][xw][0];
+						a[3] += pw*G_lin*fHat[b][xw][1];
+						a[6] += pwm*G_lin*fHat[b][xw][0];
+						a[7] += pwm*G_lin*fHat[b][xw][1];
+					}
 				}
-				tmp0=0.; tmp1=0.;												// initialise tmp0 & tmp1 at zero to begin the quadrature
-				for(l=start_i;l<end_i;l++)										// loop through all the quadrature indices in the eta_1 direction that give non-zero contribution
+			}
+		}
+	}
+	for(b=0;b<n_cells;b++)
+	{
+		a = &acc[8*b];
+		qHat[b][t][0] = a[0] + a[2];
+		qHat[b][t][1] = a[1] + a[3];
+		if(Linear)
+		{
+			qHat_linear[b][t][0] = a[2];
+			qHat_linear[b][t][1] = a[3];
+		}
+	}
+	if(!paired)
+	{
+		return;
+	}
+
+	// THE PAIRED TERMS GIVE THE CONJUGATE OF THE SUM FOR -xi, SO ADD THE TERMS FOR -xi WITH NO PARTNER (WITH ITS OWN WEIGHTS):
+	for(b=0;b<n_cells;b++)
+	{
+		acc[8*b+5] = -acc[8*b+5]; acc[8*b+7] = -acc[8*b+7];
+	}
+	k = N - k; j = N - j; i = N - i;
+	convWindow(i, &start_i, &end_i);
+	convWindow(j, &start_j, &end_j);
+	convWindow(k, &start_k, &end_k);
+	n_list = 0;
+	for(n=start_k;n<end_k;n++)
+	{
+		if(unp_k[n])
+		{
+			list_k[n_list] = n;
+			n_list++;
+		}
+	}
+	for(l=start_i;l<end_i;l++)
+	{
+		for(m=start_j;m<end_j;m++)
+		{
+			for(p=0;p<((unp_i[l] || unp_j[m]) ? end_k - start_k : n_list);p++)						// all of the terms in the third direction if the term is unpaired in the first or second, otherwise only the unpaired ones
+			{
+				n = (unp_i[l] || unp_j[m]) ? start_k + p : list_k[p];
+				x = i + N/2 - l;
+				y = j + N/2 - m;
+				z = k + N/2 - n;
+				w = n + N*(m + N*l);
+				xw = z + N*(y + N*x);
+				pw = prefactor*wtN[l]*wtN[m]*wtN[n];
+
+				G = conv_weights[tm][w];
+				if(Linear) G_lin = scale3*conv_weights_linear[tm][w];
+				for(b=0;b<n_cells;b++)
 				{
-					for(m=start_j;m<end_j;m++)									// loop through all the quadrature indices in the eta_2 direction that give non-zero contribution
+					a = &acc[8*b];
+					a[4] += pw*G*(fHat[b][w][0]*fHat[b][xw][0] - fHat[b][w][1]*fHat[b][xw][1]);
+					a[5] += pw*G*(fHat[b][w][0]*fHat[b][xw][1] + fHat[b][w][1]*fHat[b][xw][0]);
+					if(Linear)
 					{
-						for(n=start_k;n<end_k;n++)								// loop through all the quadrature indices in the eta_3 direction that give non-zero contribution
-						{
-		
-							x = i + N/2 - l;									// set the index x to i + N/2 - l to represent the subtraction eta[x] = ki[i] - eta[l]
-							y = j + N/2 - m;									// set the index y to j + N/2 - m to represent the subtraction eta[y] = ki[j] - eta[m]
-							z = k + N/2 - n;									// set the index z to k + N/2 - n to represent the subtraction eta[z] = ki[k] - eta[n]
-							//printf("%d, %d, %d; %d, %d, %d\n",i,j,k,l,m,n);
-							// printf("tempD=%g\n",conv_weights[k + N*(j+ N*i)][n + N*(m + N*l)]);
-							tempD = conv_weights[k + N*(j+ N*i)][n + N*(m + N*l)];		// set tempD to the value of the convolution weight corresponding to current value of ki(i,j,k) & eta(l,m,n)
-							tmp0 += prefactor*wtN[l]*wtN[m]*wtN[n]*tempD*(fftOut[n + N*(m + N*l)][0]*fftOut[z + N*(y + N*x)][0] - fftOut[n + N*(m + N*l)][1]*fftOut[z + N*(y + N*x)][1]);		// increment the value of the real part of qHat(ki(i,j,k)) by fHat(eta(l,m,n))*f(ki(i,j,k)-eta(l,m,n))*conv_weight(ki(i,j,k),eta(l,m,n)) for the current values of l, m & n in the quadrature sum
-		  
-							tmp1 += prefactor*wtN[l]*wtN[m]*wtN[n]*tempD*(fftOut[n + N*(m + N*l)][0]*fftOut[z + N*(y + N*x)][1] + fftOut[n + N*(m + N*l)][1]*fftOut[z + N*(y + N*x)][0]);		// increment the value of the imaginary part of qHat(ki(i,j,k)) by fHat(eta(l,m,n))*f(ki(i,j,k)-eta(l,m,n))*conv_weight(ki(i,j,k),eta(l,m,n)) for the current values of l, m & n in the quadrature sum
-							// printf(" tempD=%g, prefactor=%g, fftOut=[%g,%g] at %d, %d, %d; %d, %d, %d; %d, %d, %d\n",tempD, prefactor, fftOut[z + N*(y + N*x)][0], fftOut[z + N*(y + N*x)][1],i,j,k,l,m,n, x,y,z);
-						}
+						a[6] += pw*G_lin*fHat[b][xw][0];
+						a[7] += pw*G_lin*fHat[b][xw][1];
 					}
 				}
-				// printf("%d, %d, %d done\n", i,j,k);
-				qHat[k + N*(j + N*i)][0] = tmp0;								// set the real part of qHat(ki(i,j,k)) to the value tmp0 calculated in the quadrature
-				qHat[k + N*(j + N*i)][1] = tmp1;								// set the imaginary part of qHat(ki(i,j,k)) to the value tmp1 calculated in the quadrature
-				// printf("%d, %d, %d write-in done\n", i,j,k);
 			}
 		}
 	}
+	for(b=0;b<n_cells;b++)
+	{
+		a = &acc[8*b];
+		qHat[b][tm][0] = a[4] + a[6];
+		qHat[b][tm][1] = a[5] + a[7];
+		if(Linear)
+		{
+			qHat_linear[b][tm][0] = a[6];
+			qHat_linear[b][tm][1] = a[7];
+		}
+	}
 }
 
-void RK4(double *f, int l, fftw_complex *qHat, double **conv_weights, double *U, double *dU) //4-th RK. yn=yn+(3*k1+k2+k3+k4)/6 
+/*
+function directQuadrature
+-------------------------
+Computes qHat[b] (and qHat_linear[b], if qHat_linear is not NULL) for each of the n_cells FFTs fHat[b] with
+the weights read from conv_weights (and conv_weights_linear), sharing the modes out between the threads and
+calculating each mode with its partner by directModePair.
+*/
+static void directQuadrature(int n_cells, fftw_complex **fHat, fftw_complex **qHat, double **conv_weights, fftw_complex **qHat_linear, double **conv_weights_linear)
 {
-  int i,j,k, j1, j2, j3, k_v, k_eta, kk,l_local;  
-  double Q_re, Q_im, tp0, tp2, tp3,tp4,tp5, tmp0=0., tmp2=0., tmp3=0., tmp4=0.,tmp5=0., tem;
-
-  l_local = l%chunk_Nx;
-  
-  FS(qHat, fftOut); 																	// set fftOut to the Fourier series representation of qHat (i.e. the IFFT of qHat)
-  //ifft3D(qHat, fftOut);
-  #pragma omp parallel for private(i) shared(Q,fftOut,f1,f)
-  for(i=0;i<size_ft;i++)																// calculate the first step of RK4
-  {
-    Q[i] = fftOut[i][0];																// this is Q(Fn, Fn) so that Kn^1 = dt*Q(Fn, Fn) = dt*Q[i]
-    f1[i] = f[i] + dt*Q[i]*nu; 															// this is Fn + Kn^1(*nu...?) BUG: this evolution (only on node values) is not consistent with our conservation routine, which preserves the exact moments of the {1,v,|v|^{2}} approximations
-  }
-
-  ComputeQ(f1, Q1_fft, conv_weights);													// calculate the Fourier tranform of Q(f1,f1) using conv_weights for the weights in the convolution, then store the results of the Fourier transform in Q1_fft
-  conserveAllMoments(Q1_fft);   														// perform the explicit conservation calculation on Kn2^ = Q^(f1,f1) = Q1_fft
-
-  FS(Q1_fft, fftOut);																	// set fftOut to the Fourier series representation of Q1_fft (i.e. the IFFT of Q1_fft, so that Kn^2 = fftOut = Q(Fn + dt*Kn^1, Fn + dt*Kn^1) )
-  //ifft3D(Q1_fft, fftOut);
-  #pragma omp parallel for private(i) shared(Q,Q1,fftOut,f1,f)
-  for(i=0;i<size_ft;i++)																// calculate the second step of RK4
-  {
-    Q1[i] = fftOut[i][0];	   
-    f1[i] = f[i] +  0.5*dt*Q[i]*nu + 0.5*dt*Q1[i]*nu;
-  }
-
-  ComputeQ(f1, Q2_fft, conv_weights); //collides
-  conserveAllMoments(Q2_fft);   //conserves k3
-
-  FS(Q2_fft, fftOut);
-  //ifft3D(Q2_fft, fftOut);
-  #pragma omp parallel for private(i) shared(Q,Q1,fftOut,f1,f)
-  for(i=0;i<size_ft;i++)																// calculate the third step of RK4
-  {
-    Q1[i] = fftOut[i][0];	 
-    f1[i] = f[i] + 0.5*Q[i]*nu + 0.5*Q1[i]*nu;
-  }
+	int t, i, j, k, tm;																				// declare t (the index of xi = ki(i,j,k)), (i,j,k) (the indices of xi) & tm (the index of -xi)
+	int *unp_i;																						// declare unp_i (the work array of directModePair for the unpaired terms)
+	double *wm_i, *acc;																				// declare wm_i (the work array of directModePair for the mirrored weights) & acc (its sums for each cell)
 
-  ComputeQ(f1, Q3_fft, conv_weights); //collides
-  conserveAllMoments(Q3_fft);                //conserves k4
+	#pragma omp parallel private(t,i,j,k,tm,unp_i,wm_i,acc) shared(fHat, qHat, conv_weights, qHat_linear, conv_weights_linear)
+	{
+		wm_i = (double *)malloc(3*N*sizeof(double));
+		unp_i = (int *)malloc(4*N*sizeof(int));
+		acc = (double *)malloc(8*n_cells*sizeof(double));
 
-  #pragma omp parallel for schedule(dynamic) private(j1,j2,j3,i,j,k,k_v,k_eta,kk,Q_re, Q_im) shared(l, l_local, qHat,U, dU) reduction(+:tp0, tp2,tp3,tp4, tp5)  // calculate the fourth step of RK4 (still in Fourier space though?!) - reduction(+: tmp0, tmp2, tmp3, tmp4, tmp5)
-  for(int kt=0;kt<size_v;kt++){
-    j3 = kt % Nv; j2 = ((kt-j3)/Nv) % Nv; j1 = (kt - j3 - Nv*j2)/(Nv*Nv);
-    tp0=0.; tp2=0.; tp3=0.; tp4=0.; tp5=0.;
-    for(i=0;i<N;i++){
-      for(j=0;j<N;j++){
-		for(k=0;k<N;k++){
-		  k_eta = k + N*(j + N*i);
-		  
-		  IntModes(i,j,k,j1,j2,j3,IntM); //the global IntM must be declared as threadprivate; BUG: forgot to uncomment this and thus IntM=0 !!
-		  
-		  Q_re = nu*(0.5*qHat[k_eta][0] + (Q1_fft[k_eta][0]+Q2_fft[k_eta][0]+Q3_fft[k_eta][0])/6.);
-		  Q_im = nu*(0.5*qHat[k_eta][1] + (Q1_fft[k_eta][1]+Q2_fft[k_eta][1]+Q3_fft[k_eta][1])/6.);
-		  
-		  //tem = scale3*wtN[i]*wtN[j]*wtN[k]*h_eta*h_eta*h_eta;
-		  tp0 += IntM[0]*Q_re - IntM[1]*Q_im;
-		  tp2 += IntM[1*2]*Q_re - IntM[1*2+1]*Q_im;
-		  tp3 += IntM[2*2]*Q_re - IntM[2*2+1]*Q_im;
-		  tp4 += IntM[3*2]*Q_re - IntM[3*2+1]*Q_im;
-		  tp5 += IntM[4*2]*Q_re - IntM[4*2+1]*Q_im;
+		#pragma omp for schedule(dynamic)
+		for(t=0;t<size_ft;t++)
+		{
+			k = t % N;
+			j = (t/N) % N;
+			i = t/(N*N);
+			tm = (N-k)%N + N*((N-j)%N + N*((N-i)%N));
+			if(i > 0 && j > 0 && k > 0 && tm < t)
+			{
+				continue;																			// this mode is calculated with its partner
+			}
+			if(qHat_linear == NULL)
+			{
+				directModePair<0>(t, n_cells, fHat, qHat, conv_weights, NULL, NULL, wm_i, unp_i, acc);
+			}
+			else
+			{
+				directModePair<1>(t, n_cells, fHat, qHat, conv_weights, qHat_linear, conv_weights_linear, wm_i, unp_i, acc);
+			}
 		}
-      }
-    }	     
-    //tmp0 += tp0; tmp2 += dv*tp2 + Gridv((double)j1)*tp0; tmp3 += dv*tp3 +Gridv((double)j2)*tp0 ;tmp4 += dv*tp4 + Gridv((double)j3)*tp0;  //tmp5 += (Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3))*tp0 +dv*dv*tp5+2*dv*(Gridv((double)j1)*tp2 + Gridv((double)j2)*tp3 +Gridv((double)j3)*tp4);     
-	//tmp5 += dv*dv*tp5 -  (Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3))*tp0 + 2*(Gridv((double)j1)*(dv*tp2 + Gridv((double)j1)*tp0) + Gridv((double)j2)*(dv*tp3 + Gridv((double)j2)*tp0) + Gridv((double)j3)*(dv*tp4 + Gridv((double)j3)*tp0));
-	  
-    k_v = l*size_v + kt;      
-    tp0 = U[k_v*6+0] + U[k_v*6+5]/4. + dt*tp0/scalev/scaleL/scale3;
-    tp2 = U[k_v*6+2] + dt*tp2*12./scalev/scaleL/scale3;
-    tp3 = U[k_v*6+3] + dt*tp3*12./scalev/scaleL/scale3;
-    tp4 = U[k_v*6+4] + dt*tp4*12./scalev/scaleL/scale3;
-    tp5 = U[k_v*6+0]/4. + U[k_v*6+5]*19./240. + dt*tp5/scalev/scaleL/scale3;
-
-    dU[(l_local*size_v + kt)*5] = 19*tp0/4. - 15*tp5;
-    dU[(l_local*size_v + kt)*5+4] = 60*tp5 - 15*tp0;
-    dU[(l_local*size_v + kt)*5+1] = tp2;
-    dU[(l_local*size_v + kt)*5+2] = tp3;
-    dU[(l_local*size_v + kt)*5+3] = tp4;   
-  }
+
+		free(wm_i); free(unp_i); free(acc);
+	}
 }
-#endif
- 
-#else
 
-#ifdef FullandLinear
-/*void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights, double **conv_weights_linear)
+/*
+function ComputeQ_Direct
+------------------------
+Computes the quadrature for qHat, given the FFT fHat of f, with the weights read from conv_weights (and the
+linear two species part from conv_weights_linear, if qHat_linear is not NULL, which is also added to qHat).
+Each mode with a partner at -xi is calculated together with it, so that each weight and product of fHat is
+loaded and calculated once for both modes (see directModePair).  The discrete qHat is not exactly Hermitian,
+however, since the trapezoidal weights are not symmetric and eta(0) = -L_eta has no reflection on the grid,
+so the terms which differ are added separately.  The modes with an index of 0 (and xi = 0) are calculated on
+their own.
+*/
+void ComputeQ_Direct(fftw_complex *fHat, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear)
 {
-  int i, j, k, l, m, n, x, y, z;
-  int start_i, start_j, start_k, end_i, end_j, end_k;
-  //fftw_complex *fftIn, *fftOut;
-  double tempD, tempD1, tmp0, tmp1;
-  double prefactor = h_eta*h_eta*h_eta; // we dont have scale3 here.
+	directQuadrature(1, &fHat, &qHat, conv_weights, (qHat_linear != NULL) ? &qHat_linear : NULL, conv_weights_linear);
+}
 
-  //fftIn = (fftw_complex *)fftw_malloc(N*N*N*sizeof(fftw_complex));
-  //fftOut = (fftw_complex *)fftw_malloc(N*N*N*sizeof(fftw_complex));
-  
-  for(i=0;i<size_ft;i++){
-    fftIn[i][0] = f[i];
-    fftIn[i][1] = 0.;
-  }
+/*
+function checkComputeQ
+----------------------
+Checks the method chosen in QMethod against the quadrature in ComputeQ_MatrixFree (which is the same sum as
+the direct method, without needing conv_weights, so it is the reference for every method: conv_weights is
+only loaded for the direct method) for the solution f, and returns the largest difference between the two
+values of qHat (and qHat_linear, if FullandLinear was defined), relative to the largest value of |qHat|.
+For the direct method, the weights in conv_weights (and conv_weights_linear, which is only used if
+FullandLinear was defined) are checked.  The matrix-free method can't be checked against itself, so
+readRunOptions doesn't allow -qcheck with it.  This is used at the start of a run with the option -qcheck,
+with the work arrays in ctx.
+*/
+double checkComputeQ(CollisionContext *ctx, double *f, double **conv_weights, double **conv_weights_linear)
+{
+	int i;																							// declare i (a counter)
+	double diff, max_diff, max_q;																	// declare diff (the difference at a point), max_diff (the largest difference) & max_q (the largest value of |qHat|)
+	fftw_complex *q_ref, *q_test, *q_ref_linear, *q_test_linear;									// declare pointers to q_ref & q_test (qHat calculated with ComputeQ_MatrixFree and with the method in QMethod) and q_ref_linear & q_test_linear (the same for qHat_linear)
+
+	q_ref = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	q_test = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	q_ref_linear = NULL;
+	q_test_linear = NULL;
+	#ifdef FullandLinear																			// only do this if FullandLinear was defined
+	q_ref_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	q_test_linear = (fftw_complex *)fftw_malloc(size_ft*sizeof(fftw_complex));
+	#endif
+
+	fft3D(f, ctx->fHat, ctx->temp);
+	ComputeQ_MatrixFree(ctx->fHat, q_ref, q_ref_linear);
+	if(QMethod == QDirect)
+	{
+		ComputeQ_Direct(ctx->fHat, q_test, conv_weights, q_test_linear, conv_weights_linear);
+	}
+	else
+	{
+		ComputeQ_WithMethod(ctx, ctx->fHat, q_test, q_test_linear);
+	}
 
-  fft3D(fftIn, fftOut);
-  
-  //printf("fft done\n");
-  #pragma omp parallel for private(j,k,l,m,n,x,y,z,start_i,start_j,start_k,end_i,end_j,end_k,tempD, tempD1,tmp0, tmp1) shared(qHat, fftOut, conv_weights, conv_weights_linear)
-  for(i=0;i<N;i++) {
-    for(j=0;j<N;j++){
-      for(k=0;k<N;k++)
+	max_diff = 0.;
+	max_q = 0.;
+	for(i=0;i<size_ft;i++)
 	{
-	  //figure out the windows for the convolutions (i.e. where xi(l) and eta(i)-xi(l) are in the domain)
-	  if( i < N/2 ) {
-	    start_i = 0;
-	    end_i = i + N/2 + 1; 
-	  }
-	  else {
-	    start_i = i - N/2 + 1;
-	    end_i = N;
-	  }
-	  
-	  if( j < N/2 ) {
-	    start_j = 0;
-	    end_j = j + N/2 + 1; 
-	  }
-	  else {
-	    start_j = j - N/2 + 1;
-	    end_j = N;
-	  }
-	  
-	  if( k < N/2 ) {
-	    start_k = 0;
-	    end_k = k + N/2 + 1; 
-	  }
-	  else {
-	    start_k = k - N/2 + 1;
-	    end_k = N;
-	  }
-	  tmp0=0.; tmp1=0.;
-	  for(l=start_i;l<end_i;l++) {
-	    for(m=start_j;m<end_j;m++) {
-	      for(n=start_k;n<end_k;n++)
+		max_q = fmax(max_q, sqrt(q_ref[i][0]*q_ref[i][0] + q_ref[i][1]*q_ref[i][1]));
+		diff = sqrt((q_test[i][0]-q_ref[i][0])*(q_test[i][0]-q_ref[i][0]) + (q_test[i][1]-q_ref[i][1])*(q_test[i][1]-q_ref[i][1]));
+		max_diff = fmax(max_diff, diff);
+		if(q_ref_linear != NULL)
 		{
-		
-		  x = i + N/2 - l;
-		  y = j + N/2 - m;
-		  z = k + N/2 - n;
-		  //printf("%d, %d, %d; %d, %d, %d\n",i,j,k,l,m,n);
-		 // printf("tempD=%g\n",conv_weights[k + N*(j+ N*i)][n + N*(m + N*l)]);
-		  //get convolution weight		   
-		  tempD = conv_weights[k + N*(j+ N*i)][n + N*(m + N*l)];
-		  tempD1 = conv_weights_linear[k + N*(j+ N*i)][n + N*(m + N*l)];		  
-		//  printf(" tempD=%g, prefactor=%g, fftOut=[%g,%g] at %d, %d, %d; %d, %d, %d; %d, %d, %d\n",tempD, prefactor, fftOut[z + N*(y + N*x)][0], fftOut[z + N*(y + N*x)][1],i,j,k,l,m,n, x,y,z);
-		  tmp0 += prefactor*wtN[l]*wtN[m]*wtN[n]*(tempD*(fftOut[n + N*(m + N*l)][0]*fftOut[z + N*(y + N*x)][0] - fftOut[n + N*(m + N*l)][1]*fftOut[z + N*(y + N*x)][1]) + scale3*tempD1*fftOut[z + N*(y + N*x)][0]);
-		  
-		  tmp1 += prefactor*wtN[l]*wtN[m]*wtN[n]*(tempD*(fftOut[n + N*(m + N*l)][0]*fftOut[z + N*(y + N*x)][1] + fftOut[n + N*(m + N*l)][1]*fftOut[z + N*(y + N*x)][0]) + scale3*tempD1*fftOut[z + N*(y + N*x)][1]);
-		 // printf(" tempD=%g, prefactor=%g, fftOut=[%g,%g] at %d, %d, %d; %d, %d, %d; %d, %d, %d\n",tempD, prefactor, fftOut[z + N*(y + N*x)][0], fftOut[z + N*(y + N*x)][1],i,j,k,l,m,n, x,y,z);
+			diff = sqrt((q_test_linear[i][0]-q_ref_linear[i][0])*(q_test_linear[i][0]-q_ref_linear[i][0]) + (q_test_linear[i][1]-q_ref_linear[i][1])*(q_test_linear[i][1]-q_ref_linear[i][1]));
+			max_diff = fmax(max_diff, diff);
 		}
-	    }
-	  }
-	// printf("%d, %d, %d done\n", i,j,k);
-	 qHat[k + N*(j + N*i)][0] = tmp0;  
-	 qHat[k + N*(j + N*i)][1] = tmp1;
-	 // printf("%d, %d, %d write-in done\n", i,j,k);
 	}
-    }
-  }
 
- // fftw_free(fftIn);
- // fftw_free(fftOut);
+	fftw_free(q_ref); fftw_free(q_test);
+	if(q_ref_linear != NULL)
+	{
+		fftw_free(q_ref_linear); fftw_free(q_test_linear);
+	}
 
+	return (max_q > 0.) ? max_diff/max_q : max_diff;
 }
-void RK4(double *f, int l, fftw_complex *qHat, double **conv_weights, double **conv_weights_linear, double *U) //4-th RK. yn=yn+(3*k1+k2+k3+k4)/6 
-{
-  int i,j,k, j1, j2, j3, k_v, k_eta,kk;  
-  double Q_re, Q_im, tp0, tp2, tp3,tp4,tp5, tmp0=0., tmp2=0., tmp3=0., tmp4=0.,tmp5=0., tem;
-
-  FS(qHat, fftOut); 
-  //ifft3D(qHat, fftOut);
-  #pragma omp parallel for private(i) shared(Q,fftOut,f1,f)
-  for(i=0;i<size_ft;i++){    
-    Q[i] = fftOut[i][0];
-    f1[i] = f[i] + dt*Q[i]*nu; //BUG: this evolution (only on node values) is not consistent with our conservation routine, which preserves the exact moments of the {1,v,|v|^{2}} approximations
-  }
 
-  ComputeQ(f1, Q1_fft, conv_weights,conv_weights_linear); //collides
-  conserveAllMoments(Q1_fft);   	//conserves k2	
-
-  FS(Q1_fft, fftOut);
-  //ifft3D(Q1_fft, fftOut);
-  #pragma omp parallel for private(i) shared(Q,Q1,fftOut,f1,f)
-  for(i=0;i<size_ft;i++){ 	
-    Q1[i] = fftOut[i][0];	   
-    f1[i] = f[i] +  0.5*dt*Q[i]*nu + 0.5*dt*Q1[i]*nu;
+/*
+function RK4_ProjectStep
+------------------------
+The last step of RK4 at the space-step l: projects nu*(qHat/2 + (Q1_fft + Q2_fft + Q3_fft)/6), the
+combination of the four (conserved) stages in Fourier space, onto the DG basis functions of each velocity
+cell (with ProjectOntoCells, in the work arrays of ctx) and adds dt times this to the coefficients of the
+collision invariants in U, in place (the space-step l is one of the cells of this process, see startGhostExchange).
+*/
+void RK4_ProjectStep(CollisionContext *ctx, int l, fftw_complex *qHat, fftw_complex *Q1_fft, fftw_complex *Q2_fft, fftw_complex *Q3_fft, double *U)
+{
+  int k_v, k_eta;
+  double tp0, tp2, tp3, tp4, tp5;
+  fftw_complex *G = ctx->proj_in;
+  double *cells = ctx->proj_cells;
+
+  #pragma omp parallel for private(k_eta) shared(G, qHat, Q1_fft, Q2_fft, Q3_fft)
+  for(k_eta=0;k_eta<size_ft;k_eta++){
+    G[k_eta][0] = nu*(0.5*qHat[k_eta][0] + (Q1_fft[k_eta][0]+Q2_fft[k_eta][0]+Q3_fft[k_eta][0])/6.);
+    G[k_eta][1] = nu*(0.5*qHat[k_eta][1] + (Q1_fft[k_eta][1]+Q2_fft[k_eta][1]+Q3_fft[k_eta][1])/6.);
   }
-  
-  ComputeQ(f1, Q2_fft, conv_weights,conv_weights_linear); //collides
-  conserveAllMoments(Q2_fft);   //conserves k3
+  ProjectOntoCells(ctx, G, cells);
 
-  FS(Q2_fft, fftOut);
-  //ifft3D(Q2_fft, fftOut);
-  #pragma omp parallel for private(i) shared(Q,Q1,fftOut,f1,f)
-  for(i=0;i<size_ft;i++){	
-    Q1[i] = fftOut[i][0];	 
-    f1[i] = f[i] + 0.5*dt*Q[i]*nu + 0.5*dt*Q1[i]*nu;
-  }
-	 
-  ComputeQ(f1, Q3_fft, conv_weights,conv_weights_linear); //collides
-  conserveAllMoments(Q3_fft);                //conserves k4
-  
-  #pragma omp parallel for schedule(dynamic) private(j1,j2,j3,i,j,k,k_v,k_eta,kk,Q_re, Q_im, tp0, tp2,tp3,tp4, tp5) shared(l,qHat,U) //reduction(+: tmp0, tmp2, tmp3, tmp4, tmp5)
+  #pragma omp parallel for private(k_v, tp0, tp2, tp3, tp4, tp5) shared(l, cells, U)
   for(int kt=0;kt<size_v;kt++){
-    j3 = kt % Nv; j2 = ((kt-j3)/Nv) % Nv; j1 = (kt - j3 - Nv*j2)/(Nv*Nv);
-    tp0=0.; tp2=0.; tp3=0.; tp4=0.; tp5=0.;
-    for(i=0;i<N;i++){
-      for(j=0;j<N;j++){
-		for(k=0;k<N;k++){
-		  k_eta = k + N*(j + N*i);
-		  //kk = kt*size_ft+k_eta;
-		  //IntModes(i,j,k,j1,j2,j3,IntM); //the global IntM must be declared as threadprivate
-		  
-		  Q_re = nu*(0.5*qHat[k_eta][0] + (Q1_fft[k_eta][0]+Q2_fft[k_eta][0]+Q3_fft[k_eta][0])/6.);
-		  Q_im = nu*(0.5*qHat[k_eta][1] + (Q1_fft[k_eta][1]+Q2_fft[k_eta][1]+Q3_fft[k_eta][1])/6.);
-		  
-		  //tem = scale3*wtN[i]*wtN[j]*wtN[k]*h_eta*h_eta*h_eta;
-		  tp0 += IntM[0]*Q_re - IntM[1]*Q_im;
-		  tp2 += IntM[1*2]*Q_re - IntM[1*2+1]*Q_im;
-		  tp3 += IntM[2*2]*Q_re - IntM[2*2+1]*Q_im;
-		  tp4 += IntM[3*2]*Q_re - IntM[3*2+1]*Q_im;
-		  tp5 += IntM[4*2]*Q_re - IntM[4*2+1]*Q_im;
-		}
-      }
-    }	     
-    //tmp0 += tp0; tmp2 += dv*tp2 + Gridv((double)j1)*tp0; tmp3 += dv*tp3 +Gridv((double)j2)*tp0 ;tmp4 += dv*tp4 + Gridv((double)j3)*tp0;  //tmp5 += (Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3))*tp0 +dv*dv*tp5+2*dv*(Gridv((double)j1)*tp2 + Gridv((double)j2)*tp3 +Gridv((double)j3)*tp4);     
-	//tmp5 += dv*dv*tp5 -  (Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3))*tp0 + 2*(Gridv((double)j1)*(dv*tp2 + Gridv((double)j1)*tp0) + Gridv((double)j2)*(dv*tp3 + Gridv((double)j2)*tp0) + Gridv((double)j3)*(dv*tp4 + Gridv((double)j3)*tp0));
-	  
     k_v = l*size_v + kt;      
-    tp0 = U[k_v*6+0] + U[k_v*6+5]/4. + dt*tp0/scalev/scaleL/scale3;
-    tp2 = U[k_v*6+2] + dt*tp2*12./scalev/scaleL/scale3;
-    tp3 = U[k_v*6+3] + dt*tp3*12./scalev/scaleL/scale3;
-    tp4 = U[k_v*6+4] + dt*tp4*12./scalev/scaleL/scale3;
-    tp5 = U[k_v*6+0]/4. + U[k_v*6+5]*19./240. + dt*tp5/scalev/scaleL/scale3;
+    tp0 = U[k_v*6+0] + U[k_v*6+5]/4. + dt*cells[5*kt]/scalev/scaleL/scale3;
+    tp2 = U[k_v*6+2] + dt*cells[5*kt+1]*12./scalev/scaleL/scale3;
+    tp3 = U[k_v*6+3] + dt*cells[5*kt+2]*12./scalev/scaleL/scale3;
+    tp4 = U[k_v*6+4] + dt*cells[5*kt+3]*12./scalev/scaleL/scale3;
+    tp5 = U[k_v*6+0]/4. + U[k_v*6+5]*19./240. + dt*cells[5*kt+4]/scalev/scaleL/scale3;
 
     U[k_v*6+0] = 19*tp0/4. - 15*tp5;
     U[k_v*6+5] = 60*tp5 - 15*tp0;
-    U[k_v*6+2] = tp2; U[k_v*6+3] = tp3; U[k_v*6+4] = tp4;      
+    U[k_v*6+2] = tp2; U[k_v*6+3] = tp3; U[k_v*6+4] = tp4;
   }
-	//printf("RK4: %g, %g, %g, %g, %g\n", tmp0, tmp2, tmp3, tmp4, 0.5*tmp5);  
-}   
+}
+
+/*
+function ComputeQ_Batch
+-----------------------
+Computes qHat[b] (and qHat_linear[b], if qHat_linear is not NULL) for each of the n_cells solutions f[b],
+exactly as ComputeQ would for each of them separately.  With the direct method the quadrature is the same
+for every cell except for the values of fHat, so directModePair calculates each pair of modes for every cell
+in the batch: each weight in conv_weights (and conv_weights_linear) is then loaded from memory once per batch
+rather than once per cell.  The other methods don't read conv_weights, so they are just applied to each
+cell in turn.  The FFTs of the cells are taken together by fft3D_Batch, in the work arrays of ctx.
 */
-#else
-void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights)
+void ComputeQ_Batch(CollisionContext *ctx, double **f, int n_cells, fftw_complex **qHat, double **conv_weights, fftw_complex **qHat_linear, double **conv_weights_linear)
 {
-  int i, j, k, l, m, n, x, y, z;
-  int start_i, start_j, start_k, end_i, end_j, end_k;
-  //fftw_complex *fftIn, *fftOut;
-  double tempD, tmp0, tmp1;
-  double prefactor = h_eta*h_eta*h_eta; // we dont have scale3 here.
+  int b;
+  fftw_complex **fHat = ctx->fHat_batch;
 
-  //fftIn = (fftw_complex *)fftw_malloc(N*N*N*sizeof(fftw_complex));
-  //fftOut = (fftw_complex *)fftw_malloc(N*N*N*sizeof(fftw_complex));
-  
-  for(i=0;i<size_ft;i++){
-    fftIn[i][0] = f[i];
-    fftIn[i][1] = 0.;
+  fft3D_Batch(f, fHat, n_cells, ctx->temp_batch);
+
+  if(QMethod != QDirect) {
+    for(b=0;b<n_cells;b++){
+      ComputeQ_WithMethod(ctx, fHat[b], qHat[b], (qHat_linear != NULL) ? qHat_linear[b] : NULL);
+    }
   }
+  else {
+    directQuadrature(n_cells, fHat, qHat, conv_weights, qHat_linear, conv_weights_linear);
+  }
+}
 
-  fft3D(fftIn, fftOut);
-  
-  //printf("fft done\n");
-  #pragma omp parallel for schedule(dynamic) private(j,k,l,m,n,x,y,z,start_i,start_j,start_k,end_i,end_j,end_k,tempD, tmp0, tmp1) shared(qHat, fftOut, conv_weights)
-  for(i=0;i<N;i++) {
-    for(j=0;j<N;j++){
-      for(k=0;k<N;k++)
-	{
-	  //figure out the windows for the convolutions (i.e. where xi(l) and eta(i)-xi(l) are in the domain)
-	  if( i < N/2 ) {
-	    start_i = 0;
-	    end_i = i + N/2 + 1; 
-	  }
-	  else {
-	    start_i = i - N/2 + 1;
-	    end_i = N;
-	  }
-	  
-	  if( j < N/2 ) {
-	    start_j = 0;
-	    end_j = j + N/2 + 1; 
-	  }
-	  else {
-	    start_j = j - N/2 + 1;
-	    end_j = N;
-	  }
-	  
-	  if( k < N/2 ) {
-	    start_k = 0;
-	    end_k = k + N/2 + 1; 
-	  }
-	  else {
-	    start_k = k - N/2 + 1;
-	    end_k = N;
-	  }
-	  tmp0=0.; tmp1=0.;
-	  for(l=start_i;l<end_i;l++) {
-	    for(m=start_j;m<end_j;m++) {
-	      for(n=start_k;n<end_k;n++)
-		{
-		
-		  x = i + N/2 - l;
-		  y = j + N/2 - m;
-		  z = k + N/2 - n;
-		  //printf("%d, %d, %d; %d, %d, %d\n",i,j,k,l,m,n);
-		 // printf("tempD=%g\n",conv_weights[k + N*(j+ N*i)][n + N*(m + N*l)]);
-		  //get convolution weight		   
-		  tempD = conv_weights[k + N*(j+ N*i)][n + N*(m + N*l)]; 
-		  //tempD = gHat3(eta[i], eta[j], eta[k], eta[l], eta[m], eta[n]); //computing weights on the fly
-		  tmp0 += prefactor*wtN[l]*wtN[m]*wtN[n]*tempD*(fftOut[n + N*(m + N*l)][0]*fftOut[z + N*(y + N*x)][0] - fftOut[n + N*(m + N*l)][1]*fftOut[z + N*(y + N*x)][1]);
-		  
-		  tmp1 += prefactor*wtN[l]*wtN[m]*wtN[n]*tempD*(fftOut[n + N*(m + N*l)][0]*fftOut[z + N*(y + N*x)][1] + fftOut[n + N*(m + N*l)][1]*fftOut[z + N*(y + N*x)][0]);
-		 // printf(" tempD=%g, prefactor=%g, fftOut=[%g,%g] at %d, %d, %d; %d, %d, %d; %d, %d, %d\n",tempD, prefactor, fftOut[z + N*(y + N*x)][0], fftOut[z + N*(y + N*x)][1],i,j,k,l,m,n, x,y,z);
-		}
-	    }
-	  }
-	// printf("%d, %d, %d done\n", i,j,k);
-	 qHat[k + N*(j + N*i)][0] = tmp0;  
-	 qHat[k + N*(j + N*i)][1] = tmp1;
-	 // printf("%d, %d, %d write-in done\n", i,j,k);
-	}
+/*
+function RK4_Batch
+------------------
+Performs the whole collision step (the ComputeQ & conserveAllMoments done in main, followed by RK4) for the
+n_cells space-steps l0, l0+1, ..., l0+n_cells-1, whose solutions are in f[0], ..., f[n_cells-1].  The cells
+are advanced through the stages of RK4 together, so that each stage needs one call of ComputeQ_Batch for
+all of them (and one call of FS_Batch for their Fourier series), but each cell is computed exactly as RK4
+computes it on its own (with the work arrays in ctx).
+*/
+#ifdef FullandLinear
+void RK4_Batch(CollisionContext *ctx, double **f, int l0, int n_cells, double **conv_weights, double **conv_weights_linear, double *U)
+#else
+void RK4_Batch(CollisionContext *ctx, double **f, int l0, int n_cells, double **conv_weights, double *U)
+#endif
+{
+  int b, i, s;
+  double **Qb = ctx->Q_batch, **f1b = ctx->f1_batch, **Q1b = ctx->Q1_batch;
+  fftw_complex ***K = ctx->K_batch; // the stages (qHat, Q1_fft, Q2_fft & Q3_fft in RK4) for each cell
+  #ifdef FullandLinear
+  fftw_complex ***K_linear = ctx->K_linear_batch;
+  #endif
+
+  for(s=0;s<4;s++){
+    #ifdef FullandLinear
+    ComputeQ_Batch(ctx, s == 0 ? f : f1b, n_cells, K[s], conv_weights, K_linear[s], conv_weights_linear);
+    #else
+    ComputeQ_Batch(ctx, s == 0 ? f : f1b, n_cells, K[s], conv_weights, NULL, NULL);
+    #endif
+
+    for(b=0;b<n_cells;b++){
+      #ifdef FullandLinear
+      conserveAllMoments(K[s][b], K_linear[s][b]);
+      #pragma omp parallel for private(i) shared(K, K_linear)
+      for(i=0;i<size_ft;i++){
+        K[s][b][i][0] += K_linear[s][b][i][0];
+        K[s][b][i][1] += K_linear[s][b][i][1];
+      }
+      #else
+      conserveAllMoments(K[s][b]);
+      #endif
+
+      if(s == 3){
+        RK4_ProjectStep(ctx, l0 + b, K[0][b], K[1][b], K[2][b], K[3][b], U);
+      }
+    }
+    if(s == 3){
+      break;
+    }
+
+    FS_Batch(K[s], (s == 0) ? Qb : Q1b, n_cells, ctx->temp_batch);
+    for(b=0;b<n_cells;b++){
+      #pragma omp parallel for private(i) shared(Qb,Q1b,f1b,f)
+      for(i=0;i<size_ft;i++){
+        if(s == 0){
+          f1b[b][i] = f[b][i] + dt*Qb[b][i]*nu;
+        }
+        else{
+          #ifndef FullandLinear
+          if(s == 2){
+            f1b[b][i] = f[b][i] + 0.5*Qb[b][i]*nu + 0.5*Q1b[b][i]*nu; // exactly as in the third step of RK4
+            continue;
+          }
+          #endif
+          f1b[b][i] = f[b][i] + 0.5*dt*Qb[b][i]*nu + 0.5*dt*Q1b[b][i]*nu;
+        }
+      }
     }
   }
+}
 
- // fftw_free(fftIn);
- // fftw_free(fftOut);
+#ifdef FullandLinear
+void ComputeQ(CollisionContext *ctx, double *f, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear)
+{
+  fft3D(f, ctx->fHat, ctx->temp);
 
+  if(QMethod != QDirect) {
+    ComputeQ_WithMethod(ctx, ctx->fHat, qHat, qHat_linear); // calculate qHat without conv_weights & conv_weights_linear (with the method in QMethod)
+    return;
+  }
+  
+  ComputeQ_Direct(ctx->fHat, qHat, conv_weights, qHat_linear, conv_weights_linear); // the direct quadrature, calculating each mode together with its mirror image -xi
 }
 
-void RK4(double *f, int l, fftw_complex *qHat, double **conv_weights, double *U) //4-th RK. yn=yn+(3*k1+k2+k3+k4)/6 
+void RK4(CollisionContext *ctx, double *f, int l, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear, double *U) //4-th RK. yn=yn+(3*k1+k2+k3+k4)/6 
 {
-  int i,j,k, j1, j2, j3, k_v, k_eta,kk;  
-  double Q_re, Q_im, tp0, tp2, tp3,tp4,tp5, tmp0=0., tmp2=0., tmp3=0., tmp4=0.,tmp5=0., tem;
+  int i;
+  double *Q = ctx->Q, *f1 = ctx->f1, *Q1 = ctx->Q1; // the work arrays of the stages, from ctx
+  fftw_complex *Q1_fft = ctx->Q1_fft, *Q2_fft = ctx->Q2_fft, *Q3_fft = ctx->Q3_fft;
+  fftw_complex *Q1_fft_linear = ctx->Q1_fft_linear, *Q2_fft_linear = ctx->Q2_fft_linear, *Q3_fft_linear = ctx->Q3_fft_linear;
+
+  #pragma omp parallel for private(i) shared(qHat, qHat_linear)
+  for(i=0;i<size_ft;i++){
+    qHat[i][0] += qHat_linear[i][0];
+	qHat[i][1] += qHat_linear[i][1];
+  }
+  FS(qHat, Q, ctx->temp); 
 
-  FS(qHat, fftOut); 
-  //ifft3D(qHat, fftOut);
-  #pragma omp parallel for private(i) shared(Q,fftOut,f1,f)
+  #pragma omp parallel for private(i) shared(Q,f1,f)
   for(i=0;i<size_ft;i++){    
-    Q[i] = fftOut[i][0];
     f1[i] = f[i] + dt*Q[i]*nu; //BUG: this evolution (only on node values) is not consistent with our conservation routine, which preserves the exact moments of the {1,v,|v|^{2}} approximations
   }
 
-  ComputeQ(f1, Q1_fft, conv_weights); //collides
-  conserveAllMoments(Q1_fft);   	//conserves k2	
+  ComputeQ(ctx, f1, Q1_fft, conv_weights, Q1_fft_linear, conv_weights_linear);
+  conserveAllMoments(Q1_fft, Q1_fft_linear);   	//conserves k2	
+  
+  #pragma omp parallel for private(i) shared(Q1_fft, Q1_fft_linear)
+  for(i=0;i<size_ft;i++){
+    Q1_fft[i][0] += Q1_fft_linear[i][0];
+	Q1_fft[i][1] += Q1_fft_linear[i][1];
+  }
+  
+  FS(Q1_fft, Q1, ctx->temp);
 
-  FS(Q1_fft, fftOut);
-  //ifft3D(Q1_fft, fftOut);
-  #pragma omp parallel for private(i) shared(Q,Q1,fftOut,f1,f)
+  #pragma omp parallel for private(i) shared(Q,Q1,f1,f)
   for(i=0;i<size_ft;i++){ 	
-    Q1[i] = fftOut[i][0];	   
     f1[i] = f[i] +  0.5*dt*Q[i]*nu + 0.5*dt*Q1[i]*nu;
   }
-  
-  ComputeQ(f1, Q2_fft, conv_weights); //collides
-  conserveAllMoments(Q2_fft);   //conserves k3
+ 
+  ComputeQ(ctx, f1, Q2_fft, conv_weights, Q2_fft_linear, conv_weights_linear);
+  conserveAllMoments(Q2_fft, Q2_fft_linear);   //conserves k3
 
-  FS(Q2_fft, fftOut);
-  //ifft3D(Q2_fft, fftOut);
-  #pragma omp parallel for private(i) shared(Q,Q1,fftOut,f1,f)
+  #pragma omp parallel for private(i) shared(Q2_fft, Q2_fft_linear)
+  for(i=0;i<size_ft;i++){
+    Q2_fft[i][0] += Q2_fft_linear[i][0];
+	Q2_fft[i][1] += Q2_fft_linear[i][1];
+  }
+  FS(Q2_fft, Q1, ctx->temp);
+  //ifft3D(Q2_fft, Q1);
+  #pragma omp parallel for private(i) shared(Q,Q1,f1,f)
   for(i=0;i<size_ft;i++){	
-    Q1[i] = fftOut[i][0];	 
     f1[i] = f[i] + 0.5*dt*Q[i]*nu + 0.5*dt*Q1[i]*nu;
   }
-	 
-  ComputeQ(f1, Q3_fft, conv_weights); //collides
-  conserveAllMoments(Q3_fft);                //conserves k4
-  
-  /*FS(Q3_fft, fftOut);
+
+  ComputeQ(ctx, f1, Q3_fft, conv_weights, Q3_fft_linear, conv_weights_linear);
+  conserveAllMoments(Q3_fft, Q3_fft_linear);                //conserves k4
+
+  #pragma omp parallel for private(i) shared(Q3_fft, Q3_fft_linear)
   for(i=0;i<size_ft;i++){
-    Q3[i] = fftOut[i][0];	  
-    f[i] = f[i] + 0.5*dt*Q[i]*nu + dt*(Q1[i]+Q2[i]+Q3[i])*nu/6.;
-  } */
-
- /* ProjectedNodeValue(qHat, Q);
-  #pragma omp parallel for private(k_eta) shared(Q,f1,f)
-  for(k_eta=0;k_eta<size_ft;k_eta++){  
-    f1[k_eta] = f[k_eta] + dt*Q[k_eta]; //BUG: this evolution (only on node values) is not consistent with our conservation routine, which preserves the exact moments of the {1,v,|v|^{2}} approximations
+    Q3_fft[i][0] += Q3_fft_linear[i][0];
+	Q3_fft[i][1] += Q3_fft_linear[i][1];
   }
+  RK4_ProjectStep(ctx, l, qHat, Q1_fft, Q2_fft, Q3_fft, U);						// add dt times the RK4 combination of the four stages to the DG coefficients of the collision invariants at the space-step l in U
+}
+#else
+void ComputeQ(CollisionContext *ctx, double *f, fftw_complex *qHat, double **conv_weights)
+{
+	fft3D(f, ctx->fHat, ctx->temp);												// perform the FFT of the solution sampled in f and store the result in ctx->fHat
 
-  ComputeQ(f1, Q1_fft, conv_weights); //collides
-  conserveAllMoments(Q1_fft);   	//conserves k2	
+	if(QMethod != QDirect)														// if conv_weights is not used by the method in QMethod
+	{
+		ComputeQ_WithMethod(ctx, ctx->fHat, qHat, NULL);						// calculate qHat from ctx->fHat with the method in QMethod
+		return;
+	}
+  
+	// THE WEIGHTS ARE READ FROM conv_weights, CALCULATING EACH MODE TOGETHER WITH ITS MIRROR IMAGE -xi (SEE ComputeQ_Direct):
+	ComputeQ_Direct(ctx->fHat, qHat, conv_weights, NULL, NULL);					// calculate qHat from ctx->fHat with the direct quadrature
+}
 
-  ProjectedNodeValue(Q1_fft, Q1);
-  #pragma omp parallel for private(k_eta) shared(Q,Q1,f2,f)
-  for(k_eta=0;k_eta<size_ft;k_eta++){   
-    f2[k_eta] = f[k_eta] +  0.5*dt*Q[k_eta] + 0.5*dt*Q1[k_eta];
+void RK4(CollisionContext *ctx, double *f, int l, fftw_complex *qHat, double **conv_weights, double *U) //4-th RK. yn=yn+(3*k1+k2+k3+k4)/6 
+{
+  int i;
+  double *Q = ctx->Q, *f1 = ctx->f1, *Q1 = ctx->Q1;										// the work arrays of the stages, from ctx (so that several space-steps can be advanced at the same time)
+  fftw_complex *Q1_fft = ctx->Q1_fft, *Q2_fft = ctx->Q2_fft, *Q3_fft = ctx->Q3_fft;
+
+  FS(qHat, Q, ctx->temp); 																	// set Q to the Fourier series representation of qHat (i.e. the IFFT of qHat)
+  //ifft3D(qHat, Q);
+  #pragma omp parallel for private(i) shared(Q,f1,f)
+  for(i=0;i<size_ft;i++)																// calculate the first step of RK4
+  {
+    f1[i] = f[i] + dt*Q[i]*nu; 															// this is Fn + Kn^1(*nu...?) BUG: this evolution (only on node values) is not consistent with our conservation routine, which preserves the exact moments of the {1,v,|v|^{2}} approximations
   }
-  
-	//printf("density(f2)=%g\n", getDensity(f2));
-  ComputeQ(f2, Q2_fft, conv_weights); //collides
+
+  ComputeQ(ctx, f1, Q1_fft, conv_weights);													// calculate the Fourier tranform of Q(f1,f1) using conv_weights for the weights in the convolution, then store the results of the Fourier transform in Q1_fft
+  conserveAllMoments(Q1_fft);   														// perform the explicit conservation calculation on Kn2^ = Q^(f1,f1) = Q1_fft
+
+  FS(Q1_fft, Q1, ctx->temp);																	// set Q1 to the Fourier series representation of Q1_fft (i.e. the IFFT of Q1_fft, so that Kn^2 = Q1 = Q(Fn + dt*Kn^1, Fn + dt*Kn^1) )
+  //ifft3D(Q1_fft, Q1);
+  #pragma omp parallel for private(i) shared(Q,Q1,f1,f)
+  for(i=0;i<size_ft;i++)																// calculate the second step of RK4
+  {
+    f1[i] = f[i] +  0.5*dt*Q[i]*nu + 0.5*dt*Q1[i]*nu;
+  }
+
+  ComputeQ(ctx, f1, Q2_fft, conv_weights); //collides
   conserveAllMoments(Q2_fft);   //conserves k3
 
-  ProjectedNodeValue(Q2_fft, Q1);
-  #pragma omp parallel for private(k_eta) shared(Q,Q1,f3,f)
-  for(k_eta=0;k_eta<size_ft;k_eta++){		 
-    f3[k_eta] = f[k_eta] + 0.5*dt*Q[k_eta] + 0.5*dt*Q1[k_eta];
+  FS(Q2_fft, Q1, ctx->temp);
+  //ifft3D(Q2_fft, Q1);
+  #pragma omp parallel for private(i) shared(Q,Q1,f1,f)
+  for(i=0;i<size_ft;i++)																// calculate the third step of RK4
+  {
+    f1[i] = f[i] + 0.5*Q[i]*nu + 0.5*Q1[i]*nu;
   }
-	 
-  ComputeQ(f3, Q3_fft, conv_weights); //collides
+
+  ComputeQ(ctx, f1, Q3_fft, conv_weights); //collides
   conserveAllMoments(Q3_fft);                //conserves k4
-  */
-  #pragma omp parallel for schedule(dynamic) private(j1,j2,j3,i,j,k,k_v,k_eta,kk,Q_re, Q_im, tp0, tp2,tp3,tp4, tp5) shared(l,qHat,U) //reduction(+: tmp0, tmp2, tmp3, tmp4, tmp5)
-  for(int kt=0;kt<size_v;kt++){
-    j3 = kt % Nv; j2 = ((kt-j3)/Nv) % Nv; j1 = (kt - j3 - Nv*j2)/(Nv*Nv);
-    tp0=0.; tp2=0.; tp3=0.; tp4=0.; tp5=0.;
-    for(i=0;i<N;i++){
-      for(j=0;j<N;j++){
-		for(k=0;k<N;k++){
-		  k_eta = k + N*(j + N*i);
-		  //kk = kt*size_ft+k_eta;
-		  IntModes(i,j,k,j1,j2,j3,IntM); //the global IntM must be declared as threadprivate
-		  
-		  Q_re = nu*(0.5*qHat[k_eta][0] + (Q1_fft[k_eta][0]+Q2_fft[k_eta][0]+Q3_fft[k_eta][0])/6.);
-		  Q_im = nu*(0.5*qHat[k_eta][1] + (Q1_fft[k_eta][1]+Q2_fft[k_eta][1]+Q3_fft[k_eta][1])/6.);
-		  
-		  //tem = scale3*wtN[i]*wtN[j]*wtN[k]*h_eta*h_eta*h_eta;
-		  tp0 += IntM[0]*Q_re - IntM[1]*Q_im;
-		  tp2 += IntM[1*2]*Q_re - IntM[1*2+1]*Q_im;
-		  tp3 += IntM[2*2]*Q_re - IntM[2*2+1]*Q_im;
-		  tp4 += IntM[3*2]*Q_re - IntM[3*2+1]*Q_im;
-		  tp5 += IntM[4*2]*Q_re - IntM[4*2+1]*Q_im;
-		}
-      }
-    }	     
-    //tmp0 += tp0; tmp2 += dv*tp2 + Gridv((double)j1)*tp0; tmp3 += dv*tp3 +Gridv((double)j2)*tp0 ;tmp4 += dv*tp4 + Gridv((double)j3)*tp0;  //tmp5 += (Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3))*tp0 +dv*dv*tp5+2*dv*(Gridv((double)j1)*tp2 + Gridv((double)j2)*tp3 +Gridv((double)j3)*tp4);     
-	//tmp5 += dv*dv*tp5 -  (Gridv((double)j1)*Gridv((double)j1) + Gridv((double)j2)*Gridv((double)j2) + Gridv((double)j3)*Gridv((double)j3))*tp0 + 2*(Gridv((double)j1)*(dv*tp2 + Gridv((double)j1)*tp0) + Gridv((double)j2)*(dv*tp3 + Gridv((double)j2)*tp0) + Gridv((double)j3)*(dv*tp4 + Gridv((double)j3)*tp0));
-	  
-    k_v = l*size_v + kt;      
-    tp0 = U[k_v*6+0] + U[k_v*6+5]/4. + dt*tp0/scalev/scaleL/scale3;
-    tp2 = U[k_v*6+2] + dt*tp2*12./scalev/scaleL/scale3;
-    tp3 = U[k_v*6+3] + dt*tp3*12./scalev/scaleL/scale3;
-    tp4 = U[k_v*6+4] + dt*tp4*12./scalev/scaleL/scale3;
-    tp5 = U[k_v*6+0]/4. + U[k_v*6+5]*19./240. + dt*tp5/scalev/scaleL/scale3;
 
-    U[k_v*6+0] = 19*tp0/4. - 15*tp5;
-    U[k_v*6+5] = 60*tp5 - 15*tp0;
-    U[k_v*6+2] = tp2; U[k_v*6+3] = tp3; U[k_v*6+4] = tp4;      
-  }
-	//printf("RK4: %g, %g, %g, %g, %g\n", tmp0, tmp2, tmp3, tmp4, 0.5*tmp5);  
-}   
+  RK4_ProjectStep(ctx, l, qHat, Q1_fft, Q2_fft, Q3_fft, U);						// add dt times the RK4 combination of the four stages to the DG coefficients of the collision invariants at the space-step l in U
+}
 #endif
-
-#endif  
+ 
@@ -18,6 +18,7 @@
 #include "LP_ompi.h"																					// allows the libraries included, macros defined and external variables declared in LP_ompi.h to be used in the collisionRoutines_1 functions
 #include "advection_1.h"																				// allows the external variables and function prototypes declared in advection_1.h to be used in the collitionRoutines_1 functions
 #include "conservationRoutines.h"																		// allows the function prototypes declared in conservationRoutines.h to be used in the collisionRoutines_1 functions
+#include "CollisionContext.h"																			// allows the CollisionContext holding the work arrays of a collision step to be used in the collisionRoutines_1 functions
 
 //************************//
 //   FUNCTION PROTOTYPES  //
@@ -29,6 +30,8 @@ double S233hat(double ki1, double ki2, double ki3);
 
 double S213hat(double ki1, double ki2, double ki3);
 
+void computeShat(double ki1, double ki2, double ki3, double Shat[3][3]);
+
 double gHat3(double eta1, double eta2, double eta3, double ki1, double ki2, double ki3 );
 
 double gHat3_linear(double eta1, double eta2, double eta3, double ki1, double ki2, double ki3 );
@@ -37,38 +40,62 @@ void generate_conv_weights(double **conv_weights);
 
 void generate_conv_weights_linear(double **conv_weights_linear);
 
-void fft3D(fftw_complex *in, fftw_complex *out);
+void generate_weight_table(double *table);
+
+void generate_conv_weights_rows(double **conv_weights, int t_start, int t_end);
 
-void ifft3D(fftw_complex *in, fftw_complex *out);
+void generate_conv_weights_linear_rows(double **conv_weights_linear, int t_start, int t_end);
 
-void FS(fftw_complex *in, fftw_complex *out);
+void generate_conv_coeffs(double *conv_coeffs);
 
 #ifdef MPI_parallelcollision
 void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights);
 #endif
 
+void convMonomials(int i, int j, int k, double *mono);
+
+void ComputeQ_MatrixFree(fftw_complex *fHat, fftw_complex *qHat, fftw_complex *qHat_linear);
+
+void ComputeQ_FFT(CollisionContext *ctx, fftw_complex *fHat, fftw_complex *qHat, fftw_complex *qHat_linear);
+
+void ComputeQ_Symmetric(fftw_complex *fHat, fftw_complex *qHat, fftw_complex *qHat_linear);
+
+void ComputeQ_WithMethod(CollisionContext *ctx, fftw_complex *fHat, fftw_complex *qHat, fftw_complex *qHat_linear);
+
+void convWindow(int i, int *start, int *end);
+
+void mirrorWeights(int i, double *wt_mirror, int *unpaired);
+
+void ComputeQ_Direct(fftw_complex *fHat, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear);
+
+double checkComputeQ(CollisionContext *ctx, double *f, double **conv_weights, double **conv_weights_linear);
+
+void generate_int_modes(double *int_modes);
+
 void IntModes(int k1, int k2,  int k3, int j1, int j2, int j3, double *result);
 
-void ProjectedNodeValue(fftw_complex *qHat, double *Q_incremental);
+void generate_proj_modes(double *int_modes, double *proj_modes);
+
+void ProjectOntoCells(CollisionContext *ctx, fftw_complex *G, double *cells);
+
+void ProjectedNodeValue(CollisionContext *ctx, fftw_complex *qHat, double *Q_incremental);
+
+void RK4_ProjectStep(CollisionContext *ctx, int l, fftw_complex *qHat, fftw_complex *Q1_fft, fftw_complex *Q2_fft, fftw_complex *Q3_fft, double *U);
 
-#ifdef UseMPI
-	#ifdef FullandLinear
-	void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear);
+void ComputeQ_Batch(CollisionContext *ctx, double **f, int n_cells, fftw_complex **qHat, double **conv_weights, fftw_complex **qHat_linear, double **conv_weights_linear);
 
-	void RK4(double *f, int l, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear, double *U, double *dU);
-	#else
-	void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights);
+#ifdef FullandLinear
+void RK4_Batch(CollisionContext *ctx, double **f, int l0, int n_cells, double **conv_weights, double **conv_weights_linear, double *U);
 
-	void RK4(double *f, int l, fftw_complex *qHat, double **conv_weights, double *U, double *dU);
-	#endif
+void ComputeQ(CollisionContext *ctx, double *f, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear);
+
+void RK4(CollisionContext *ctx, double *f, int l, fftw_complex *qHat, double **conv_weights, fftw_complex *qHat_linear, double **conv_weights_linear, double *U);
 #else
-	#ifdef FullandLinear
-	void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights, double **conv_weights_linear);
-	#else
-	void ComputeQ(double *f, fftw_complex *qHat, double **conv_weights);
-
-	void RK4(double *f, int l, fftw_complex *qHat, double **conv_weights, double *U);
-	#endif
-#endif  
+void RK4_Batch(CollisionContext *ctx, double **f, int l0, int n_cells, double **conv_weights, double *U);
+
+void ComputeQ(CollisionContext *ctx, double *f, fftw_complex *qHat, double **conv_weights);
+
+void RK4(CollisionContext *ctx, double *f, int l, fftw_complex *qHat, double **conv_weights, double *U);
+#endif
 
 #endif /* COLLISIONROUTINES_H_ */
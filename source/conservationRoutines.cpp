@@ -7,10 +7,6 @@
 
 #include "conservationRoutines.h"																		// conservationRoutines.h is where the prototypes for the functions contained in this file are declared
 
-extern fftw_plan p_forward; 
-extern fftw_plan p_backward; 
-extern fftw_complex *temp;
-
 double sinc(double x)
 {
   double result;
@@ -86,7 +82,7 @@ void solveWithCCt(int nElem, double *b)
 #ifdef FullandLinear
 void conserveAllMoments(fftw_complex *qHat, fftw_complex *qHat_linear) // Q^ -->Q--->conserve-->new Q^
 {
-	//double  *lamb, lamb_linear[2];
+	double lamb[5], lamb_linear[2];												// the Lagrange multipliers, local so that several collision steps can be conserved at the same time
 	double tmp0=0., tmp1=0., tmp2=0., tmp3=0., tmp4=0., tp0=0., tp1=0.;
 	int i,k_eta;	
 	
@@ -122,7 +118,7 @@ void conserveAllMoments(fftw_complex *qHat, fftw_complex *qHat_linear) // Q^ -->
 #else
 void conserveAllMoments(fftw_complex *qHat) // Q^ -->Q--->conserve-->new Q^
 {
-	//double  *lamb, lamb_linear[2];
+	double lamb[5];																// the Lagrange multipliers, local so that several collision steps can be conserved at the same time
 	double tmp0=0., tmp1=0., tmp2=0., tmp3=0., tmp4=0., tp0=0., tp1=0.;
 	int i,k_eta;	
 	